@@ -0,0 +1,558 @@
+/*
+		Project:		dbLIB
+		Module:			dbBench.cpp
+		Description:	the benchmark suite
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify
+		it under the terms of the GNU General Public License as published by
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+/*
+	usage: dbBench [options]
+
+	-rows n,n,...		the table sizes, default 10000,100000,1000000,10000000
+	-dist name			sequential, random or zipf, default random
+	-ops n				lookups, updates and deletes per table, default 100000
+	-seed n				the seed of the key generator, default 42
+	-pool bytes			the budget of the buffer pool
+	-wal n				write ahead log, n inserts per transaction
+	-path directory		the database directory, default dbBench
+	-json				JSON output instead of CSV
+	-out file			the output file, default stdout
+
+	The same seed produces the same keys, so the results of two releases
+	can be compared.
+*/
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "../db_exception.h"
+#include "../db_buffer_pool.h"
+
+#include "../database.h"
+#include "../table.h"
+
+using gak::STRING;
+
+const char benchTable[] = "benchTable";
+const char ID_FIELD[] = "ID_FIELD";
+const char SEC_FIELD[] = "SEC_FIELD";
+const char PAYLOAD_FIELD[] = "PAYLOAD_FIELD";
+const char SEC_INDEX[] = "SEC_INDEX";
+
+enum Distribution
+{
+	dSequential, dRandom, dZipf
+};
+
+static const char *distributionNames[] =
+{
+	"sequential", "random", "zipf"
+};
+
+struct BenchOptions
+{
+	std::vector<long>	rows;
+	Distribution		distribution;
+	long				ops;
+	unsigned long		seed;
+	size_t				poolBudget;
+	long				walBatch;
+	STRING				path;
+	bool				json;
+	STRING				outFile;
+
+	BenchOptions()
+	{
+		distribution = dRandom;
+		ops = 100000;
+		seed = 42;
+		poolBudget = 0;
+		walBatch = 0;
+		path = "dbBench";
+		json = false;
+	}
+};
+
+struct BenchResult
+{
+	long		rows;
+	const char	*distribution;
+	const char	*operation;
+	long		ops;
+	double		seconds;
+	double		p50;				// microseconds
+	double		p99;
+};
+
+typedef std::chrono::steady_clock	BenchClock;
+
+/*
+	zipfian ranks like YCSB: rank 0 is the hottest key, theta 0.99
+*/
+class ZipfGenerator
+{
+	long	m_numItems;
+	double	m_theta, m_alpha, m_zetaN, m_eta;
+
+	static double zeta( long numItems, double theta )
+	{
+		double	sum = 0;
+		for( long i=1; i<=numItems; ++i )
+			sum += 1.0 / std::pow( double(i), theta );
+
+		return sum;
+	}
+
+	public:
+	ZipfGenerator( long numItems, double theta=0.99 )
+	{
+		m_numItems = numItems;
+		m_theta = theta;
+		m_alpha = 1.0 / (1.0 - theta);
+		m_zetaN = zeta( numItems, theta );
+		m_eta = (1.0 - std::pow( 2.0 / numItems, 1.0 - theta ))
+			/ (1.0 - zeta( 2, theta ) / m_zetaN);
+	}
+	template <typename RandomT>
+	long operator () ( RandomT &random )
+	{
+		double	u = std::uniform_real_distribution<double>( 0.0, 1.0 )( random );
+		double	uz = u * m_zetaN;
+
+		if( uz < 1.0 )
+/***/		return 0;
+		if( uz < 1.0 + std::pow( 0.5, m_theta ) )
+/***/		return 1;
+
+		long	rank = long( m_numItems * std::pow( m_eta*u - m_eta + 1.0, m_alpha ) );
+		return rank < m_numItems ? rank : m_numItems-1;
+	}
+};
+
+/*
+	collects the latencies of one operation
+*/
+class LatencyRecorder
+{
+	std::vector<double>		m_latencies;
+	BenchClock::time_point	m_start, m_opStart;
+
+	public:
+	LatencyRecorder( long expected )
+	{
+		m_latencies.reserve( size_t(expected) );
+		m_start = BenchClock::now();
+	}
+	void begin()
+	{
+		m_opStart = BenchClock::now();
+	}
+	void end()
+	{
+		m_latencies.push_back(
+			std::chrono::duration<double, std::micro>( BenchClock::now() - m_opStart ).count()
+		);
+	}
+	BenchResult getResult( long rows, Distribution distribution, const char *operation )
+	{
+		BenchResult	result;
+
+		result.seconds = std::chrono::duration<double>( BenchClock::now() - m_start ).count();
+		result.rows = rows;
+		result.distribution = distributionNames[distribution];
+		result.operation = operation;
+		result.ops = long(m_latencies.size());
+		result.p50 = percentile( 0.50 );
+		result.p99 = percentile( 0.99 );
+
+		return result;
+	}
+	double percentile( double fraction )
+	{
+		if( m_latencies.empty() )
+/***/		return 0;
+
+		std::vector<double>::iterator	nth = m_latencies.begin()
+			+ std::ptrdiff_t( fraction * double(m_latencies.size()-1) );
+		std::nth_element( m_latencies.begin(), nth, m_latencies.end() );
+
+		return *nth;
+	}
+};
+
+/*
+	the secondary key does not follow the primary order
+*/
+static long getSecondaryKey( long id )
+{
+	return long( (gak::uint64(id) * 2654435761U) % 2147483647U );
+}
+
+static void checkFound( dbLib::Table *tab )
+{
+	if( tab->eof() )
+		throw std::runtime_error( "benchmark key not found" );
+}
+
+static STRING getPayload( long id, long version )
+{
+	STRING	payload = "payload ";
+
+	payload += dbLib::FieldValue::convertFieldType<long>( id );
+	payload += ' ';
+	payload += dbLib::FieldValue::convertFieldType<long>( version );
+
+	return payload;
+}
+
+/*
+	the keys for lookups and updates
+*/
+static std::vector<long> getAccessKeys(
+	const BenchOptions &options, long rows, std::mt19937_64 &random
+)
+{
+	std::vector<long>	keys;
+	long				ops = std::min( options.ops, rows );
+
+	keys.reserve( size_t(ops) );
+	if( options.distribution == dSequential )
+	{
+		for( long i=0; i<ops; ++i )
+			keys.push_back( i );
+	}
+	else if( options.distribution == dRandom )
+	{
+		std::uniform_int_distribution<long>	uniform( 0, rows-1 );
+		for( long i=0; i<ops; ++i )
+			keys.push_back( uniform( random ) );
+	}
+	else
+	{
+		ZipfGenerator	zipf( rows );
+		for( long i=0; i<ops; ++i )
+			keys.push_back( zipf( random ) );
+	}
+
+	return keys;
+}
+
+static void createBenchTable( dbLib::Database *db )
+{
+	doEnterFunctionEx( gakLogging::llInfo, "createBenchTable" );
+
+	db->dropTable( benchTable );
+
+	std::auto_ptr<dbLib::Table> 	 t1( db->createTable( benchTable ) );
+
+	t1->addField( ID_FIELD, dbLib::ftInteger, true, true );
+	t1->addField( SEC_FIELD, dbLib::ftInteger, false, true );
+	t1->addField( PAYLOAD_FIELD, dbLib::ftString );
+
+	t1->createIndex( SEC_INDEX );
+	t1->addFieldToIndex( SEC_INDEX, SEC_FIELD, false, true );
+}
+
+static void benchTableSize(
+	dbLib::Database *db, const BenchOptions &options, long rows,
+	std::vector<BenchResult> *results
+)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "benchTableSize" );
+
+	std::mt19937_64	random( options.seed );
+
+	// insert order: ascending for sequential keys, shuffled otherwise
+	std::vector<long>	insertKeys( static_cast<size_t>(rows) );
+	for( long i=0; i<rows; ++i )
+		insertKeys[size_t(i)] = i;
+	if( options.distribution != dSequential )
+		std::shuffle( insertKeys.begin(), insertKeys.end(), random );
+
+	std::vector<long>	accessKeys = getAccessKeys( options, rows, random );
+
+	createBenchTable( db );
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( benchTable ) );
+
+	{
+		// with a log, the inserts are batched, the other writes sync each
+		dbLib::WriteAheadLog				*wal = tt->getWriteAheadLog();
+		std::auto_ptr<dbLib::Transaction>	transaction;
+
+		LatencyRecorder	recorder( rows );
+		for( long i=0; i<rows; ++i )
+		{
+			long	id = insertKeys[size_t(i)];
+
+			recorder.begin();
+			if( wal && !transaction.get() )
+				transaction.reset( new dbLib::Transaction( wal ) );
+			tt->insertRecord();
+			tt->getField( ID_FIELD )->setIntegerValue( id );
+			tt->getField( SEC_FIELD )->setIntegerValue( getSecondaryKey( id ) );
+			tt->getField( PAYLOAD_FIELD )->setStringValue( getPayload( id, 0 ) );
+			tt->postRecord();
+			if( transaction.get() && ((i+1) % options.walBatch == 0 || i+1 == rows) )
+			{
+				transaction->commit();
+				transaction.reset();
+			}
+			recorder.end();
+		}
+		results->push_back( recorder.getResult( rows, options.distribution, "insert" ) );
+	}
+
+	{
+		LatencyRecorder	recorder( long(accessKeys.size()) );
+		for( size_t i=0; i<accessKeys.size(); ++i )
+		{
+			recorder.begin();
+			tt->firstRecord( dbLib::FieldValue::convertFieldType<long>( accessKeys[i] ) );
+			recorder.end();
+
+			checkFound( tt.get() );
+		}
+		results->push_back( recorder.getResult( rows, options.distribution, "lookup" ) );
+	}
+
+	tt->setIndex( SEC_INDEX );
+	{
+		LatencyRecorder	recorder( long(accessKeys.size()) );
+		for( size_t i=0; i<accessKeys.size(); ++i )
+		{
+			long	secKey = getSecondaryKey( accessKeys[i] );
+
+			recorder.begin();
+			tt->firstRecord( dbLib::FieldValue::convertFieldType<long>( secKey ) );
+			recorder.end();
+
+			checkFound( tt.get() );
+		}
+		results->push_back( recorder.getResult( rows, options.distribution, "secondary_lookup" ) );
+	}
+	tt->setIndex( "" );
+
+	{
+		LatencyRecorder	recorder( rows );
+		recorder.begin();
+		for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+		{
+			recorder.end();
+			recorder.begin();
+		}
+		results->push_back( recorder.getResult( rows, options.distribution, "scan" ) );
+	}
+
+	{
+		LatencyRecorder	recorder( long(accessKeys.size()) );
+		for( size_t i=0; i<accessKeys.size(); ++i )
+		{
+			long	id = accessKeys[i];
+
+			recorder.begin();
+			tt->firstRecord( dbLib::FieldValue::convertFieldType<long>( id ) );
+			tt->getField( PAYLOAD_FIELD )->setStringValue( getPayload( id, long(i+1) ) );
+			tt->postRecord();
+			recorder.end();
+		}
+		results->push_back( recorder.getResult( rows, options.distribution, "update" ) );
+	}
+
+	{
+		// every key only once, in insert order
+		long			ops = std::min( options.ops, rows );
+		LatencyRecorder	recorder( ops );
+		for( long i=0; i<ops; ++i )
+		{
+			recorder.begin();
+			tt->firstRecord( dbLib::FieldValue::convertFieldType<long>( insertKeys[size_t(i)] ) );
+			tt->deleteRecord();
+			recorder.end();
+		}
+		results->push_back( recorder.getResult( rows, options.distribution, "delete" ) );
+	}
+
+	tt.reset();
+	db->dropTable( benchTable );
+}
+
+static void writeCSV( std::ostream &out, const std::vector<BenchResult> &results, unsigned long seed )
+{
+	out << "rows,distribution,seed,operation,ops,seconds,ops_per_sec,p50_us,p99_us\n";
+	for( size_t i=0; i<results.size(); ++i )
+	{
+		const BenchResult	&result = results[i];
+
+		out << result.rows << ',' << result.distribution << ',' << seed << ','
+			<< result.operation << ',' << result.ops << ',' << result.seconds << ','
+			<< (result.seconds > 0 ? result.ops / result.seconds : 0) << ','
+			<< result.p50 << ',' << result.p99 << '\n';
+	}
+}
+
+static void writeJSON( std::ostream &out, const std::vector<BenchResult> &results, unsigned long seed )
+{
+	out << "[\n";
+	for( size_t i=0; i<results.size(); ++i )
+	{
+		const BenchResult	&result = results[i];
+
+		out << "\t{ \"rows\": " << result.rows
+			<< ", \"distribution\": \"" << result.distribution << '"'
+			<< ", \"seed\": " << seed
+			<< ", \"operation\": \"" << result.operation << '"'
+			<< ", \"ops\": " << result.ops
+			<< ", \"seconds\": " << result.seconds
+			<< ", \"ops_per_sec\": " << (result.seconds > 0 ? result.ops / result.seconds : 0)
+			<< ", \"p50_us\": " << result.p50
+			<< ", \"p99_us\": " << result.p99
+			<< " }" << (i+1 < results.size() ? ",\n" : "\n");
+	}
+	out << "]\n";
+}
+
+static bool parseOptions( int argc, const char *argv[], BenchOptions *options )
+{
+	for( int i=1; i<argc; ++i )
+	{
+		STRING	option = argv[i];
+		bool	hasValue = i+1 < argc;
+
+		if( option == "-json" )
+			options->json = true;
+		else if( !hasValue )
+/***/		return false;
+		else if( option == "-rows" )
+		{
+			const char	*value = argv[++i];
+			char		*end;
+
+			options->rows.clear();
+			do
+			{
+				options->rows.push_back( strtol( value, &end, 10 ) );
+				value = end+1;
+			} while( *end == ',' );
+		}
+		else if( option == "-dist" )
+		{
+			STRING	value = argv[++i];
+			if( value == "sequential" )
+				options->distribution = dSequential;
+			else if( value == "random" )
+				options->distribution = dRandom;
+			else if( value == "zipf" )
+				options->distribution = dZipf;
+			else
+/***/			return false;
+		}
+		else if( option == "-ops" )
+			options->ops = STRING( argv[++i] ).getValueN<long>();
+		else if( option == "-seed" )
+			options->seed = STRING( argv[++i] ).getValueN<unsigned long>();
+		else if( option == "-pool" )
+			options->poolBudget = STRING( argv[++i] ).getValueN<size_t>();
+		else if( option == "-wal" )
+			options->walBatch = STRING( argv[++i] ).getValueN<long>();
+		else if( option == "-path" )
+			options->path = argv[++i];
+		else if( option == "-out" )
+			options->outFile = argv[++i];
+		else
+/***/		return false;
+	}
+
+	if( options->rows.empty() )
+	{
+		for( long rows=10000; rows<=10000000; rows *= 10 )
+			options->rows.push_back( rows );
+	}
+
+	return true;
+}
+
+int main( int argc, const char *argv[] )
+{
+	doDisableLog();
+	doEnterFunctionEx( gakLogging::llInfo, "main" );
+
+	BenchOptions	options;
+	if( !parseOptions( argc, argv, &options ) )
+	{
+		std::cerr << "usage: dbBench [-rows n,n,...] [-dist sequential|random|zipf] [-ops n] "
+			"[-seed n] [-pool bytes] [-wal n] [-path directory] [-json] [-out file]" << std::endl;
+/***/	return 1;
+	}
+
+	if( options.poolBudget )
+		dbLib::BufferPool::getPool().setMemoryBudget( options.poolBudget );
+
+	std::vector<BenchResult>	results;
+	try
+	{
+		std::auto_ptr<dbLib::Database>	db( dbLib::Database::createDB( "", options.path, "bench", "" ) );
+		if( options.walBatch > 0 )
+			db->openWriteAheadLog();
+
+		for( size_t i=0; i<options.rows.size(); ++i )
+		{
+			std::cerr << "benchmarking " << options.rows[i] << " rows" << std::endl;
+			benchTableSize( db.get(), options, options.rows[i], &results );
+		}
+	}
+	catch( std::exception &e )
+	{
+		std::cerr << "dbBench: " << e.what() << std::endl;
+/***/	return 2;
+	}
+
+	std::ofstream	outFile;
+	if( !options.outFile.isEmpty() )
+	{
+		outFile.open( options.outFile );
+		if( !outFile )
+		{
+			perror( options.outFile );
+/***/		return 3;
+		}
+	}
+	std::ostream	&out = options.outFile.isEmpty() ? std::cout : outFile;
+
+	if( options.json )
+		writeJSON( out, results, options.seed );
+	else
+		writeCSV( out, results, options.seed );
+
+	return 0;
+}
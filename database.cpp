@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			database.cpp
 		Description:	The entire database management
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -44,6 +44,8 @@
 #include "database.h"
 #include "table.h"
 #include "db_file_io.h"
+#include "db_buffer_pool.h"
+#include "db_wal.h"
 
 // --------------------------------------------------------------------- //
 // ----- imported datas ------------------------------------------------ //
@@ -114,6 +116,11 @@ using gak::F_STRING;
 // ----- class constructors/destructors -------------------------------- //
 // --------------------------------------------------------------------- //
 
+Database::~Database()
+{
+	delete m_wal;
+}
+
 // --------------------------------------------------------------------- //
 // ----- class static functions ---------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -154,6 +161,25 @@ Database *Database::connectDB(
 
 	newDB->m_configuration.loadConfigFile( newDB->m_dbConfigFile );
 
+	STRING	bufferPoolSize = STRING(newDB->m_configuration["BUFFER_POOL_SIZE"]);
+	if( bufferPoolSize[0U] )
+		BufferPool::getPool().setMemoryBudget( bufferPoolSize.getValueN<size_t>() );
+
+	// a crash may have left a log, even if it is no longer configured
+	try
+	{
+		STRING	writeAheadLog = STRING(newDB->m_configuration["WRITE_AHEAD_LOG"]);
+		if( writeAheadLog[0U] && writeAheadLog.getValueN<int>() )
+			newDB->openWriteAheadLog();
+		else
+			WriteAheadLog::recover( newDB->getLogFileName() );
+	}
+	catch( ... )
+	{
+		delete newDB;
+		throw;
+	}
+
 	return newDB;
 }
 
@@ -235,6 +261,7 @@ Table *Database::createTable( const char *tableName )
 	tableFile += tableName;
 
 	theNewTable = new Table( tableFile );
+	theNewTable->setWriteAheadLog( m_wal );
 	theNewTable->create();
 
 	return theNewTable;
@@ -248,6 +275,10 @@ void Database::dropTable(const char *tableName)
 
 	if( tablePath[0U] )
 	{
+		// the log must not recreate the files
+		if( m_wal )
+			m_wal->checkpoint();
+
 		F_STRING path;
 		fsplit(tablePath, &path);
 
@@ -266,6 +297,35 @@ void Database::dropTable(const char *tableName)
 	}
 }
 
+/*
+	WAL_CHECKPOINT_SIZE in the config limits the size of the log
+*/
+void Database::openWriteAheadLog()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Database::openWriteAheadLog" );
+
+	if( m_wal )
+/***/	return;
+
+	gak::uint64	checkpointSize = WriteAheadLog::DEFAULT_CHECKPOINT_SIZE;
+	STRING		checkpointConfig = STRING(m_configuration["WAL_CHECKPOINT_SIZE"]);
+	if( checkpointConfig[0U] )
+		checkpointSize = checkpointConfig.getValueN<gak::uint64>();
+
+	// the log may be opened before the first table
+	if( !fileExists( m_dbPath ) && dbMakePath( m_dbPath ) )
+		throw DBmkdirFaild( m_dbPath );
+
+	m_wal = new WriteAheadLog( getLogFileName(), checkpointSize );
+}
+
+FileStats Database::getStats() const
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Database::getStats" );
+
+	return getOpenFileStats( m_dbPath );
+}
+
 Table *Database::openTable( const char *tableName )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Database::openTable" );
@@ -275,6 +335,7 @@ Table *Database::openTable( const char *tableName )
 	if( tablePath[0U] )
 	{
 		Table *theTable = new Table( tablePath );
+		theTable->setWriteAheadLog( m_wal );
 		theTable->open();
 
 		return theTable;
@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			database.h
 		Description:	The entire database management
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -82,6 +82,8 @@ namespace dbLib
 // --------------------------------------------------------------------- //
 
 class Table;
+class WriteAheadLog;
+struct FileStats;
 
 class Database
 {
@@ -92,6 +94,8 @@ class Database
 
 	gak::FieldSet	m_configuration;
 
+	WriteAheadLog	*m_wal;
+
 	private:
 	Database( const char *server, const char *db, const char *userName )
 	{
@@ -117,8 +121,13 @@ class Database
 		m_dbConfigFile += "db_info.cfg";
 
 		m_dbUser = userName;
+		m_wal = NULL;
 	}
 	gak::STRING findTablePath( const char *tableName );
+	gak::STRING getLogFileName() const
+	{
+		return m_dbPath + "db_wal.log";
+	}
 
 	public:
 	static Database *createDB(
@@ -129,6 +138,7 @@ class Database
 		const char *server, const char *db,
 		const char *userName, const char *password
 	);
+	~Database();
 
 	void connect();
 	void close();
@@ -136,6 +146,21 @@ class Database
 	Table *createTable( const char *tableName );
 	Table *openTable( const char *tableName );
 	void dropTable( const char *tableName );
+
+	/*
+		the tables opened later write their posts and deletes to the log.
+		connectDB opens the log, if WRITE_AHEAD_LOG is set in the config.
+	*/
+	void openWriteAheadLog();
+	WriteAheadLog *getWriteAheadLog() const
+	{
+		return m_wal;
+	}
+
+	/*
+		the counters of all open tables of this database
+	*/
+	FileStats getStats() const;
 };
 
 // --------------------------------------------------------------------- //
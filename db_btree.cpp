@@ -0,0 +1,1328 @@
+/*
+		Project:		dbLIB
+		Module:			db_btree.cpp
+		Description:	Page structured B+tree for index files
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <string.h>
+#include <assert.h>
+
+#include <gak/stdlib.h>
+
+#include "db_btree.h"
+#include "db_exception.h"
+#include "index.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+static const size_t	PAGE_SIZE = BTree::PAGE_SIZE;
+
+/*
+	the tree header in page 0 follows the format version
+*/
+static const size_t	HDR_ROOT_PAGE		= TABLE_HEADER_SIZE;
+static const size_t	HDR_NUM_PAGES		= HDR_ROOT_PAGE + 8;
+static const size_t	HDR_NUM_ENTRIES		= HDR_NUM_PAGES + 8;
+static const size_t	HDR_NEXT_ENTRY_ID	= HDR_NUM_ENTRIES + 8;
+static const size_t	HDR_HEIGHT			= HDR_NEXT_ENTRY_ID + 8;
+static const size_t	HDR_END				= HDR_HEIGHT + 4;
+
+/*
+	layout of a node page: the slots with the offsets of the entries in
+	key order follow the page header, the entries are stored from the end
+	of the page downwards
+*/
+static const size_t	NODE_FLAGS			= 0;
+static const size_t	NODE_NUM_ENTRIES	= 2;
+static const size_t	NODE_DATA_START		= 4;
+static const size_t	NODE_PREV_PAGE		= 8;		// leaves only
+static const size_t	NODE_NEXT_PAGE		= 16;
+static const size_t	NODE_SLOTS			= 24;
+
+static const gak::uint16	NODE_LEAF = 1;
+
+/*
+	a leaf entry contains the values and the lengths of a record, an inner
+	entry the first key of its child. The key of the first inner entry is
+	never compared, it is less than all keys.
+*/
+static const size_t	LEAF_BUFFER_LEN		= 0;
+static const size_t	LEAF_LENGTHS_LEN	= 2;
+static const size_t	LEAF_PRIMARY_LEN	= 4;
+static const size_t	LEAF_HEADER			= 6;
+
+static const size_t	INNER_CHILD			= 0;
+static const size_t	INNER_COUNT			= 8;		// entries in the subtree
+static const size_t	INNER_KEY_LEN		= 16;
+static const size_t	INNER_HEADER		= 18;
+
+/*
+	bulk loaded pages keep some space for later inserts
+*/
+static const size_t	FILL_LIMIT = PAGE_SIZE - PAGE_SIZE/8;
+
+static_assert(
+	4*(BTree::MAX_ENTRY_SIZE+2) <= PAGE_SIZE - NODE_SLOTS,
+	"a page must hold four entries"
+);
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+using gak::STRING;
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+static STRING makeString( const char *data, size_t len )
+{
+	gak::Buffer<char>	buffer( len+1 );
+
+	memcpy( buffer, data, len );
+	buffer[len] = 0;
+
+	return STRING( static_cast<const char *>(buffer) );
+}
+
+/*
+	compares like Record::compareRecordBuffer
+*/
+static int compareKey(
+	const char *key, size_t keyLen, const STRING &searchFor, bool prefixOnly
+)
+{
+	const size_t	searchLen = strlen( searchFor );
+	int compareVal = memcmp(
+		key, static_cast<const char *>(searchFor), keyLen < searchLen ? keyLen : searchLen
+	);
+	if( !compareVal )
+	{
+		if( keyLen < searchLen )
+			compareVal = -1;
+		else if( keyLen > searchLen && !prefixOnly )
+			compareVal = 1;
+	}
+
+	return compareVal;
+}
+
+static bool isLeaf( const char *page )
+{
+	return getBinary<gak::uint16>( page, NODE_FLAGS ) & NODE_LEAF;
+}
+
+static size_t getNumSlots( const char *page )
+{
+	return getBinary<gak::uint16>( page, NODE_NUM_ENTRIES );
+}
+
+static const char *getEntry( const char *page, size_t slot )
+{
+	return page + getBinary<gak::uint16>( page, NODE_SLOTS + 2*slot );
+}
+
+static size_t getEntrySize( const char *page, const char *entry )
+{
+	if( isLeaf( page ) )
+	{
+		return LEAF_HEADER
+			+ getBinary<gak::uint16>( entry, LEAF_BUFFER_LEN )
+			+ getBinary<gak::uint16>( entry, LEAF_LENGTHS_LEN );
+	}
+
+	return INNER_HEADER + getBinary<gak::uint16>( entry, INNER_KEY_LEN );
+}
+
+/*
+	the key of a leaf entry is the buffer without ";EOB"
+*/
+static const char *getEntryKey( const char *page, size_t slot, size_t *keyLen )
+{
+	const char	*entry = getEntry( page, slot );
+
+	if( isLeaf( page ) )
+	{
+		*keyLen = getBinary<gak::uint16>( entry, LEAF_BUFFER_LEN ) - EOB_LEN;
+/***/	return entry + LEAF_HEADER;
+	}
+
+	*keyLen = getBinary<gak::uint16>( entry, INNER_KEY_LEN );
+	return entry + INNER_HEADER;
+}
+
+static gak::int64 getChild( const char *page, size_t slot )
+{
+	return getBinary<gak::int64>( getEntry( page, slot ), INNER_CHILD );
+}
+
+static gak::int64 getChildCount( const char *page, size_t slot )
+{
+	return getBinary<gak::int64>( getEntry( page, slot ), INNER_COUNT );
+}
+
+static void setChildCount( char *page, size_t slot, gak::int64 count )
+{
+	putBinary<gak::int64>(
+		page, getBinary<gak::uint16>( page, NODE_SLOTS + 2*slot ) + INNER_COUNT, count
+	);
+}
+
+/*
+	the number of entries in the subtree of a page
+*/
+static gak::int64 getPageCount( const char *page )
+{
+	const size_t	numSlots = getNumSlots( page );
+
+	if( isLeaf( page ) )
+/***/	return gak::int64(numSlots);
+
+	gak::int64	count = 0;
+	for( size_t i=0; i<numSlots; ++i )
+		count += getChildCount( page, i );
+
+	return count;
+}
+
+/*
+	the bytes of the live entries including their slots
+*/
+static size_t getUsedSize( const char *page )
+{
+	const size_t	numSlots = getNumSlots( page );
+	size_t			used = NODE_SLOTS + 2*numSlots;
+
+	for( size_t i=0; i<numSlots; ++i )
+		used += getEntrySize( page, getEntry( page, i ) );
+
+	return used;
+}
+
+static size_t getFreeSpace( const char *page )
+{
+	return getBinary<gak::uint16>( page, NODE_DATA_START )
+		- NODE_SLOTS - 2*getNumSlots( page );
+}
+
+static void initPage( char *page, gak::uint16 flags )
+{
+	memset( page, 0, PAGE_SIZE );
+	putBinary<gak::uint16>( page, NODE_FLAGS, flags );
+	putBinary<gak::uint16>( page, NODE_DATA_START, gak::uint16(PAGE_SIZE) );
+}
+
+/*
+	adds an entry behind the last slot, if the page does not exceed limit
+*/
+static bool appendEntry( char *page, const char *entry, size_t entryLen, size_t limit=PAGE_SIZE )
+{
+	const size_t	numSlots = getNumSlots( page );
+	size_t			dataStart = getBinary<gak::uint16>( page, NODE_DATA_START );
+
+	if( NODE_SLOTS + 2*(numSlots+1) + PAGE_SIZE - dataStart + entryLen > limit )
+/***/	return false;
+
+	dataStart -= entryLen;
+	memcpy( page + dataStart, entry, entryLen );
+	putBinary<gak::uint16>( page, NODE_SLOTS + 2*numSlots, gak::uint16(dataStart) );
+	putBinary<gak::uint16>( page, NODE_NUM_ENTRIES, gak::uint16(numSlots+1) );
+	putBinary<gak::uint16>( page, NODE_DATA_START, gak::uint16(dataStart) );
+
+	return true;
+}
+
+/*
+	removed entries leave holes, they are dropped, when the space is needed
+*/
+static void compactPage( char *page )
+{
+	char	copy[PAGE_SIZE];
+
+	memcpy( copy, page, PAGE_SIZE );
+	initPage( page, getBinary<gak::uint16>( copy, NODE_FLAGS ) );
+	memcpy( page + NODE_PREV_PAGE, copy + NODE_PREV_PAGE, NODE_SLOTS - NODE_PREV_PAGE );
+
+	const size_t	numSlots = getNumSlots( copy );
+	for( size_t i=0; i<numSlots; ++i )
+	{
+		const char	*entry = getEntry( copy, i );
+		appendEntry( page, entry, getEntrySize( copy, entry ) );
+	}
+}
+
+static bool insertEntry( char *page, size_t slot, const char *entry, size_t entryLen )
+{
+	if( getFreeSpace( page ) < entryLen + 2 )
+	{
+		compactPage( page );
+		if( getFreeSpace( page ) < entryLen + 2 )
+/***/		return false;
+	}
+
+	const size_t	numSlots = getNumSlots( page );
+	appendEntry( page, entry, entryLen );
+
+	char	*slots = page + NODE_SLOTS;
+	gak::uint16	offset = getBinary<gak::uint16>( slots, 2*numSlots );
+	memmove( slots + 2*(slot+1), slots + 2*slot, 2*(numSlots-slot) );
+	putBinary<gak::uint16>( slots, 2*slot, offset );
+
+	return true;
+}
+
+static void removeEntry( char *page, size_t slot )
+{
+	const size_t	numSlots = getNumSlots( page );
+	char			*slots = page + NODE_SLOTS;
+
+	memmove( slots + 2*slot, slots + 2*(slot+1), 2*(numSlots-slot-1) );
+	putBinary<gak::uint16>( page, NODE_NUM_ENTRIES, gak::uint16(numSlots-1) );
+}
+
+static size_t makeLeafEntry(
+	char *entry, const STRING &buffer, const STRING &lengths, gak::uint64 primaryLen,
+	const DbFile *dataFileHandle
+)
+{
+	const size_t	bufferLen = strlen( buffer );
+	const size_t	lengthsLen = strlen( lengths );
+	const size_t	entryLen = LEAF_HEADER + bufferLen + lengthsLen;
+
+	// the key must fit into the inner pages, too
+	if( entryLen > BTree::MAX_ENTRY_SIZE || INNER_HEADER + bufferLen > BTree::MAX_ENTRY_SIZE )
+		throw DBkeyTooLong( dataFileHandle->getFileName() );
+
+	putBinary<gak::uint16>( entry, LEAF_BUFFER_LEN, gak::uint16(bufferLen) );
+	putBinary<gak::uint16>( entry, LEAF_LENGTHS_LEN, gak::uint16(lengthsLen) );
+	putBinary<gak::uint16>( entry, LEAF_PRIMARY_LEN, gak::uint16(primaryLen) );
+	memcpy( entry + LEAF_HEADER, static_cast<const char *>(buffer), bufferLen );
+	memcpy( entry + LEAF_HEADER + bufferLen, static_cast<const char *>(lengths), lengthsLen );
+
+	return entryLen;
+}
+
+static size_t makeInnerEntry(
+	char *entry, gak::int64 child, gak::int64 count, const STRING &key
+)
+{
+	const size_t	keyLen = strlen( key );
+
+	putBinary<gak::int64>( entry, INNER_CHILD, child );
+	putBinary<gak::int64>( entry, INNER_COUNT, count );
+	putBinary<gak::uint16>( entry, INNER_KEY_LEN, gak::uint16(keyLen) );
+	memcpy( entry + INNER_HEADER, static_cast<const char *>(key), keyLen );
+
+	return INNER_HEADER + keyLen;
+}
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+BTreeWriter::BTreeWriter( DbFile *target )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTreeWriter::BTreeWriter" );
+
+	m_target = target;
+	m_pageNo = 1;
+	m_numEntries = 0;
+	m_nextEntryId = 0;
+
+	writeTableHeader( m_target, fvBTree );
+	initPage( m_page, NODE_LEAF );
+}
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+void BTree::readPage( DbFile *dataFileHandle, gak::int64 pageNo, char *page )
+{
+	if( dataFileHandle->read( pageNo * gak::int64(PAGE_SIZE), page, PAGE_SIZE ) != long(PAGE_SIZE) )
+		throw DBillegalRecordHeader( dataFileHandle->getFileName() );
+
+	dataFileHandle->count( scHeadersRead );
+}
+
+void BTree::writePage( DbFile *dataFileHandle, gak::int64 pageNo, const char *page )
+{
+	dataFileHandle->write( pageNo * gak::int64(PAGE_SIZE), page, PAGE_SIZE );
+	dataFileHandle->count( scHeadersWritten );
+}
+
+void BTree::readTreeHeader( DbFile *dataFileHandle, TreeHeader *header )
+{
+	char	buffer[HDR_END];
+
+	if( dataFileHandle->read( 0, buffer, HDR_END ) != long(HDR_END) )
+		throw DBillegalRecordHeader( dataFileHandle->getFileName() );
+
+	header->rootPage = getBinary<gak::int64>( buffer, HDR_ROOT_PAGE );
+	header->numPages = getBinary<gak::int64>( buffer, HDR_NUM_PAGES );
+	header->numEntries = getBinary<gak::int64>( buffer, HDR_NUM_ENTRIES );
+	header->nextEntryId = getBinary<gak::uint64>( buffer, HDR_NEXT_ENTRY_ID );
+	header->height = getBinary<gak::uint32>( buffer, HDR_HEIGHT );
+	if( header->rootPage <= 0 || !header->height )
+		throw DBillegalRecordHeader( dataFileHandle->getFileName() );
+}
+
+void BTree::writeTreeHeader( DbFile *dataFileHandle, const TreeHeader &header )
+{
+	char	buffer[HDR_END];
+
+	putBinary<gak::int64>( buffer, HDR_ROOT_PAGE, header.rootPage );
+	putBinary<gak::int64>( buffer, HDR_NUM_PAGES, header.numPages );
+	putBinary<gak::int64>( buffer, HDR_NUM_ENTRIES, header.numEntries );
+	putBinary<gak::uint64>( buffer, HDR_NEXT_ENTRY_ID, header.nextEntryId );
+	putBinary<gak::uint32>( buffer, HDR_HEIGHT, header.height );
+
+	dataFileHandle->write( HDR_ROOT_PAGE, buffer + HDR_ROOT_PAGE, HDR_END - HDR_ROOT_PAGE );
+}
+
+/*
+	searches the first entry behind key: with strict the first one greater
+	than key, otherwise the first one not less. The leaf is loaded to page,
+	the slot may follow the last entry of the leaf. With a path the pages
+	and slots of all levels are stored, the leaf last.
+	returns the number of entries before
+*/
+gak::int64 BTree::locate(
+	DbFile *dataFileHandle, const STRING &key, bool prefixOnly, bool strict,
+	char *page, gak::int64 *pageNo, size_t *slot, Path *path
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::locate" );
+
+	TreeHeader	header;
+	gak::int64	rank = 0;
+
+	readTreeHeader( dataFileHandle, &header );
+	if( path )
+		path->clear();
+
+	*pageNo = header.rootPage;
+	while( true )
+	{
+		readPage( dataFileHandle, *pageNo, page );
+
+		const bool	leaf = isLeaf( page );
+		size_t		lower = leaf ? 0 : 1;
+		size_t		upper = getNumSlots( page );
+
+		while( lower < upper )
+		{
+			const size_t	mid = (lower+upper)/2;
+			size_t			keyLen;
+			const char		*entryKey = getEntryKey( page, mid, &keyLen );
+			const int		compareVal = compareKey( entryKey, keyLen, key, prefixOnly );
+
+			if( strict ? compareVal > 0 : compareVal >= 0 )
+				upper = mid;
+			else
+				lower = mid+1;
+		}
+
+		if( leaf )
+		{
+			*slot = lower;
+			rank += gak::int64(lower);
+			if( path )
+			{
+				PathItem	&item = path->createElement();
+				item.pageNo = *pageNo;
+				item.slot = lower;
+			}
+/*v*/		break;
+		}
+
+		const size_t	childSlot = lower-1;
+		for( size_t i=0; i<childSlot; ++i )
+			rank += getChildCount( page, i );
+
+		if( path )
+		{
+			PathItem	&item = path->createElement();
+			item.pageNo = *pageNo;
+			item.slot = childSlot;
+		}
+		*pageNo = getChild( page, childSlot );
+	}
+
+	dataFileHandle->countDescent( header.height );
+
+	return rank;
+}
+
+/*
+	distributes the entries of a full page and the new entry on the page
+	and a new right neighbour. Both get about the same number of bytes.
+*/
+void BTree::splitPage(
+	DbFile *dataFileHandle, TreeHeader *header,
+	char *page, gak::int64 pageNo, size_t slot, const char *entry, size_t entryLen,
+	gak::int64 *rightPageNo, gak::int64 *rightCount, STRING *separator
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::splitPage" );
+
+	dataFileHandle->count( scRebalances );
+
+	char	copy[PAGE_SIZE], right[PAGE_SIZE];
+	memcpy( copy, page, PAGE_SIZE );
+
+	// all entries in key order
+	const size_t				numSlots = getNumSlots( copy );
+	gak::Array<const char *>	entries;
+	gak::Array<size_t>			sizes;
+	size_t						totalSize = 0;
+
+	for( size_t i=0; i<=numSlots; ++i )
+	{
+		const char	*cur = i < slot ? getEntry( copy, i ) : i == slot ? entry : getEntry( copy, i-1 );
+		const size_t	size = cur == entry ? entryLen : getEntrySize( copy, cur );
+
+		entries.addElement( cur );
+		sizes.addElement( size );
+		totalSize += size;
+	}
+
+	size_t	splitIdx = 0, leftSize = 0;
+	while( splitIdx < numSlots && leftSize + sizes[splitIdx]/2 < totalSize/2 )
+		leftSize += sizes[splitIdx++];
+	if( !splitIdx )
+		splitIdx = 1;
+
+	const gak::uint16	flags = getBinary<gak::uint16>( copy, NODE_FLAGS );
+	initPage( page, flags );
+	initPage( right, flags );
+	for( size_t i=0; i<=numSlots; ++i )
+	{
+		bool	fits = appendEntry( i < splitIdx ? page : right, entries[i], sizes[i] );
+		assert( fits );
+		(void)fits;
+	}
+
+	*rightPageNo = header->numPages++;
+	if( flags & NODE_LEAF )
+	{
+		const gak::int64	nextPageNo = getBinary<gak::int64>( copy, NODE_NEXT_PAGE );
+
+		putBinary<gak::int64>( page, NODE_PREV_PAGE, getBinary<gak::int64>( copy, NODE_PREV_PAGE ) );
+		putBinary<gak::int64>( page, NODE_NEXT_PAGE, *rightPageNo );
+		putBinary<gak::int64>( right, NODE_PREV_PAGE, pageNo );
+		putBinary<gak::int64>( right, NODE_NEXT_PAGE, nextPageNo );
+
+		if( nextPageNo )
+		{
+			char	next[PAGE_SIZE];
+
+			readPage( dataFileHandle, nextPageNo, next );
+			putBinary<gak::int64>( next, NODE_PREV_PAGE, *rightPageNo );
+			writePage( dataFileHandle, nextPageNo, next );
+		}
+	}
+
+	size_t		keyLen;
+	const char	*key = getEntryKey( right, 0, &keyLen );
+
+	*separator = makeString( key, keyLen );
+	*rightCount = getPageCount( right );
+
+	writePage( dataFileHandle, pageNo, page );
+	writePage( dataFileHandle, *rightPageNo, right );
+}
+
+/*
+	writes an empty tree, the root is a leaf
+*/
+void BTree::create( DbFile *dataFileHandle )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::create" );
+
+	char	page[PAGE_SIZE];
+
+	writeTableHeader( dataFileHandle, fvBTree );
+	initPage( page, NODE_LEAF );
+	writePage( dataFileHandle, 1, page );
+
+	TreeHeader	header;
+	header.rootPage = 1;
+	header.numPages = 2;
+	header.numEntries = 0;
+	header.nextEntryId = 0;
+	header.height = 1;
+	writeTreeHeader( dataFileHandle, header );
+}
+
+gak::int64 BTree::getNumEntries( DbFile *dataFileHandle )
+{
+	TreeHeader	header;
+
+	readTreeHeader( dataFileHandle, &header );
+
+	return header.numEntries;
+}
+
+/*
+	counts the entries less than the prefix searchFor or less or equal
+*/
+gak::int64 BTree::countLess(
+	DbFile *dataFileHandle, const STRING &searchFor, bool orEqual
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::countLess" );
+
+	char		page[PAGE_SIZE];
+	gak::int64	pageNo;
+	size_t		slot;
+
+	return locate( dataFileHandle, searchFor, true, orEqual, page, &pageNo, &slot );
+}
+
+/*
+	like Record::locateValue: searches the entry with the primary key or
+	the complete key searchFor. The position is valid until the next write.
+*/
+int BTree::locateValue(
+	DbFile *dataFileHandle, gak::int64 *posFound,
+	const STRING &searchFor, bool primary
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::locateValue" );
+
+	char		page[PAGE_SIZE];
+	gak::int64	pageNo;
+	size_t		slot;
+
+	// the primary fields are followed by other fields
+	STRING	key = searchFor;
+	if( primary )
+		key += ';';
+
+	locate( dataFileHandle, key, primary, false, page, &pageNo, &slot );
+	while( slot >= getNumSlots( page ) )
+	{
+		pageNo = getBinary<gak::int64>( page, NODE_NEXT_PAGE );
+		if( !pageNo )
+		{
+			*posFound = 0;
+/***/		return -1;
+		}
+		readPage( dataFileHandle, pageNo, page );
+		slot = 0;
+	}
+
+	size_t		keyLen;
+	const char	*entryKey = getEntryKey( page, slot, &keyLen );
+
+	*posFound = pageNo * gak::int64(PAGE_SIZE) + (getEntry( page, slot ) - page);
+	return compareKey( entryKey, keyLen, key, primary );
+}
+
+/*
+	collects the pages of every level, the deleted entries are removed
+	from the pages, so all entries are live
+*/
+void BTree::analyze( DbFile *dataFileHandle, TreeReport *report )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::analyze" );
+
+	TreeHeader	header;
+
+	report->clear();
+	readTreeHeader( dataFileHandle, &header );
+
+	report->formatVersion = fvBTree;
+	report->fileSize = dataFileHandle->getSize();
+	report->headerSize = gak::int64(PAGE_SIZE);
+	report->treeNodes = gak::uint64(header.numEntries);
+	report->maxDepth = header.height;
+	report->depthSum = gak::uint64(header.numEntries) * header.height;
+
+	char					page[PAGE_SIZE];
+	gak::Array<gak::int64>	pages;
+	size_t					levelStart = 0;
+
+	pages.addElement( header.rootPage );
+	while( levelStart < pages.size() )
+	{
+		TreeLevel		&level = report->levels.createElement();
+		const size_t	levelEnd = pages.size();
+
+		for( size_t i=levelStart; i<levelEnd; ++i )
+		{
+			const gak::int64	pageNo = pages[i];
+			readPage( dataFileHandle, pageNo, page );
+
+			const size_t	usedSize = getUsedSize( page );
+			report->usedBytes += usedSize;
+			report->freeBytes += PAGE_SIZE - usedSize;
+			level.nodes++;
+
+			const size_t	numSlots = getNumSlots( page );
+			if( !isLeaf( page ) )
+			{
+				for( size_t j=0; j<numSlots; ++j )
+					pages.addElement( getChild( page, j ) );
+/*^*/			continue;
+			}
+
+			// scans follow the links of the leaves
+			const gak::int64	nextPageNo = getBinary<gak::int64>( page, NODE_NEXT_PAGE );
+			if( nextPageNo )
+			{
+				const gak::uint64	distance = gak::uint64(
+					nextPageNo > pageNo ? nextPageNo - pageNo : pageNo - nextPageNo
+				) * PAGE_SIZE;
+
+				report->links++;
+				if( nextPageNo != pageNo+1 )
+					report->farLinks++;
+				report->distanceSum += distance;
+				if( distance > report->maxDistance )
+					report->maxDistance = distance;
+			}
+		}
+		levelStart = levelEnd;
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+void BTree::seekLast( DbFile *dataFileHandle )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::seekLast" );
+
+	TreeHeader	header;
+
+	readTreeHeader( dataFileHandle, &header );
+	m_pageNo = header.rootPage;
+	while( true )
+	{
+		readPage( dataFileHandle, m_pageNo, m_page );
+		if( isLeaf( m_page ) )
+/*v*/		break;
+
+		m_pageNo = getChild( m_page, getNumSlots( m_page )-1 );
+	}
+	m_slot = getNumSlots( m_page );
+	m_changeCount = dataFileHandle->getChangeCount();
+
+	dataFileHandle->countDescent( header.height );
+}
+
+/*
+	moves the cursor to the next entry, if it is behind the last entry of
+	its leaf. Empty leaves are skipped.
+*/
+bool BTree::skipForward( DbFile *dataFileHandle )
+{
+	while( m_slot >= getNumSlots( m_page ) )
+	{
+		const gak::int64	nextPageNo = getBinary<gak::int64>( m_page, NODE_NEXT_PAGE );
+		if( !nextPageNo )
+		{
+			m_pageNo = 0;
+/***/		return false;
+		}
+
+		readPage( dataFileHandle, nextPageNo, m_page );
+		m_pageNo = nextPageNo;
+		m_slot = 0;
+	}
+
+	return true;
+}
+
+/*
+	moves the cursor to the previous entry
+*/
+bool BTree::stepBack( DbFile *dataFileHandle )
+{
+	while( !m_slot )
+	{
+		const gak::int64	prevPageNo = getBinary<gak::int64>( m_page, NODE_PREV_PAGE );
+		if( !prevPageNo )
+		{
+			m_pageNo = 0;
+/***/		return false;
+		}
+
+		readPage( dataFileHandle, prevPageNo, m_page );
+		m_pageNo = prevPageNo;
+		m_slot = getNumSlots( m_page );
+	}
+
+	m_slot--;
+	return true;
+}
+
+void BTree::loadEntry( DbFile *dataFileHandle, Record *theRecord )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::loadEntry" );
+
+	const char		*entry = getEntry( m_page, m_slot );
+	const size_t	bufferLen = getBinary<gak::uint16>( entry, LEAF_BUFFER_LEN );
+	const size_t	lengthsLen = getBinary<gak::uint16>( entry, LEAF_LENGTHS_LEN );
+	RecordHeader	&theHeader = theRecord->m_theHeader;
+
+	theHeader.address = m_pageNo * gak::int64(PAGE_SIZE) + (entry - m_page);
+	theHeader.bufferLen = bufferLen;
+	theHeader.stringLengths = lengthsLen;
+	theHeader.primaryLen = getBinary<gak::uint16>( entry, LEAF_PRIMARY_LEN );
+	theHeader.status = 0;
+
+	m_key = makeString( entry + LEAF_HEADER, bufferLen - EOB_LEN );
+
+	theRecord->invalidatePath();
+	theRecord->m_theRecMode = rmBrowse;
+	if( theRecord->m_view )
+	{
+		theRecord->m_view->load(
+			dataFileHandle, theHeader.address + LEAF_HEADER,
+			bufferLen, lengthsLen, theHeader.numFields
+		);
+/***/	return;
+	}
+
+	gak::Buffer<char>	values( bufferLen+1 );
+	gak::Buffer<char>	lengths( lengthsLen+1 );
+
+	memcpy( values, entry + LEAF_HEADER, bufferLen );
+	values[bufferLen] = 0;
+	memcpy( lengths, entry + LEAF_HEADER + bufferLen, lengthsLen );
+	lengths[lengthsLen] = 0;
+
+	theRecord->loadValues( values, lengths );
+}
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	inserts the current values of theRecord. Full pages are split, the
+	inner pages count the new entry.
+*/
+void BTree::postRecord( DbFile *dataFileHandle, Record *theRecord )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::postRecord" );
+
+	STRING	theValues, theStringLengths;
+
+	theRecord->getRecord( &theValues, false, &theStringLengths );
+	theStringLengths += ";EOB";
+
+	TreeHeader	header;
+	readTreeHeader( dataFileHandle, &header );
+
+	// create the unique node id
+	theValues += gak::formatBinary( header.nextEntryId++, 16, NODE_ID_LEN, '0' );
+	const STRING	key = theValues;
+	theValues += ";EOB";
+
+	char			entry[MAX_ENTRY_SIZE];
+	const size_t	entryLen = makeLeafEntry(
+		entry, theValues, theStringLengths, theRecord->m_theHeader.primaryLen,
+		dataFileHandle
+	);
+
+	char		page[PAGE_SIZE];
+	gak::int64	pageNo;
+	size_t		slot;
+	Path		path;
+
+	locate( dataFileHandle, key, false, true, page, &pageNo, &slot, &path );
+
+	gak::int64	rightPageNo = 0, rightCount = 0;
+	STRING		separator;
+
+	if( insertEntry( page, slot, entry, entryLen ) )
+		writePage( dataFileHandle, pageNo, page );
+	else
+		splitPage(
+			dataFileHandle, &header, page, pageNo, slot, entry, entryLen,
+			&rightPageNo, &rightCount, &separator
+		);
+
+	// the parents count the new entry or get the new page
+	for( size_t level = path.size()-1; level-- > 0; )
+	{
+		const PathItem		&item = path[level];
+		const gak::int64	leftCount = rightPageNo ? getPageCount( page ) : 0;
+
+		readPage( dataFileHandle, item.pageNo, page );
+		if( !rightPageNo )
+		{
+			setChildCount( page, item.slot, getChildCount( page, item.slot )+1 );
+			writePage( dataFileHandle, item.pageNo, page );
+/*^*/		continue;
+		}
+
+		const size_t	innerLen = makeInnerEntry( entry, rightPageNo, rightCount, separator );
+
+		setChildCount( page, item.slot, leftCount );
+		rightPageNo = 0;
+		if( insertEntry( page, item.slot+1, entry, innerLen ) )
+			writePage( dataFileHandle, item.pageNo, page );
+		else
+			splitPage(
+				dataFileHandle, &header, page, item.pageNo, item.slot+1, entry, innerLen,
+				&rightPageNo, &rightCount, &separator
+			);
+	}
+
+	// the root has been split, the tree grows
+	if( rightPageNo )
+	{
+		const gak::int64	leftCount = getPageCount( page );
+
+		initPage( page, 0 );
+		appendEntry( page, entry, makeInnerEntry( entry, header.rootPage, leftCount, "" ) );
+		appendEntry( page, entry, makeInnerEntry( entry, rightPageNo, rightCount, separator ) );
+
+		header.rootPage = header.numPages++;
+		header.height++;
+		writePage( dataFileHandle, header.rootPage, page );
+	}
+
+	header.numEntries++;
+	writeTreeHeader( dataFileHandle, header );
+
+	m_key = key;
+	m_pageNo = 0;
+	theRecord->m_theRecMode = rmBrowse;
+}
+
+/*
+	removes the current entry. Empty leaves remain in the tree, the
+	cursors skip them.
+*/
+void BTree::deleteRecord( DbFile *dataFileHandle, Record *theRecord, bool noMove )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::deleteRecord" );
+
+	char		page[PAGE_SIZE];
+	gak::int64	pageNo;
+	size_t		slot, keyLen;
+	Path		path;
+
+	locate( dataFileHandle, m_key, false, true, page, &pageNo, &slot, &path );
+	if( !slot )
+		throw DBillegalRecordHeader( dataFileHandle->getFileName() );
+
+	const char	*entryKey = getEntryKey( page, slot-1, &keyLen );
+	if( compareKey( entryKey, keyLen, m_key, false ) )
+		throw DBillegalRecordHeader( dataFileHandle->getFileName() );
+
+	removeEntry( page, slot-1 );
+	writePage( dataFileHandle, pageNo, page );
+
+	for( size_t level = path.size()-1; level-- > 0; )
+	{
+		const PathItem	&item = path[level];
+
+		readPage( dataFileHandle, item.pageNo, page );
+		setChildCount( page, item.slot, getChildCount( page, item.slot )-1 );
+		writePage( dataFileHandle, item.pageNo, page );
+	}
+
+	TreeHeader	header;
+	readTreeHeader( dataFileHandle, &header );
+	header.numEntries--;
+	writeTreeHeader( dataFileHandle, header );
+
+	if( !noMove )
+	{
+		nextRecord( dataFileHandle, theRecord );
+		if( theRecord->m_theRecMode == rmEof )
+			prevRecord( dataFileHandle, theRecord );
+	}
+}
+
+/*
+	loads the entry at position, the position must come from a lookup
+	after the last write
+*/
+void BTree::readRecord( DbFile *dataFileHandle, Record *theRecord, gak::int64 position )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::readRecord" );
+
+	const size_t	offset = size_t(position % gak::int64(PAGE_SIZE));
+
+	m_pageNo = position / gak::int64(PAGE_SIZE);
+	readPage( dataFileHandle, m_pageNo, m_page );
+	m_changeCount = dataFileHandle->getChangeCount();
+
+	const size_t	numSlots = getNumSlots( m_page );
+	for( m_slot = 0; m_slot < numSlots; ++m_slot )
+	{
+		if( getEntry( m_page, m_slot ) == m_page + offset )
+/*v*/		break;
+	}
+	if( !isLeaf( m_page ) || m_slot >= numSlots )
+		throw DBillegalRecordHeader( dataFileHandle->getFileName() );
+
+	loadEntry( dataFileHandle, theRecord );
+}
+
+/*
+	searches the first entry starting with prefix
+*/
+bool BTree::locateEntry( DbFile *dataFileHandle, Record *theRecord, const STRING &prefix )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::locateEntry" );
+
+	seek( dataFileHandle, prefix, true, false );
+	if( !skipForward( dataFileHandle ) )
+/***/	return false;
+
+	size_t		keyLen;
+	const char	*entryKey = getEntryKey( m_page, m_slot, &keyLen );
+	if( compareKey( entryKey, keyLen, prefix, true ) )
+/***/	return false;
+
+	loadEntry( dataFileHandle, theRecord );
+	return true;
+}
+
+/*
+	the inner entries count the entries of their subtrees, so one descent
+	finds the entry with the given rank
+*/
+bool BTree::seekToRank( DbFile *dataFileHandle, Record *theRecord, gak::int64 rank )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::seekToRank" );
+
+	TreeHeader	header;
+	readTreeHeader( dataFileHandle, &header );
+
+	if( rank < 0 || rank >= header.numEntries )
+	{
+		theRecord->m_theRecMode = rank < 0 ? rmBof : rmEof;
+/***/	return false;
+	}
+
+	m_pageNo = header.rootPage;
+	while( true )
+	{
+		readPage( dataFileHandle, m_pageNo, m_page );
+		if( isLeaf( m_page ) )
+/*v*/		break;
+
+		const size_t	numSlots = getNumSlots( m_page );
+		size_t			slot = 0;
+		while( slot+1 < numSlots && rank >= getChildCount( m_page, slot ) )
+			rank -= getChildCount( m_page, slot++ );
+
+		m_pageNo = getChild( m_page, slot );
+	}
+	dataFileHandle->countDescent( header.height );
+
+	m_slot = size_t(rank);
+	m_changeCount = dataFileHandle->getChangeCount();
+	if( m_slot >= getNumSlots( m_page ) )
+		throw DBillegalRecordHeader( dataFileHandle->getFileName() );
+
+	loadEntry( dataFileHandle, theRecord );
+	return true;
+}
+
+gak::int64 BTree::getRank( DbFile *dataFileHandle ) const
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::getRank" );
+
+	char		page[PAGE_SIZE];
+	gak::int64	pageNo;
+	size_t		slot;
+
+	return locate( dataFileHandle, m_key, false, false, page, &pageNo, &slot );
+}
+
+void BTree::firstRecord( DbFile *dataFileHandle, Record *theRecord, const KeyRange &range )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::firstRecord" );
+
+	theRecord->m_range = range;
+	seek( dataFileHandle, range.lower, true, range.lower[0U] && !range.lowerInclusive );
+	if( !skipForward( dataFileHandle ) )
+	{
+		theRecord->m_theRecMode = rmEof;
+/***/	return;
+	}
+
+	loadEntry( dataFileHandle, theRecord );
+	if( !theRecord->isBelowUpper() )
+		theRecord->m_theRecMode = rmEof;
+}
+
+void BTree::nextRecord( DbFile *dataFileHandle, Record *theRecord )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::nextRecord" );
+
+	// after a write we search the successor of the current key
+	if( isValid( dataFileHandle ) )
+		m_slot++;
+	else
+		seek( dataFileHandle, m_key, false, theRecord->m_theRecMode != rmBof );
+
+	if( !skipForward( dataFileHandle ) )
+	{
+		theRecord->m_theRecMode = rmEof;
+/***/	return;
+	}
+
+	loadEntry( dataFileHandle, theRecord );
+	if( !theRecord->isBelowUpper() )
+		theRecord->m_theRecMode = rmEof;
+}
+
+void BTree::prevRecord( DbFile *dataFileHandle, Record *theRecord )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::prevRecord" );
+
+	if( !isValid( dataFileHandle ) )
+		seek( dataFileHandle, m_key, false, theRecord->m_theRecMode == rmEof );
+
+	if( !stepBack( dataFileHandle ) )
+	{
+		theRecord->m_theRecMode = rmBof;
+/***/	return;
+	}
+
+	loadEntry( dataFileHandle, theRecord );
+	if( !theRecord->isAboveLower() )
+		theRecord->m_theRecMode = rmBof;
+}
+
+void BTree::lastRecord( DbFile *dataFileHandle, Record *theRecord, const KeyRange &range )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTree::lastRecord" );
+
+	theRecord->m_range = range;
+	if( range.upper[0U] )
+		seek( dataFileHandle, range.upper, true, range.upperInclusive );
+	else
+		seekLast( dataFileHandle );
+
+	if( !stepBack( dataFileHandle ) )
+	{
+		theRecord->m_theRecMode = rmBof;
+/***/	return;
+	}
+
+	loadEntry( dataFileHandle, theRecord );
+	if( !theRecord->isAboveLower() )
+		theRecord->m_theRecMode = rmBof;
+}
+
+void BTreeWriter::addEntry(
+	const STRING &values, const STRING &lengths, gak::uint64 primaryLen
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTreeWriter::addEntry" );
+
+	// create the unique node id
+	STRING	theValues = values;
+	theValues += gak::formatBinary( m_nextEntryId++, 16, NODE_ID_LEN, '0' );
+	theValues += ";EOB";
+
+	char			entry[BTree::MAX_ENTRY_SIZE];
+	const size_t	entryLen = makeLeafEntry( entry, theValues, lengths, primaryLen, m_target );
+
+	if( !appendEntry( m_page, entry, entryLen, FILL_LIMIT ) )
+	{
+		writeLeaf( m_pageNo+1 );
+		initPage( m_page, NODE_LEAF );
+		putBinary<gak::int64>( m_page, NODE_PREV_PAGE, m_pageNo++ );
+		appendEntry( m_page, entry, entryLen );
+	}
+	m_numEntries++;
+}
+
+/*
+	writes the last leaf and the inner pages
+*/
+void BTreeWriter::finish()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BTreeWriter::finish" );
+
+	writeLeaf( 0 );
+
+	BTree::TreeHeader	header;
+	header.numPages = m_pageNo+1;
+	header.numEntries = m_numEntries;
+	header.nextEntryId = m_nextEntryId;
+	header.height = 1;
+
+	while( m_children.size() > 1 )
+	{
+		writeLevel( &header.numPages );
+		header.height++;
+	}
+	header.rootPage = m_children[0].pageNo;
+
+	BTree::writeTreeHeader( m_target, header );
+}
+
+void BTreeWriter::writeLeaf( gak::int64 nextPage )
+{
+	putBinary<gak::int64>( m_page, NODE_NEXT_PAGE, nextPage );
+	BTree::writePage( m_target, m_pageNo, m_page );
+
+	Child	&child = m_children.createElement();
+	child.pageNo = m_pageNo;
+	child.count = gak::int64(getNumSlots( m_page ));
+	if( child.count )
+	{
+		size_t		keyLen;
+		const char	*key = getEntryKey( m_page, 0, &keyLen );
+
+		child.key = makeString( key, keyLen );
+	}
+}
+
+/*
+	writes the inner pages above m_children, they become the new children
+*/
+void BTreeWriter::writeLevel( gak::int64 *numPages )
+{
+	char		page[BTree::PAGE_SIZE];
+	char		entry[BTree::MAX_ENTRY_SIZE];
+	Children	parents;
+
+	for( size_t i=0; i<m_children.size(); ++i )
+	{
+		const Child		&child = m_children[i];
+		const size_t	entryLen = makeInnerEntry( entry, child.pageNo, child.count, child.key );
+
+		if( !parents.size() || !appendEntry( page, entry, entryLen, FILL_LIMIT ) )
+		{
+			if( parents.size() )
+				BTree::writePage( m_target, parents[parents.size()-1].pageNo, page );
+
+			initPage( page, 0 );
+			appendEntry( page, entry, entryLen );
+
+			Child	&parent = parents.createElement();
+			parent.pageNo = (*numPages)++;
+			parent.count = 0;
+			parent.key = child.key;
+		}
+		parents[parents.size()-1].count += child.count;
+	}
+	BTree::writePage( m_target, parents[parents.size()-1].pageNo, page );
+
+	m_children.clear();
+	for( size_t i=0; i<parents.size(); ++i )
+		m_children.addElement( parents[i] );
+}
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
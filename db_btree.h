@@ -0,0 +1,295 @@
+/*
+		Project:		dbLIB
+		Module:			db_btree.h
+		Description:	Page structured B+tree for index files
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+#ifndef DB_BTREE_H
+#define DB_BTREE_H
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <gak/types.h>
+#include <gak/array.h>
+#include <gak/string.h>
+
+#include "db_file_io.h"
+#include "db_buffer_pool.h"
+#include "record.h"
+#include "db_tree_analyzer.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	an index file stored as a B+tree (fvBTree). Every node is one page of
+	the buffer pool, so a lookup reads one page per level. The leaves hold
+	the entries in key order and are linked in both directions. Page 0 is
+	the file header.
+
+	The entries have the same layout as the values and the lengths of a
+	record, so they are loaded like records. Positions of entries are only
+	valid until the next write, because pages are split and compacted.
+*/
+class BTree
+{
+	friend class BTreeWriter;
+
+	public:
+	static const size_t	PAGE_SIZE = BufferPool::PAGE_SIZE;
+
+	/*
+		a page holds four entries at least, so splits always succeed
+	*/
+	static const size_t	MAX_ENTRY_SIZE = 1000;
+
+	private:
+	struct PathItem
+	{
+		gak::int64	pageNo;
+		size_t		slot;
+	};
+	typedef gak::Array<PathItem>	Path;
+
+	struct TreeHeader
+	{
+		gak::int64	rootPage, numPages, numEntries;
+		gak::uint64	nextEntryId;
+		gak::uint32	height;
+	};
+
+	/*
+		the cursor: the current leaf is kept as a copy, until the file is
+		changed. After a change the cursor searches its key again.
+	*/
+	gak::int64		m_pageNo;
+	size_t			m_slot;
+	gak::STRING		m_key;
+	gak::uint64		m_changeCount;
+	char			m_page[PAGE_SIZE];
+
+	static void readPage( DbFile *dataFileHandle, gak::int64 pageNo, char *page );
+	static void writePage( DbFile *dataFileHandle, gak::int64 pageNo, const char *page );
+	static void readTreeHeader( DbFile *dataFileHandle, TreeHeader *header );
+	static void writeTreeHeader( DbFile *dataFileHandle, const TreeHeader &header );
+
+	static gak::int64 locate(
+		DbFile *dataFileHandle, const gak::STRING &key, bool prefixOnly, bool strict,
+		char *page, gak::int64 *pageNo, size_t *slot, Path *path=NULL
+	);
+	static void splitPage(
+		DbFile *dataFileHandle, TreeHeader *header,
+		char *page, gak::int64 pageNo, size_t slot, const char *entry, size_t entryLen,
+		gak::int64 *rightPageNo, gak::int64 *rightCount, gak::STRING *separator
+	);
+
+	void seek(
+		DbFile *dataFileHandle, const gak::STRING &key, bool prefixOnly, bool strict
+	)
+	{
+		locate( dataFileHandle, key, prefixOnly, strict, m_page, &m_pageNo, &m_slot );
+		m_changeCount = dataFileHandle->getChangeCount();
+	}
+	void seekLast( DbFile *dataFileHandle );
+	bool isValid( const DbFile *dataFileHandle ) const
+	{
+		return m_pageNo && m_changeCount == dataFileHandle->getChangeCount();
+	}
+	bool skipForward( DbFile *dataFileHandle );
+	bool stepBack( DbFile *dataFileHandle );
+	void loadEntry( DbFile *dataFileHandle, Record *theRecord );
+
+	public:
+	BTree()
+	{
+		m_pageNo = 0;
+		m_slot = 0;
+		m_changeCount = 0;
+	}
+
+	static void create( DbFile *dataFileHandle );
+	static gak::int64 getNumEntries( DbFile *dataFileHandle );
+	static gak::int64 countLess(
+		DbFile *dataFileHandle, const gak::STRING &searchFor, bool orEqual
+	);
+	static int locateValue(
+		DbFile *dataFileHandle, gak::int64 *posFound,
+		const gak::STRING &searchFor, bool primary
+	);
+	static void analyze( DbFile *dataFileHandle, TreeReport *report );
+
+	void postRecord( DbFile *dataFileHandle, Record *theRecord );
+	void deleteRecord( DbFile *dataFileHandle, Record *theRecord, bool noMove );
+	void readRecord( DbFile *dataFileHandle, Record *theRecord, gak::int64 position );
+	bool locateEntry( DbFile *dataFileHandle, Record *theRecord, const gak::STRING &prefix );
+	bool seekToRank( DbFile *dataFileHandle, Record *theRecord, gak::int64 rank );
+	gak::int64 getRank( DbFile *dataFileHandle ) const;
+
+	/*
+	 * cursor loop
+	 */
+	void firstRecord( DbFile *dataFileHandle, Record *theRecord, const KeyRange &range );
+	void nextRecord( DbFile *dataFileHandle, Record *theRecord );
+	void prevRecord( DbFile *dataFileHandle, Record *theRecord );
+	void lastRecord( DbFile *dataFileHandle, Record *theRecord, const KeyRange &range );
+};
+
+/*
+	writes a new B+tree from entries in key order. The leaves are written
+	first and in key order, so scans read the file sequentially. The inner
+	pages follow, the root is the last page.
+*/
+class BTreeWriter
+{
+	struct Child
+	{
+		gak::int64	pageNo, count;
+		gak::STRING	key;
+	};
+	typedef gak::Array<Child>	Children;
+
+	DbFile			*m_target;
+	char			m_page[BTree::PAGE_SIZE];
+	gak::int64		m_pageNo, m_numEntries;
+	gak::uint64		m_nextEntryId;
+	Children		m_children;
+
+	void writeLeaf( gak::int64 nextPage );
+	void writeLevel( gak::int64 *numPages );
+
+	public:
+	BTreeWriter( DbFile *target );
+
+	void addEntry(
+		const gak::STRING &values, const gak::STRING &lengths, gak::uint64 primaryLen
+	);
+	void finish();
+};
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
+#endif
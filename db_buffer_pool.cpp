@@ -0,0 +1,470 @@
+/*
+		Project:		dbLIB
+		Module:			db_buffer_pool.cpp
+		Description:	the shared page cache for all table files
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_buffer_pool.h"
+#include "db_file_io.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+BufferPool::BufferPool()
+{
+	m_maxFrames = DEFAULT_BUDGET / PAGE_SIZE;
+	m_clockHand = 0;
+}
+
+BufferPool::~BufferPool()
+{
+	for( size_t i=0; i<m_frames.size(); ++i )
+		free( m_frames[i].data );
+}
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+BufferPool &BufferPool::getPool()
+{
+	static BufferPool	thePool;
+
+	return thePool;
+}
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+size_t BufferPool::addFrame()
+{
+	size_t	frameIdx = m_frames.size();
+
+	Frame	&newFrame = m_frames.createElement();
+	newFrame.data = static_cast<char *>(malloc( PAGE_SIZE ));
+	if( !newFrame.data )
+	{
+		m_frames.removeElementAt( frameIdx );
+		throw DBmemoryException( "Buffer Pool" );
+	}
+	newFrame.file = NULL;
+	newFrame.pinCount = 0;
+	newFrame.holdCount = 0;
+	newFrame.loading = false;
+
+	return frameIdx;
+}
+
+/*
+	CLOCK: walk around the frames, give every referenced page a second
+	chance and take the first unpinned page that was not referenced since
+	the last round. The old page of the victim is still in the page table,
+	pinPage writes it back, if it is dirty.
+	If all pages are pinned by open transactions, the pool grows beyond the
+	budget. The frames above the budget are dropped by the next
+	setMemoryBudget.
+*/
+size_t BufferPool::findVictim()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BufferPool::findVictim" );
+
+	const size_t	numFrames = m_frames.size();
+
+	for( size_t i=0; i<2*numFrames; ++i )
+	{
+		size_t	frameIdx = m_clockHand;
+		Frame	&frame = m_frames[frameIdx];
+
+		m_clockHand = (m_clockHand+1) % numFrames;
+		if( frame.pinCount )
+/*^*/		continue;
+
+		if( !frame.file || !frame.referenced )
+/***/		return frameIdx;
+
+		frame.referenced = false;
+	}
+
+	return addFrame();
+}
+
+/*
+	pages held by a transaction contain uncommitted data, they remain
+	dirty in the pool until the commit.
+	The page is written without the mutex, it stays pinned meanwhile.
+*/
+void BufferPool::writeBack( std::unique_lock<std::mutex> &lock, size_t frameIdx )
+{
+	Frame	&frame = m_frames[frameIdx];
+
+	if( !frame.dirty || frame.holdCount )
+/***/	return;
+
+	DbFile		*file = frame.file;
+	gak::int64	pageNo = frame.pageNo;
+	const char	*data = frame.data;
+
+	frame.pinCount++;
+	frame.loading = true;
+	frame.dirty = false;
+	lock.unlock();
+
+	try
+	{
+		file->writePage( pageNo, data );
+	}
+	catch( ... )
+	{
+		lock.lock();
+		m_frames[frameIdx].dirty = true;
+		endLoading( frameIdx );
+		m_frames[frameIdx].pinCount--;
+		throw;
+	}
+
+	lock.lock();
+	endLoading( frameIdx );
+	m_frames[frameIdx].pinCount--;
+}
+
+/*
+	forgets the page of a frame, that is not dirty
+*/
+void BufferPool::releaseFrame( size_t frameIdx )
+{
+	Frame	&frame = m_frames[frameIdx];
+
+	if( frame.file )
+	{
+		PageKey	key = { frame.file, frame.pageNo };
+		m_pageTable.erase( key );
+		frame.file = NULL;
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+void BufferPool::setMemoryBudget( size_t numBytes )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BufferPool::setMemoryBudget" );
+
+	std::unique_lock<std::mutex>	lock( m_mutex );
+
+	size_t	maxFrames = numBytes / PAGE_SIZE;
+	if( maxFrames < MIN_FRAMES )
+		maxFrames = MIN_FRAMES;
+
+	// drop the frames above the new limit, if they are not in use
+	while( m_frames.size() > maxFrames && !m_frames[m_frames.size()-1].pinCount )
+	{
+		size_t	frameIdx = m_frames.size()-1;
+
+		// another thread may use the frame, while it is written
+		if( m_frames[frameIdx].dirty )
+		{
+			writeBack( lock, frameIdx );
+/*^*/		continue;
+		}
+
+		releaseFrame( frameIdx );
+		free( m_frames[frameIdx].data );
+		m_frames.removeElementAt( frameIdx );
+	}
+	m_maxFrames = maxFrames;
+	m_clockHand = 0;
+}
+
+size_t BufferPool::pinPage( DbFile *file, gak::int64 pageNo )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BufferPool::pinPage" );
+
+	std::unique_lock<std::mutex>	lock( m_mutex );
+
+	const PageKey		key = { file, pageNo };
+	PageTable::iterator	it;
+
+	while( (it = m_pageTable.find( key )) != m_pageTable.end() )
+	{
+		const size_t	frameIdx = it->second;
+
+		// another thread reads the page or writes the old page of the frame
+		m_frames[frameIdx].pinCount++;
+		while( m_frames[frameIdx].loading )
+			m_loaded.wait( lock );
+
+		Frame	&frame = m_frames[frameIdx];
+		if( frame.file == file && frame.pageNo == pageNo )
+		{
+			file->count( scCacheHits );
+			frame.referenced = true;
+/***/		return frameIdx;
+		}
+		frame.pinCount--;
+	}
+
+	file->count( scCacheMisses );
+
+	const size_t	frameIdx = m_frames.size() < m_maxFrames ? addFrame() : findVictim();
+	Frame			&frame = m_frames[frameIdx];
+	DbFile			*oldFile = frame.dirty ? frame.file : NULL;
+	const PageKey	oldKey = { frame.file, frame.pageNo };
+	char			*data = frame.data;
+
+	/*
+		the frame is reserved for the new page. A dirty old page remains in
+		the page table, until it is on the disk, so nobody reads it from
+		the disk before.
+	*/
+	if( frame.file && !oldFile )
+		m_pageTable.erase( oldKey );
+	frame.file = file;
+	frame.pageNo = pageNo;
+	frame.dirty = false;
+	frame.referenced = true;
+	frame.loading = true;
+	frame.pinCount++;
+	m_pageTable[key] = frameIdx;
+	lock.unlock();
+
+	bool	written = false;
+	try
+	{
+		if( oldFile )
+			oldFile->writePage( oldKey.pageNo, data );
+		written = true;
+		file->readPage( pageNo, data );
+	}
+	catch( ... )
+	{
+		lock.lock();
+
+		Frame	&failed = m_frames[frameIdx];
+
+		m_pageTable.erase( key );
+		if( oldFile && !written )
+		{
+			// the old page is still in the frame
+			failed.file = oldFile;
+			failed.pageNo = oldKey.pageNo;
+			failed.dirty = true;
+		}
+		else
+		{
+			if( oldFile )
+				m_pageTable.erase( oldKey );
+			failed.file = NULL;
+		}
+		failed.pinCount--;
+		endLoading( frameIdx );
+		throw;
+	}
+
+	lock.lock();
+	if( oldFile )
+		m_pageTable.erase( oldKey );
+	endLoading( frameIdx );
+
+	return frameIdx;
+}
+
+void BufferPool::unpinPage( size_t frameIdx, bool dirty )
+{
+	std::lock_guard<std::mutex>	lock( m_mutex );
+
+	Frame	&frame = m_frames[frameIdx];
+
+	assert( frame.pinCount > 0 );
+	frame.pinCount--;
+	if( dirty )
+		frame.dirty = true;
+}
+
+/*
+	keeps a pinned page for a transaction. The page is neither replaced
+	nor written, until releasePage removes the pin.
+*/
+void BufferPool::holdPage( size_t frameIdx )
+{
+	std::lock_guard<std::mutex>	lock( m_mutex );
+
+	Frame	&frame = m_frames[frameIdx];
+
+	assert( frame.pinCount > frame.holdCount );
+	frame.holdCount++;
+}
+
+void BufferPool::releasePage( size_t frameIdx )
+{
+	std::lock_guard<std::mutex>	lock( m_mutex );
+
+	Frame	&frame = m_frames[frameIdx];
+
+	assert( frame.holdCount > 0 );
+	frame.holdCount--;
+	frame.pinCount--;
+	frame.dirty = true;
+}
+
+void BufferPool::flushFile( const DbFile *file )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BufferPool::flushFile" );
+
+	std::unique_lock<std::mutex>	lock( m_mutex );
+
+	for( size_t i=0; i<m_frames.size(); ++i )
+	{
+		// the frame may replace a dirty page of the file right now
+		while( m_frames[i].loading )
+			m_loaded.wait( lock );
+
+		if( m_frames[i].file == file )
+			writeBack( lock, i );
+	}
+}
+
+/*
+	forgets all pages of a file without writing them
+*/
+void BufferPool::discardFile( const DbFile *file )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BufferPool::discardFile" );
+
+	std::lock_guard<std::mutex>	lock( m_mutex );
+
+	for( size_t i=0; i<m_frames.size(); ++i )
+	{
+		Frame	&frame = m_frames[i];
+		if( frame.file == file )
+		{
+			assert( !frame.pinCount );
+
+			PageKey	key = { frame.file, frame.pageNo };
+			m_pageTable.erase( key );
+			frame.file = NULL;
+			frame.dirty = false;
+		}
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
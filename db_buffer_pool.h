@@ -0,0 +1,246 @@
+/*
+		Project:		dbLIB
+		Module:			db_buffer_pool.h
+		Description:	the shared page cache for all table files
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+#ifndef DB_BUFFER_POOL_H
+#define DB_BUFFER_POOL_H
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <stddef.h>
+
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+
+#include <gak/types.h>
+#include <gak/array.h>
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+class DbFile;
+
+/*
+	All table files share one cache of fixed size pages. Pages are located
+	by file and page number and replaced with the CLOCK algorithm. A pinned
+	page is never replaced, a dirty page is written back before it is
+	replaced or when its file is flushed.
+*/
+class BufferPool
+{
+	public:
+	static const size_t	PAGE_SIZE = 4096;
+	static const size_t	DEFAULT_BUDGET = 16*1024*1024;
+	static const size_t	MIN_FRAMES = 16;
+
+	private:
+	struct PageKey
+	{
+		const DbFile	*file;
+		gak::int64		pageNo;
+
+		bool operator == ( const PageKey &other ) const
+		{
+			return file == other.file && pageNo == other.pageNo;
+		}
+	};
+	struct PageKeyHash
+	{
+		size_t operator () ( const PageKey &key ) const
+		{
+			return size_t(key.file) ^ size_t(key.pageNo * 0x9E3779B97F4A7C15ULL);
+		}
+	};
+	struct Frame
+	{
+		DbFile		*file;
+		gak::int64	pageNo;
+		char		*data;
+		int			pinCount;
+		int			holdCount;		// pins of open transactions
+		bool		dirty;
+		bool		referenced;
+		bool		loading;		// the io runs outside the mutex
+	};
+	typedef std::unordered_map<PageKey, size_t, PageKeyHash>	PageTable;
+
+	gak::Array<Frame>	m_frames;
+	PageTable			m_pageTable;
+	size_t				m_maxFrames;
+	size_t				m_clockHand;
+
+	/*
+		the tables read their files with positional io and may do that
+		from several threads. The mutex protects the frames and the page table.
+		The disk io runs without the mutex, threads that need a loading
+		frame wait for m_loaded.
+	*/
+	std::mutex			m_mutex;
+	std::condition_variable	m_loaded;
+
+	BufferPool();
+	~BufferPool();
+
+	size_t addFrame();
+	size_t findVictim();
+	void writeBack( std::unique_lock<std::mutex> &lock, size_t frameIdx );
+	void releaseFrame( size_t frameIdx );
+	void endLoading( size_t frameIdx )
+	{
+		m_frames[frameIdx].loading = false;
+		m_loaded.notify_all();
+	}
+
+	public:
+	static BufferPool &getPool();
+
+	void setMemoryBudget( size_t numBytes );
+	size_t getMemoryBudget() const
+	{
+		return m_maxFrames * PAGE_SIZE;
+	}
+
+	size_t pinPage( DbFile *file, gak::int64 pageNo );
+	char *getPageData( size_t frameIdx )
+	{
+		std::lock_guard<std::mutex>	lock( m_mutex );
+		return m_frames[frameIdx].data;
+	}
+	void unpinPage( size_t frameIdx, bool dirty );
+	void holdPage( size_t frameIdx );
+	void releasePage( size_t frameIdx );
+
+	void flushFile( const DbFile *file );
+	void discardFile( const DbFile *file );
+};
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
+#endif
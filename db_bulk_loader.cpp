@@ -0,0 +1,477 @@
+/*
+		Project:		dbLIB
+		Module:			db_bulk_loader.cpp
+		Description:	Bulk loading of sorted trees
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <algorithm>
+
+#include <gak/stdlib.h>
+#include <gak/numericString.h>
+
+#include "db_bulk_loader.h"
+#include "index.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+using gak::STRING;
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+BulkLoader::BulkLoader(
+	DbFile *dataFileHandle, const STRING &targetName, size_t memoryBudget
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BulkLoader::BulkLoader" );
+
+	m_dataFileHandle = dataFileHandle;
+	m_targetName = targetName;
+	m_memoryBudget = memoryBudget;
+	m_memoryUsed = 0;
+	m_numFields = 0;
+	m_nextRow = 0;
+	m_rowIdx = 0;
+
+	strRemove( m_targetName );
+	m_target.open( m_targetName );
+
+	m_formatVersion = dataFileHandle->getFormatVersion();
+	if( m_formatVersion != fvBTree && m_formatVersion != fvSplitHeap )
+		m_formatVersion = fvCurrent;
+
+	m_writer = nullptr;
+	if( m_formatVersion == fvBTree )
+		m_writer = new BTreeWriter( &m_target );
+	else
+		writeTableHeader( &m_target, m_formatVersion );
+
+	if( m_formatVersion == fvSplitHeap )
+	{
+		m_targetHeapName = m_targetName + ".heap";
+		strRemove( m_targetHeapName );
+		m_targetHeap.open( m_targetHeapName );
+		m_target.setHeapFile( &m_targetHeap );
+	}
+}
+
+BulkLoader::~BulkLoader()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BulkLoader::~BulkLoader" );
+
+	delete m_writer;
+	for( size_t i=0; i<m_runs.size(); ++i )
+	{
+		RunFile	*run = m_runs[i];
+		run->file.close();
+		strRemove( run->fileName );
+		delete run;
+	}
+
+	// an unfinished target is useless
+	if( m_target.isOpen() )
+	{
+		m_target.close();
+		strRemove( m_targetName );
+	}
+	if( m_targetHeap.isOpen() )
+	{
+		m_targetHeap.close();
+		strRemove( m_targetHeapName );
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+/*
+	writes the rows in memory as a sorted run. Every row is stored as three
+	strings terminated by 0: the values, the lengths and the primary length
+*/
+void BulkLoader::spillRows()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BulkLoader::spillRows" );
+
+	Row	*rows = m_rows.getDataBuffer();
+	std::sort( rows, rows + m_rows.size() );
+
+	RunFile	*run = new RunFile;
+	run->fileName = m_targetName + ".run" + gak::formatNumber( m_runs.size() );
+	m_runs.addElement( run );
+
+	strRemove( run->fileName );
+	run->file.open( run->fileName );
+
+	gak::int64	position = 0;
+	for( size_t i=0; i<m_rows.size(); ++i )
+	{
+		const Row	&row = m_rows[i];
+		STRING		primaryLen = gak::formatBinary( row.primaryLen, 16 );
+
+		position += run->file.write( position, row.values, strlen( row.values )+1 );
+		position += run->file.write( position, row.lengths, strlen( row.lengths )+1 );
+		position += run->file.write( position, primaryLen, strlen( primaryLen )+1 );
+	}
+
+	m_rows.clear();
+	m_memoryUsed = 0;
+}
+
+bool BulkLoader::readString( RunFile *run, STRING *result )
+{
+	*result = "";
+	while( true )
+	{
+		if( run->bufferPos >= run->bufferLen )
+		{
+			long	readLen = run->file.read( run->position, run->buffer, RUN_BUFFER_SIZE );
+			if( readLen <= 0 )
+/***/			return false;
+
+			run->position += readLen;
+			run->bufferLen = size_t(readLen);
+			run->bufferPos = 0;
+			run->buffer[readLen] = 0;
+		}
+
+		const char	*start = run->buffer + run->bufferPos;
+		const char	*end = static_cast<const char *>(
+			memchr( start, 0, run->bufferLen - run->bufferPos )
+		);
+		if( end )
+		{
+			*result += start;
+			run->bufferPos += end - start + 1;
+/***/		return true;
+		}
+
+		*result += start;
+		run->bufferPos = run->bufferLen;
+	}
+}
+
+bool BulkLoader::readRun( RunFile *run )
+{
+	STRING	primaryLen;
+
+	run->valid = readString( run, &run->current.values )
+		&& readString( run, &run->current.lengths )
+		&& readString( run, &primaryLen );
+	if( run->valid )
+		run->current.primaryLen = primaryLen.getValueN<gak::uint64>( 16 );
+
+	return run->valid;
+}
+
+void BulkLoader::rewind()
+{
+	m_nextRow = 0;
+	for( size_t i=0; i<m_runs.size(); ++i )
+	{
+		RunFile	*run = m_runs[i];
+		run->position = 0;
+		run->bufferLen = run->bufferPos = 0;
+		readRun( run );
+	}
+}
+
+/*
+	fetches the next row in key order to m_currentRow
+*/
+bool BulkLoader::nextRow()
+{
+	if( !m_runs.size() )
+	{
+		if( m_nextRow >= m_rows.size() )
+/***/		return false;
+
+		m_currentRow = m_rows[m_nextRow++];
+/***/	return true;
+	}
+
+	RunFile	*best = NULL;
+	for( size_t i=0; i<m_runs.size(); ++i )
+	{
+		RunFile	*run = m_runs[i];
+		if( run->valid && (!best || run->current < best->current) )
+			best = run;
+	}
+	if( !best )
+/***/	return false;
+
+	m_currentRow = best->current;
+	readRun( best );
+
+	return true;
+}
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+void BulkLoader::addRecord( Record *theRecord )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BulkLoader::addRecord" );
+
+	Row	&newRow = m_rows.createElement();
+
+	theRecord->m_theHeader.primaryLen = 0;
+	theRecord->getRecord( &newRow.values, false, &newRow.lengths );
+	newRow.lengths += ";EOB";
+	newRow.primaryLen = theRecord->m_theHeader.primaryLen;
+	m_numFields = theRecord->m_theHeader.numFields;
+
+	m_memoryUsed += sizeof( Row ) + strlen( newRow.values ) + strlen( newRow.lengths );
+	if( m_memoryUsed > m_memoryBudget )
+		spillRows();
+}
+
+/*
+	sorts the records, checks the primary keys and computes the positions
+	in the new file
+*/
+void BulkLoader::prepare( const STRING &objName )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BulkLoader::prepare" );
+
+	if( m_runs.size() && m_rows.size() )
+		spillRows();
+	else if( !m_runs.size() )
+	{
+		Row	*rows = m_rows.getDataBuffer();
+		std::sort( rows, rows + m_rows.size() );
+	}
+
+	STRING				prevPrimary;
+	size_t				numRows = 0;
+
+	m_positions.clear();
+	rewind();
+	while( nextRow() )
+	{
+		// records with the same primary key are neighbours now
+		if( m_currentRow.primaryLen )
+		{
+			STRING	primary = m_currentRow.values.leftString( size_t(m_currentRow.primaryLen) );
+			if( numRows && primary == prevPrimary )
+				throw DBkeyViolation( objName );
+
+			prevPrimary = primary;
+		}
+		numRows++;
+
+		// the B+tree places the entries while writing
+		if( !m_writer )
+		{
+			RecordHeader	theHeader;
+
+			theHeader.bufferLen = strlen( m_currentRow.values ) + NODE_ID_LEN + EOB_LEN;
+			theHeader.stringLengths = strlen( m_currentRow.lengths );
+			m_positions.addElement( gak::int64(Record::getRecordSize( &m_target, theHeader )) );
+		}
+	}
+	if( !m_writer )
+	{
+		Record::layoutBalancedTree( &m_positions, getTableHeaderSize( m_formatVersion ) );
+		if( m_positions.size() )
+			Record::setRootPosition( &m_target, getTableHeaderSize( m_formatVersion ) );
+	}
+
+	rewind();
+	m_rowIdx = size_t(-1);
+}
+
+/*
+	writes the next record in key order to the new file. returns false
+	after the last record.
+*/
+bool BulkLoader::writeNext()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BulkLoader::writeNext" );
+
+	if( !nextRow() )
+/***/	return false;
+
+	if( m_writer )
+	{
+		m_writer->addEntry( m_currentRow.values, m_currentRow.lengths, m_currentRow.primaryLen );
+/***/	return true;
+	}
+
+	const gak::int64	position = m_positions[++m_rowIdx];
+
+	// create the unique node id
+	STRING	theValues = m_currentRow.values;
+	theValues += gak::formatBinary( position - TABLE_HEADER_SIZE, 16, NODE_ID_LEN, '0' );
+	theValues += ";EOB";
+
+	RecordHeader	theHeader;
+	theHeader.address = position;
+	theHeader.numFields = m_numFields;
+	theHeader.primaryLen = m_currentRow.primaryLen;
+	theHeader.bufferLen = strlen( theValues );
+	theHeader.stringLengths = strlen( m_currentRow.lengths );
+	theHeader.setKeyPrefix( theValues );
+	Record::getBalancedLinks( m_positions, m_rowIdx, &theHeader );
+
+	Record::writeRecord( &m_target, &theHeader, theValues, m_currentRow.lengths );
+
+	return true;
+}
+
+/*
+	copies the values of the record written last to theRecord
+*/
+void BulkLoader::readRecord( Record *theRecord ) const
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BulkLoader::readRecord" );
+
+	const std::size_t	valuesLen = strlen( m_currentRow.values );
+	gak::Buffer<char>	values( valuesLen+1 );
+
+	memcpy( values, static_cast<const char *>(m_currentRow.values), valuesLen+1 );
+	theRecord->loadValues( values, m_currentRow.lengths );
+	theRecord->invalidatePath();
+	theRecord->m_theHeader.address = getPosition();
+	theRecord->m_theRecMode = rmBrowse;
+}
+
+/*
+	replaces the data file by the new file
+*/
+void BulkLoader::finish()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "BulkLoader::finish" );
+
+	if( m_writer )
+		m_writer->finish();
+
+	m_target.close();
+	m_dataFileHandle->replaceWith( m_targetName );
+	m_dataFileHandle->setFormatVersion( m_formatVersion );
+	if( m_targetHeap.isOpen() )
+	{
+		m_targetHeap.close();
+		m_dataFileHandle->getHeapFile()->replaceWith( m_targetHeapName );
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
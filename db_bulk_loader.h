@@ -0,0 +1,231 @@
+/*
+		Project:		dbLIB
+		Module:			db_bulk_loader.h
+		Description:	Bulk loading of sorted trees
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+#ifndef DB_BULK_LOADER_H
+#define DB_BULK_LOADER_H
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <string.h>
+
+#include <gak/types.h>
+#include <gak/array.h>
+#include <gak/string.h>
+
+#include "db_file_io.h"
+#include "record.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+class BTreeWriter;
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	builds a new data file from an unsorted stream of records. The records
+	are sorted in memory, if they do not fit into the memory budget, the
+	sorted runs are written to temporary files and merged. The tree is
+	written sequentially in key order with all links precomputed. B+tree
+	files remain B+trees, their pages are written by a BTreeWriter. Tables
+	with a heap file get a new heap file.
+*/
+class BulkLoader
+{
+	public:
+	static const size_t	DEFAULT_BUDGET = 64*1024*1024;
+
+	private:
+	static const size_t	RUN_BUFFER_SIZE = 4096;
+
+	struct Row
+	{
+		gak::STRING	values, lengths;
+		gak::uint64	primaryLen;
+
+		bool operator < ( const Row &other ) const
+		{
+			return strcmp( values, other.values ) < 0;
+		}
+	};
+	/*
+		a sorted part of the input, that did not fit into memory
+	*/
+	struct RunFile
+	{
+		DbFile		file;
+		gak::STRING	fileName;
+		gak::int64	position;
+		char		buffer[RUN_BUFFER_SIZE+1];
+		size_t		bufferLen, bufferPos;
+		Row			current;
+		bool		valid;
+	};
+
+	DbFile					*m_dataFileHandle;
+	DbFile					m_target;
+	gak::STRING				m_targetName;
+	DbFile					m_targetHeap;	// the new heap file (fvSplitHeap)
+	gak::STRING				m_targetHeapName;
+	int						m_formatVersion;
+	BTreeWriter				*m_writer;
+	size_t					m_memoryBudget, m_memoryUsed;
+	size_t					m_numFields;
+
+	gak::Array<Row>			m_rows;			// the rows in memory
+	gak::Array<RunFile *>	m_runs;
+	size_t					m_nextRow;
+	Row						m_currentRow;
+
+	gak::Array<gak::int64>	m_positions;	// the new positions in key order
+	size_t					m_rowIdx;
+
+	void spillRows();
+	bool readString( RunFile *run, gak::STRING *result );
+	bool readRun( RunFile *run );
+	void rewind();
+	bool nextRow();
+
+	public:
+	BulkLoader( DbFile *dataFileHandle, const gak::STRING &targetName, size_t memoryBudget );
+	~BulkLoader();
+
+	void addRecord( Record *theRecord );
+	void prepare( const gak::STRING &objName );
+	bool writeNext();
+	gak::int64 getPosition() const
+	{
+		return m_positions[m_rowIdx];
+	}
+	void readRecord( Record *theRecord ) const;
+	void finish();
+};
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
+#endif
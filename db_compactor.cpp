@@ -0,0 +1,428 @@
+/*
+		Project:		dbLIB
+		Module:			db_compactor.cpp
+		Description:	Incremental compaction of table and index files
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <algorithm>
+
+#include <gak/stdlib.h>
+
+#include "db_compactor.h"
+#include "index.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	the last field of an index entry is the position of the table record
+*/
+static const size_t	REC_POS_LEN = 16;
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+using gak::STRING;
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+Compactor::Compactor(
+	DbFile *source, const STRING &targetName, const Compactor *recPosMap
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Compactor::Compactor" );
+
+	assert( !recPosMap || recPosMap->isDone() );
+
+	m_source = source;
+	m_targetName = targetName;
+	m_recPosMap = recPosMap;
+	m_changeCount = source->getChangeCount();
+	m_phase = cpCollect;
+	m_runStart = 0;
+	m_nextEntry = 0;
+
+	m_nextPos = Record::getRootPosition( source );
+
+	strRemove( m_targetName );
+	m_target.open( m_targetName );
+
+	// the values are copied, decimal numbers need convertFormat
+	m_formatVersion = Record::hasHeapFile( source )
+		? fvSplitHeap
+		: Record::hasOrderedNumbers( source ) ? fvCurrent : fvRootLink;
+	writeTableHeader( &m_target, m_formatVersion );
+	if( m_formatVersion == fvSplitHeap )
+	{
+		m_targetHeapName = m_targetName + ".heap";
+		strRemove( m_targetHeapName );
+		m_targetHeap.open( m_targetHeapName );
+		m_target.setHeapFile( &m_targetHeap );
+	}
+}
+
+Compactor::~Compactor()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Compactor::~Compactor" );
+
+	// an unfinished target is useless
+	if( m_target.isOpen() )
+	{
+		m_target.close();
+		strRemove( m_targetName );
+	}
+	if( m_targetHeap.isOpen() )
+	{
+		m_targetHeap.close();
+		strRemove( m_targetHeapName );
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+/*
+	walks through the source tree in key order, maxRecords at most.
+	returns true, if all records are collected
+*/
+bool Compactor::collect( size_t maxRecords )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Compactor::collect" );
+
+	RecordHeader	theHeader;
+	size_t			count = 0;
+
+	while( count < maxRecords && (m_nextPos || m_path.size()) )
+	{
+		if( m_nextPos )
+		{
+			m_path.addElement( m_nextPos );
+			Record::loadRecordHeader( m_nextPos, m_source, &theHeader );
+			m_nextPos = theHeader.lowerRecordPtr;
+		}
+		else
+		{
+			gak::int64	position = m_path[m_path.size()-1];
+			m_path.removeElementAt( m_path.size()-1 );
+
+			Record::loadRecordHeader( position, m_source, &theHeader );
+			if( !IsDeleted( theHeader ) )
+				addEntry( position, theHeader );
+
+			m_nextPos = theHeader.higherRecordPtr;
+			count++;
+		}
+	}
+
+	return !m_nextPos && !m_path.size();
+}
+
+void Compactor::addEntry( gak::int64 position, const RecordHeader &theHeader )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Compactor::addEntry" );
+
+	Entry	newEntry;
+
+	newEntry.oldPos = position;
+	newEntry.recPos = 0;
+	newEntry.size = gak::int64( Record::getRecordSize( &m_target, theHeader ) );
+
+	if( m_recPosMap )
+	{
+		const size_t	recPosOffset = size_t(theHeader.bufferLen) - EOB_LEN - NODE_ID_LEN - REC_POS_LEN;
+		gak::Buffer<char>	recBuffer( Record::readRecordBuffer(
+			m_source, theHeader, theHeader.bufferLen, false
+		) );
+
+		STRING	recPos = STRING( static_cast<const char *>(recBuffer) + recPosOffset ).leftString( REC_POS_LEN );
+		newEntry.recPos = m_recPosMap->translate(
+			FieldValue::parseFieldType<long>( recPos )
+		);
+
+		// entries of deleted table records are obsolete
+		if( !newEntry.recPos )
+/***/		return;
+
+		// entries with the same key are ordered by REC_POS, that changes
+		STRING	key = STRING( static_cast<const char *>(recBuffer) ).leftString( recPosOffset-1 );
+		if( key != m_runKey )
+		{
+			sortRun();
+			m_runKey = key;
+			m_runStart = m_entries.size();
+		}
+	}
+
+	m_entries.addElement( newEntry );
+}
+
+/*
+	sorts the index entries with the key m_runKey by their new REC_POS
+*/
+void Compactor::sortRun()
+{
+	if( m_entries.size() - m_runStart > 1 )
+	{
+		Entry	*entries = m_entries.getDataBuffer();
+		std::sort( entries + m_runStart, entries + m_entries.size(), lessRecPos );
+	}
+}
+
+/*
+	computes the new positions of the records for a balanced tree
+*/
+void Compactor::prepareCopy()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Compactor::prepareCopy" );
+
+	const size_t	numEntries = m_entries.size();
+
+	if( m_recPosMap )
+		sortRun();
+
+	m_positions.setSize( numEntries );
+	for( size_t i=0; i<numEntries; ++i )
+		m_positions[i] = m_entries[i].size;
+	Record::layoutBalancedTree( &m_positions, getTableHeaderSize( m_formatVersion ) );
+	if( numEntries )
+		Record::setRootPosition( &m_target, getTableHeaderSize( m_formatVersion ) );
+
+	m_translations.setSize( numEntries );
+	for( size_t i=0; i<numEntries; ++i )
+	{
+		m_translations[i].oldPos = m_entries[i].oldPos;
+		m_translations[i].newPos = m_positions[i];
+	}
+	if( numEntries )
+	{
+		Translation	*translations = m_translations.getDataBuffer();
+		std::sort( translations, translations + numEntries );
+	}
+
+	m_path.clear();
+	m_runKey = "";
+	m_phase = cpCopy;
+}
+
+void Compactor::copyEntry( size_t entryIdx )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Compactor::copyEntry" );
+
+	const Entry			&entry = m_entries[entryIdx];
+	const gak::int64	newPos = m_positions[entryIdx];
+	RecordHeader		theHeader;
+
+	Record::loadRecordHeader( entry.oldPos, m_source, &theHeader );
+
+	const std::size_t	dataSize = std::size_t(theHeader.bufferLen + theHeader.stringLengths);
+	gak::Buffer<char>	recBuffer( Record::readRecordBuffer( m_source, theHeader, dataSize, true ) );
+
+	// the node id depends on the position
+	char	*nodeId = static_cast<char *>(recBuffer)
+		+ std::size_t(theHeader.bufferLen) - EOB_LEN - NODE_ID_LEN;
+	STRING	newId = gak::formatBinary( newPos - TABLE_HEADER_SIZE, 16, NODE_ID_LEN, '0' );
+	memcpy( nodeId, static_cast<const char *>(newId), NODE_ID_LEN );
+
+	if( m_recPosMap )
+	{
+		STRING	recPos = FieldValue::convertFieldType<long>( long(entry.recPos) );
+		memcpy( nodeId - REC_POS_LEN, static_cast<const char *>(recPos), REC_POS_LEN );
+	}
+
+	theHeader.address = newPos;
+	theHeader.status = 0;
+	theHeader.setKeyPrefix( recBuffer );
+	Record::getBalancedLinks( m_positions, entryIdx, &theHeader );
+
+	Record::writeRecord(
+		&m_target, &theHeader,
+		recBuffer, static_cast<const char *>(recBuffer) + std::size_t(theHeader.bufferLen)
+	);
+}
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	does the next maxRecords records of the compaction.
+	returns true, if the target is complete
+*/
+bool Compactor::step( size_t maxRecords )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Compactor::step" );
+
+	if( m_phase == cpCollect )
+	{
+		if( collect( maxRecords ) )
+			prepareCopy();
+	}
+	else if( m_phase == cpCopy )
+	{
+		for( size_t count=0; count < maxRecords && m_nextEntry < m_entries.size(); ++count )
+			copyEntry( m_nextEntry++ );
+
+		if( m_nextEntry >= m_entries.size() )
+			m_phase = cpDone;
+	}
+
+	return m_phase == cpDone;
+}
+
+/*
+	replaces the source by the target. All tables sharing the source see
+	the new file, their record positions are invalid.
+*/
+void Compactor::finish()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Compactor::finish" );
+
+	assert( isDone() && isValid() );
+
+	m_target.close();
+	m_source->replaceWith( m_targetName );
+	m_source->setFormatVersion( m_formatVersion );
+	if( m_targetHeap.isOpen() )
+	{
+		m_targetHeap.close();
+		m_source->getHeapFile()->replaceWith( m_targetHeapName );
+	}
+}
+
+/*
+	returns the new position of a record or 0 if the record was dropped
+*/
+gak::int64 Compactor::translate( gak::int64 oldPos ) const
+{
+	size_t	left = 0, right = m_translations.size();
+
+	while( left < right )
+	{
+		size_t	mid = (left+right)/2;
+		if( m_translations[mid].oldPos < oldPos )
+			left = mid+1;
+		else
+			right = mid;
+	}
+
+	return left < m_translations.size() && m_translations[left].oldPos == oldPos
+		? m_translations[left].newPos
+		: 0;
+}
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
@@ -0,0 +1,240 @@
+/*
+		Project:		dbLIB
+		Module:			db_compactor.h
+		Description:	Incremental compaction of table and index files
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+#ifndef DB_COMPACTOR_H
+#define DB_COMPACTOR_H
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <gak/types.h>
+#include <gak/array.h>
+#include <gak/string.h>
+
+#include "db_file_io.h"
+#include "record.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	rewrites a data file in key order as a perfectly balanced tree without
+	deleted records. A heap file is rewritten, too. The work is done in
+	bounded steps, the source remains readable until finish swaps the
+	files. If somebody writes to the source in the meantime, the result is
+	invalid and the compaction must restart.
+*/
+class Compactor
+{
+	public:
+	static const size_t	DEFAULT_STEP_SIZE = 1024;
+
+	private:
+	enum Phase
+	{
+		cpCollect,			// walk through the source in key order
+		cpCopy,				// copy the records to the target
+		cpDone				// the target is complete
+	};
+	struct Entry
+	{
+		gak::int64	oldPos;
+		gak::int64	recPos;			// the new REC_POS of an index entry
+		gak::int64	size;			// the size in the target
+	};
+	struct Translation
+	{
+		gak::int64	oldPos, newPos;
+
+		bool operator < ( const Translation &other ) const
+		{
+			return oldPos < other.oldPos;
+		}
+	};
+
+	DbFile					*m_source;
+	DbFile					m_target;
+	gak::STRING				m_targetName;
+	DbFile					m_targetHeap;	// the new heap file (fvSplitHeap)
+	gak::STRING				m_targetHeapName;
+	int						m_formatVersion;
+	gak::uint64				m_changeCount;
+	Phase					m_phase;
+
+	/*
+		the compactor of the table, if this is an index. The REC_POS fields
+		of the entries must be translated to the new table positions.
+	*/
+	const Compactor			*m_recPosMap;
+
+	gak::Array<gak::int64>	m_path;			// the ancestors of m_nextPos
+	gak::int64				m_nextPos;
+	gak::STRING				m_runKey;		// the key of equal index entries
+	size_t					m_runStart;
+
+	gak::Array<Entry>		m_entries;		// the live records in key order
+	gak::Array<gak::int64>	m_positions;	// their new positions
+	gak::Array<Translation>	m_translations;	// sorted by oldPos
+	size_t					m_nextEntry;
+
+	static bool lessRecPos( const Entry &left, const Entry &right )
+	{
+		return left.recPos < right.recPos;
+	}
+
+	bool collect( size_t maxRecords );
+	void addEntry( gak::int64 position, const RecordHeader &theHeader );
+	void sortRun();
+	void prepareCopy();
+	void copyEntry( size_t entryIdx );
+
+	public:
+	Compactor(
+		DbFile *source, const gak::STRING &targetName,
+		const Compactor *recPosMap=NULL
+	);
+	~Compactor();
+
+	bool isValid() const
+	{
+		return m_source->getChangeCount() == m_changeCount;
+	}
+	bool isDone() const
+	{
+		return m_phase == cpDone;
+	}
+	bool step( size_t maxRecords );
+	void finish();
+
+	gak::int64 translate( gak::int64 oldPos ) const;
+};
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
+#endif
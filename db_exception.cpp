@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			db_exception.cpp
 		Description:	the database exception
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -125,7 +125,7 @@ using gak::STRING;
 // ----- class virtuals ------------------------------------------------ //
 // --------------------------------------------------------------------- //
 
-const char *DBexception::what() const
+const char *DBexception::what() const throw()
 {
 	static STRING	errText;
 	size_t pos;
@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			db_exception.h
 		Description:	the database exception
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -99,7 +99,11 @@ class DBexception : public std::exception
 		ILLEGAL_RECORD_HEADER, ILLEGAL_RECORD_LEN,
 
 		// OS Errors
-		NO_MEMORY
+		NO_MEMORY,
+
+		// logical errors added later, keep the numbers above
+		SCHEMA_MISMATCH, KEY_TOO_LONG, ILLEGAL_BALANCE, FORMAT_TOO_OLD,
+		MAPPED_TRANSACTION, VIEW_READ_ONLY
 	};
 
 	gak::STRING		m_objName;
@@ -122,7 +126,7 @@ class DBexception : public std::exception
 		return "";
 	}
 	public:
-	virtual const char *what() const;
+	virtual const char *what() const throw();
 };
 
 class DBmemoryException : public DBexception
@@ -350,6 +354,96 @@ class DbExist : public DBexception
 	}
 };
 
+class DBschemaMismatch : public DBexception
+{
+	virtual const char *getErrText() const
+	{
+		return "%err%: Field %obj% does not match the schema";
+	}
+	public:
+	DBschemaMismatch() : DBexception( SCHEMA_MISMATCH )
+	{
+	}
+	DBschemaMismatch(const gak::STRING &objName) : DBexception( SCHEMA_MISMATCH, objName )
+	{
+	}
+};
+
+class DBkeyTooLong : public DBexception
+{
+	virtual const char *getErrText() const
+	{
+		return "%err%: Entry of %obj% does not fit into a page";
+	}
+	public:
+	DBkeyTooLong() : DBexception( KEY_TOO_LONG )
+	{
+	}
+	DBkeyTooLong(const gak::STRING &objName) : DBexception( KEY_TOO_LONG, objName )
+	{
+	}
+};
+
+class DBillegalBalance : public DBexception
+{
+	virtual const char *getErrText() const
+	{
+		return "%err%: Balance parameter of %obj% out of range";
+	}
+	public:
+	DBillegalBalance() : DBexception( ILLEGAL_BALANCE )
+	{
+	}
+	DBillegalBalance(const gak::STRING &objName) : DBexception( ILLEGAL_BALANCE, objName )
+	{
+	}
+};
+
+class DBformatTooOld : public DBexception
+{
+	virtual const char *getErrText() const
+	{
+		return "%err%: File %obj% must be converted first";
+	}
+	public:
+	DBformatTooOld() : DBexception( FORMAT_TOO_OLD )
+	{
+	}
+	DBformatTooOld(const gak::STRING &objName) : DBexception( FORMAT_TOO_OLD, objName )
+	{
+	}
+};
+
+class DBmappedTransaction : public DBexception
+{
+	virtual const char *getErrText() const
+	{
+		return "%err%: File %obj% is mapped and cannot be written by a transaction";
+	}
+	public:
+	DBmappedTransaction() : DBexception( MAPPED_TRANSACTION )
+	{
+	}
+	DBmappedTransaction(const gak::STRING &objName) : DBexception( MAPPED_TRANSACTION, objName )
+	{
+	}
+};
+
+class DBviewReadOnly : public DBexception
+{
+	virtual const char *getErrText() const
+	{
+		return "%err%: Table %obj% has a record view and cannot be changed";
+	}
+	public:
+	DBviewReadOnly() : DBexception( VIEW_READ_ONLY )
+	{
+	}
+	DBviewReadOnly(const gak::STRING &objName) : DBexception( VIEW_READ_ONLY, objName )
+	{
+	}
+};
+
 
 
 // --------------------------------------------------------------------- //
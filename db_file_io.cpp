@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			db_file_io.cpp
 		Description:	basic file io 
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -38,10 +38,13 @@
 // --------------------------------------------------------------------- //
 
 #include <string.h>
+#include <assert.h>
 
 #include <gak/array.h>
 
 #include "db_file_io.h"
+#include "db_buffer_pool.h"
+#include "db_wal.h"
 
 // --------------------------------------------------------------------- //
 // ----- imported datas ------------------------------------------------ //
@@ -69,6 +72,8 @@ namespace dbLib
 // ----- constants ----------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+static const gak::int64	MAP_GRANULARITY = 64*1024;
+
 // --------------------------------------------------------------------- //
 // ----- macros -------------------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -121,6 +126,66 @@ static gak::Array<DbFile*>	s_filePointers;
 // ----- class privates ------------------------------------------------ //
 // --------------------------------------------------------------------- //
 
+void DbFile::readPage( gak::int64 pageNo, char *buffer )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::readPage" );
+
+	const gak::int64	pagePos = pageNo * BufferPool::PAGE_SIZE;
+	long				readLen = 0;
+
+	if( pagePos < diskSize )
+	{
+		countDiskAccess( pagePos, BufferPool::PAGE_SIZE );
+		readLen = dbFileReadAt( handle, pagePos, buffer, BufferPool::PAGE_SIZE );
+		if( readLen < 0 )
+			readLen = 0;
+	}
+	memset( buffer+readLen, 0, BufferPool::PAGE_SIZE-readLen );
+}
+
+void DbFile::writePage( gak::int64 pageNo, const char *buffer )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::writePage" );
+
+	const gak::int64	pagePos = pageNo * BufferPool::PAGE_SIZE;
+
+	if( pagePos < fileSize )
+	{
+		size_t	len = BufferPool::PAGE_SIZE;
+		if( pagePos + gak::int64(len) > fileSize )
+			len = size_t(fileSize - pagePos);
+
+		countDiskAccess( pagePos, len );
+		if( dbFileWriteAt( handle, pagePos, buffer, len ) != long(len) )
+			throw DBopenFaild( fileName );
+
+		const gak::int64	newSize = pagePos + gak::int64(len);
+		gak::int64			oldSize = diskSize;
+		while( newSize > oldSize && !diskSize.compare_exchange_weak( oldSize, newSize ) )
+			;
+	}
+}
+
+/*
+	(re)maps the file with some space for growth, so appending records
+	does not need a new mapping each time
+*/
+void DbFile::remap()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::remap" );
+
+	gak::int64	newSize = fileSize + fileSize/2 + MAP_GRANULARITY;
+	newSize -= newSize % MAP_GRANULARITY;
+
+	char	*newMapping = dbFileMap( handle, newSize );
+
+	if( mapping )
+		dbFileUnmap( mapping, mapSize );
+
+	mapping = newMapping;
+	mapSize = newMapping ? newSize : 0;
+}
+
 // --------------------------------------------------------------------- //
 // ----- class protected ----------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -133,6 +198,262 @@ static gak::Array<DbFile*>	s_filePointers;
 // ----- class publics ------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+FileStats & FileStats::operator += ( const FileStats &other )
+{
+	headersRead += other.headersRead;
+	headersWritten += other.headersWritten;
+	bytesRead += other.bytesRead;
+	bytesWritten += other.bytesWritten;
+	seeks += other.seeks;
+	cacheHits += other.cacheHits;
+	cacheMisses += other.cacheMisses;
+	rebalances += other.rebalances;
+	descents += other.descents;
+	descentSteps += other.descentSteps;
+	if( other.maxDepth > maxDepth )
+		maxDepth = other.maxDepth;
+	deletedSkipped += other.deletedSkipped;
+	keyReads += other.keyReads;
+	payloadRead += other.payloadRead;
+	payloadWritten += other.payloadWritten;
+
+	return *this;
+}
+
+/*
+	reads len bytes at position. Each call has it's own position, so several
+	threads may read the same file at the same time.
+*/
+long DbFile::read( gak::int64 position, void *buffer, size_t len )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::read" );
+
+	BufferPool	&pool = BufferPool::getPool();
+	char		*target = static_cast<char *>(buffer);
+	size_t		done = 0;
+
+	if( position >= fileSize )
+/***/	return 0;
+
+	if( position + gak::int64(len) > fileSize )
+		len = size_t(fileSize - position);
+
+	count( scBytesRead, len );
+	if( mapping )
+	{
+		memcpy( target, mapping+position, len );
+/***/	return long(len);
+	}
+
+	while( done < len )
+	{
+		gak::int64	pageNo = position / BufferPool::PAGE_SIZE;
+		size_t		offset = size_t(position % BufferPool::PAGE_SIZE);
+		size_t		count = BufferPool::PAGE_SIZE - offset;
+		if( count > len - done )
+			count = len - done;
+
+		size_t	frameIdx = pool.pinPage( this, pageNo );
+		memcpy( target+done, pool.getPageData( frameIdx )+offset, count );
+		pool.unpinPage( frameIdx, false );
+
+		done += count;
+		position += count;
+	}
+
+	return long(done);
+}
+
+long DbFile::write( gak::int64 position, const void *buffer, size_t len )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::write" );
+
+	BufferPool	&pool = BufferPool::getPool();
+	Transaction	*transaction = Transaction::getCurrent();
+	const char	*source = static_cast<const char *>(buffer);
+	size_t		done = 0;
+
+	// a direct write cannot be undone
+	if( mapping && transaction )
+		throw DBmappedTransaction( fileName );
+
+	changeCount++;
+	count( scBytesWritten, len );
+	if( mapping )
+	{
+		countDiskAccess( position, len );
+		if( dbFileWriteAt( handle, position, buffer, len ) != long(len) )
+			throw DBopenFaild( fileName );
+
+		if( position + gak::int64(len) > fileSize )
+			fileSize = diskSize = position + len;
+		if( fileSize > mapSize )
+			remap();
+
+/***/	return long(len);
+	}
+
+	while( done < len )
+	{
+		gak::int64	pageNo = position / BufferPool::PAGE_SIZE;
+		size_t		offset = size_t(position % BufferPool::PAGE_SIZE);
+		size_t		count = BufferPool::PAGE_SIZE - offset;
+		if( count > len - done )
+			count = len - done;
+
+		size_t	frameIdx = pool.pinPage( this, pageNo );
+		char	*pageData = pool.getPageData( frameIdx );
+
+		// the transaction keeps the page pinned until the commit
+		if( transaction )
+			transaction->addWrite( this, frameIdx, position, pageData, source+done, count );
+		memcpy( pageData+offset, source+done, count );
+		if( !transaction )
+			pool.unpinPage( frameIdx, true );
+
+		done += count;
+		position += count;
+		if( position > fileSize )
+			fileSize = position;
+	}
+
+	return long(done);
+}
+
+FileStats DbFile::getStats() const
+{
+	FileStats	stats;
+
+	stats.headersRead = counters[scHeadersRead].load( std::memory_order_relaxed );
+	stats.headersWritten = counters[scHeadersWritten].load( std::memory_order_relaxed );
+	stats.bytesRead = counters[scBytesRead].load( std::memory_order_relaxed );
+	stats.bytesWritten = counters[scBytesWritten].load( std::memory_order_relaxed );
+	stats.seeks = counters[scSeeks].load( std::memory_order_relaxed );
+	stats.cacheHits = counters[scCacheHits].load( std::memory_order_relaxed );
+	stats.cacheMisses = counters[scCacheMisses].load( std::memory_order_relaxed );
+	stats.rebalances = counters[scRebalances].load( std::memory_order_relaxed );
+	stats.descents = counters[scDescents].load( std::memory_order_relaxed );
+	stats.descentSteps = counters[scDescentSteps].load( std::memory_order_relaxed );
+	stats.maxDepth = counters[scMaxDepth].load( std::memory_order_relaxed );
+	stats.deletedSkipped = counters[scDeletedSkipped].load( std::memory_order_relaxed );
+	stats.keyReads = counters[scKeyReads].load( std::memory_order_relaxed );
+	stats.payloadRead = counters[scPayloadRead].load( std::memory_order_relaxed );
+	stats.payloadWritten = counters[scPayloadWritten].load( std::memory_order_relaxed );
+
+	return stats;
+}
+
+/*
+	maps the file into memory. All cached pages are written first, because
+	the buffer pool is not used for mapped files.
+	returns false, if the port does not support mapping
+*/
+bool DbFile::mapFile()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::mapFile" );
+
+	if( !mapping )
+	{
+		BufferPool	&pool = BufferPool::getPool();
+
+		pool.flushFile( this );
+		pool.discardFile( this );
+		remap();
+	}
+
+	return mapping != NULL;
+}
+
+void DbFile::unmapFile()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::unmapFile" );
+
+	if( mapping )
+	{
+		dbFileUnmap( mapping, mapSize );
+		mapping = NULL;
+		mapSize = 0;
+	}
+}
+
+/*
+	writes all modified pages of this file to disk
+*/
+void DbFile::flush()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::flush" );
+
+	BufferPool::getPool().flushFile( this );
+}
+
+/*
+	writes all modified pages and waits until they are on the disk
+*/
+long DbFile::sync()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::sync" );
+
+	flush();
+	return dbFileSync( handle );
+}
+
+long DbFile::close()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::close" );
+
+	usageCounter--;
+	if( !usageCounter )
+	{
+		BufferPool	&pool = BufferPool::getPool();
+
+		pool.flushFile( this );
+		pool.discardFile( this );
+		unmapFile();
+
+		long	result = 0;
+		if( syncOnClose )
+		{
+			result = dbFileSync( handle );
+			syncOnClose = false;
+		}
+		if( dbFileClose( handle ) )
+			result = -1;
+		handle = 0;
+
+		return result;
+	}
+	else
+		return 0;
+}
+
+/*
+	replaces the content of this file by another file. The handle remains
+	valid for all tables sharing this file.
+*/
+void DbFile::replaceWith( const STRING &newFile )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "DbFile::replaceWith" );
+
+	bool	wasMapped = isMapped();
+
+	changeCount++;
+	unmapFile();
+	BufferPool::getPool().discardFile( this );
+	dbFileClose( handle );
+	handle = 0;
+	strRemove( fileName );
+	if( dbFileRename( newFile, fileName ) )
+		throw DBopenFaild( newFile );
+
+	handle = dbFileOpen( fileName );
+	if( handle <= 0 )
+		throw DBopenFaild( fileName );
+
+	fileSize = diskSize = dbFileSize( handle );
+	if( wasMapped )
+		remap();
+}
+
 // --------------------------------------------------------------------- //
 // ----- entry points -------------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -193,6 +514,45 @@ void closeTableFile( DbFile *dbFile )
 	}
 }
 
+/*
+	writes all modified pages of all open files and waits until they are
+	on the disk
+*/
+void syncOpenFiles()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "syncOpenFiles" );
+
+	for( size_t i=0; i<s_filePointers.size(); i++ )
+	{
+		DbFile	*dbFile = s_filePointers[i];
+
+		if( dbFile->isOpen() && dbFile->sync() )
+			throw DBopenFaild( dbFile->getFileName() );
+	}
+}
+
+/*
+	sums the counters of all open files below pathPrefix
+*/
+FileStats getOpenFileStats( const STRING &pathPrefix )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "getOpenFileStats" );
+
+	FileStats	stats;
+	size_t		prefixLen = pathPrefix.strlen();
+
+	for( size_t i=0; i<s_filePointers.size(); i++ )
+	{
+		DbFile	*dbFile = s_filePointers[i];
+		STRING	fileName = dbFile->getFileName();
+
+		if( !strcmpi( fileName.leftString( prefixLen ), pathPrefix ) )
+			stats += dbFile->getStats();
+	}
+
+	return stats;
+}
+
 } // namespace dbLib
 
 #ifdef __BORLANDC__
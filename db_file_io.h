@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			db_file_io.h
 		Description:	basic file io 
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -41,9 +41,12 @@
 // --------------------------------------------------------------------- //
 
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+
 #include <gak/string.h>
 
 #include "db_exception.h"
@@ -62,6 +65,14 @@
 #include <sys/stat.h>
 #endif
 
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
 // --------------------------------------------------------------------- //
 // ----- imported datas ------------------------------------------------ //
 // --------------------------------------------------------------------- //
@@ -88,12 +99,15 @@ namespace dbLib
 // ----- constants ----------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+
 // --------------------------------------------------------------------- //
 // ----- macros -------------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
 /*
-	Her are five macros that must be ported to a specific operating system
+	Here are the functions that must be ported to a specific operating system.
+	All reads and writes have an explicit file position, so a port that
+	has positional io can share one handle between several threads.
 */
 #ifdef __BORLANDC__
 inline long dbFileOpen( const char *file )
@@ -101,17 +115,7 @@ inline long dbFileOpen( const char *file )
 	return open( file, O_CREAT|O_RDWR|O_BINARY, S_IREAD|S_IWRITE );
 }
 
-inline long dbFileSeek( long handle, gak::int64 position )
-{
-	return lseek( (int)handle, position, SEEK_SET );
-}
-
-inline long dbFileSkip( long handle, gak::int64 offset )
-{
-	return lseek( (int)handle, offset, SEEK_CUR );
-}
-
-inline long dbFileSeekEnd( long handle )
+inline gak::int64 dbFileSize( long handle )
 {
 	return lseek( (int)handle, 0, SEEK_END );
 }
@@ -121,13 +125,15 @@ inline long dbMakePath( const char *path )
 	return mkdir( path );
 }
 
-inline long dbFileRead( long handle, void *buffer, size_t size )
+inline long dbFileReadAt( long handle, gak::int64 position, void *buffer, size_t size )
 {
+	lseek( (int)handle, long(position), SEEK_SET );
 	return read( (int)handle, buffer, (unsigned)size );
 }
 
-inline long dbFileWrite( long handle, const void *buffer, size_t size )
+inline long dbFileWriteAt( long handle, gak::int64 position, const void *buffer, size_t size )
 {
+	lseek( (int)handle, long(position), SEEK_SET );
 	return write( (int)handle, buffer, (unsigned)size );
 }
 
@@ -136,6 +142,11 @@ inline long dbFileClose( long handle )
 	return close( (int)handle );
 }
 
+inline long dbFileRename( const char *oldName, const char *newName )
+{
+	return rename( oldName, newName );
+}
+
 inline bool fileExists( const char *file )
 {
 	if( !access( file, 06 ) )
@@ -143,29 +154,42 @@ inline bool fileExists( const char *file )
 	else
 		return false;
 }
-#endif
 
-#ifdef _MSC_VER
-inline long dbFileOpen( const char *file )
+/*
+	this port has no memory mapping, DbFile falls back to the buffer pool
+*/
+inline char *dbFileMap( long , gak::int64 )
 {
-	return open( file, O_CREAT|O_RDWR|O_BINARY, S_IREAD|S_IWRITE );
+	return NULL;
 }
 
-inline gak::int64 dbFileSeek( long handle, gak::int64 position )
+inline void dbFileUnmap( char *, gak::int64 )
 {
-	/// TODO check Overflow
-	return lseek( int(handle), long(position), SEEK_SET );
 }
 
-inline gak::int64 dbFileSkip( long handle, gak::int64 offset )
+/*
+	this port cannot wait for the disk, so nothing may rely on a sync
+*/
+inline long dbFileSync( long )
 {
-	/// TODO check Overflow
-	return lseek( int(handle), long(offset), SEEK_CUR );
+	return -1;
 }
 
-inline gak::int64 dbFileSeekEnd( long handle )
+inline long dbFileTruncate( long handle, gak::int64 size )
 {
-	return lseek( int(handle), 0, SEEK_END );
+	return chsize( int(handle), long(size) );
+}
+#endif
+
+#ifdef _MSC_VER
+inline long dbFileOpen( const char *file )
+{
+	return open( file, O_CREAT|O_RDWR|O_BINARY, S_IREAD|S_IWRITE );
+}
+
+inline gak::int64 dbFileSize( long handle )
+{
+	return _lseeki64( int(handle), 0, SEEK_END );
 }
 
 inline long dbMakePath( const char *path )
@@ -173,15 +197,17 @@ inline long dbMakePath( const char *path )
 	return mkdir( path );
 }
 
-inline long dbFileRead( long handle, void *buffer, size_t size )
+inline long dbFileReadAt( long handle, gak::int64 position, void *buffer, size_t size )
 {
 	/// TODO check Overflow
+	_lseeki64( int(handle), position, SEEK_SET );
 	return read( int(handle), buffer, (unsigned)size );
 }
 
-inline long dbFileWrite( long handle, const void *buffer, size_t size )
+inline long dbFileWriteAt( long handle, gak::int64 position, const void *buffer, size_t size )
 {
 	/// TODO check Overflow
+	_lseeki64( int(handle), position, SEEK_SET );
 	return write( int(handle), buffer, (unsigned)size );
 }
 
@@ -190,6 +216,11 @@ inline long dbFileClose( long handle )
 	return close( int(handle) );
 }
 
+inline long dbFileRename( const char *oldName, const char *newName )
+{
+	return rename( oldName, newName );
+}
+
 inline bool fileExists( const char *file )
 {
 	if( !access( file, 06 ) )
@@ -197,28 +228,238 @@ inline bool fileExists( const char *file )
 	else
 		return false;
 }
+
+/*
+	this port has no memory mapping, DbFile falls back to the buffer pool
+*/
+inline char *dbFileMap( long , gak::int64 )
+{
+	return NULL;
+}
+
+inline void dbFileUnmap( char *, gak::int64 )
+{
+}
+
+inline long dbFileSync( long handle )
+{
+	return _commit( int(handle) );
+}
+
+inline long dbFileTruncate( long handle, gak::int64 size )
+{
+	return _chsize_s( int(handle), size );
+}
+#endif
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+static_assert( sizeof(off_t) >= sizeof(gak::int64), "dbLIB requires 64 bit file offsets" );
+
+inline long dbFileOpen( const char *file )
+{
+	return open( file, O_CREAT|O_RDWR|O_CLOEXEC, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH );
+}
+
+inline gak::int64 dbFileSize( long handle )
+{
+	struct stat	statBuf;
+
+	if( fstat( int(handle), &statBuf ) )
+		return -1;
+
+	return statBuf.st_size;
+}
+
+inline long dbMakePath( const char *path )
+{
+	return mkdir( path, S_IRWXU|S_IRWXG|S_IRWXO );
+}
+
+inline long dbFileReadAt( long handle, gak::int64 position, void *buffer, size_t size )
+{
+	return long(pread( int(handle), buffer, size, off_t(position) ));
+}
+
+inline long dbFileWriteAt( long handle, gak::int64 position, const void *buffer, size_t size )
+{
+	return long(pwrite( int(handle), buffer, size, off_t(position) ));
+}
+
+inline long dbFileClose( long handle )
+{
+	return close( int(handle) );
+}
+
+inline long dbFileRename( const char *oldName, const char *newName )
+{
+	return rename( oldName, newName );
+}
+
+inline bool fileExists( const char *file )
+{
+	if( !access( file, R_OK|W_OK ) )
+		return true;
+	else
+		return false;
+}
+
+/*
+	maps size bytes of the file read only. The mapping may be larger than
+	the file. The pages become valid as soon as the file grows.
+*/
+inline char *dbFileMap( long handle, gak::int64 size )
+{
+	void *mapping = mmap( NULL, size_t(size), PROT_READ, MAP_SHARED, int(handle), 0 );
+	return mapping == MAP_FAILED ? NULL : static_cast<char *>(mapping);
+}
+
+inline void dbFileUnmap( char *mapping, gak::int64 size )
+{
+	munmap( mapping, size_t(size) );
+}
+
+inline long dbFileSync( long handle )
+{
+	return fsync( int(handle) );
+}
+
+inline long dbFileTruncate( long handle, gak::int64 size )
+{
+	return ftruncate( int(handle), off_t(size) );
+}
 #endif
 
 // --------------------------------------------------------------------- //
 // ----- type definitions ---------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+enum StatCounter
+{
+	scHeadersRead, scHeadersWritten,
+	scBytesRead, scBytesWritten,
+	scSeeks,
+	scCacheHits, scCacheMisses,
+	scRebalances,
+	scDescents, scDescentSteps, scMaxDepth,
+	scDeletedSkipped,
+	scKeyReads,
+	scPayloadRead, scPayloadWritten,
+
+	scNumCounters
+};
+
+/*
+	a snapshot of the statistic counters of one or more files. The bytes
+	include the record headers, seeks are disk accesses that do not
+	continue the previous one. Key reads are record buffers read for a
+	comparison, because the key prefix was not sufficient. The payload
+	bytes are the record buffers without headers and padding.
+*/
+struct FileStats
+{
+	gak::uint64	headersRead, headersWritten;
+	gak::uint64	bytesRead, bytesWritten;
+	gak::uint64	seeks;
+	gak::uint64	cacheHits, cacheMisses;
+	gak::uint64	rebalances;
+	gak::uint64	descents, descentSteps, maxDepth;
+	gak::uint64	deletedSkipped;
+	gak::uint64	keyReads;
+	gak::uint64	payloadRead, payloadWritten;
+
+	FileStats()
+	{
+		headersRead = headersWritten = 0;
+		bytesRead = bytesWritten = 0;
+		seeks = 0;
+		cacheHits = cacheMisses = 0;
+		rebalances = 0;
+		descents = descentSteps = maxDepth = 0;
+		deletedSkipped = 0;
+		keyReads = 0;
+		payloadRead = payloadWritten = 0;
+	}
+	FileStats & operator += ( const FileStats &other );
+
+	double getAvgDepth() const
+	{
+		return descents ? double(descentSteps) / double(descents) : 0.0;
+	}
+};
+
 // --------------------------------------------------------------------- //
 // ----- class definitions --------------------------------------------- //
 // --------------------------------------------------------------------- //
 
 class DbFile
 {
+	friend class BufferPool;
+	friend class Transaction;
+
 	private:
 	long		usageCounter;
 	long		handle;
+	int			formatVersion;
 	gak::STRING	fileName;
 
+	/*
+		all data is read and written through the buffer pool, so we keep
+		the size of the file ourself. The pool writes pages back from any
+		thread, that needs a frame.
+	*/
+	gak::int64					fileSize;	// the size including cached pages
+	std::atomic<gak::int64>		diskSize;	// the size written to disk
+
+	/*
+		read mostly files can be mapped into memory. In that case the
+		buffer pool is bypassed, reads are served from the mapping and
+		writes go directly to the file.
+	*/
+	char		*mapping;
+	gak::int64	mapSize;
+
+	/*
+		counts all modifications, so that long running readers like the
+		compaction can detect concurrent writers
+	*/
+	gak::uint64	changeCount;
+
+	// written by a transaction, the log relies on the data reaching the disk
+	bool		syncOnClose;
+
+	// the record buffers of a table with fvSplitHeap
+	DbFile		*heapFile;
+
+	/*
+		the counters are updated by concurrent readers, too. Relaxed
+		atomics are cheap enough to keep them always on.
+	*/
+	std::atomic<gak::uint64>	counters[scNumCounters];
+	std::atomic<gak::int64>		nextDiskPos;
+
+	void countDiskAccess( gak::int64 position, size_t len )
+	{
+		if( nextDiskPos.exchange( position + gak::int64(len), std::memory_order_relaxed ) != position )
+			count( scSeeks );
+	}
+
+	void readPage( gak::int64 pageNo, char *buffer );
+	void writePage( gak::int64 pageNo, const char *buffer );
+	void remap();
+
 	public:
 	DbFile()
 	{
 		usageCounter = 0;
 		handle = 0;
+		formatVersion = 0;
+		fileSize = diskSize = 0;
+		mapping = NULL;
+		mapSize = 0;
+		changeCount = 0;
+		syncOnClose = false;
+		heapFile = NULL;
+		resetStats();
 	}
 
 	long open( const gak::STRING &fileName )
@@ -230,6 +471,7 @@ class DbFile
 			{
 				this->fileName = fileName;
 				usageCounter = 1;
+				fileSize = diskSize = dbFileSize( handle );
 			}
 			else
 				throw DBopenFaild( fileName );
@@ -239,44 +481,60 @@ class DbFile
 
 		return handle;
 	}
-	gak::int64 seek( gak::int64 position )	const
+	gak::int64 getSize() const
 	{
-		return dbFileSeek( handle, position );
+		return fileSize;
 	}
-	gak::int64 skip( gak::int64 offset )	const
+	long read( gak::int64 position, void *buffer, size_t len );
+	long write( gak::int64 position, const void *buffer, size_t len );
+	gak::uint64 getChangeCount() const
 	{
-		return dbFileSkip( handle, offset );
+		return changeCount;
 	}
-	gak::int64 toEnd()	const
+
+	void count( StatCounter counter, gak::uint64 value=1 )
 	{
-		return dbFileSeekEnd( handle );
+		counters[counter].fetch_add( value, std::memory_order_relaxed );
 	}
-	gak::int64 toStart()	const
+	void countDescent( gak::uint64 depth )
 	{
-		return seek( 0 );
+		count( scDescents );
+		count( scDescentSteps, depth );
+
+		gak::uint64	maxDepth = counters[scMaxDepth].load( std::memory_order_relaxed );
+		while( depth > maxDepth
+		&& !counters[scMaxDepth].compare_exchange_weak( maxDepth, depth, std::memory_order_relaxed ) )
+			;
 	}
-	long read( void *buffer, size_t len )	const
+	FileStats getStats() const;
+	void resetStats()
 	{
-		return dbFileRead( handle, buffer, len );
+		for( size_t i=0; i<scNumCounters; ++i )
+			counters[i].store( 0, std::memory_order_relaxed );
+		nextDiskPos.store( -1, std::memory_order_relaxed );
 	}
-	long write( const void *buffer, size_t len )	const
+
+	bool mapFile();
+	void unmapFile();
+	bool isMapped() const
 	{
-		return dbFileWrite( handle, buffer, len );
+		return mapping != NULL;
 	}
-	long close()
+	/*
+		returns a pointer to len bytes at position or NULL, if the file is
+		not mapped. The pointer is valid until the next write.
+	*/
+	const char *getMapped( gak::int64 position, size_t len ) const
 	{
-		usageCounter--;
-		if( !usageCounter )
-		{
-			long	result = dbFileClose( handle );
-			handle = 0;
-
-			return result;
-		}
+		if( mapping && position >= 0 && position + gak::int64(len) <= fileSize )
+			return mapping + position;
 		else
-			return 0;
-
+			return NULL;
 	}
+
+	void flush();
+	long sync();
+	long close();
 	bool isOpen()	const
 	{
 		return usageCounter > 0 && handle > 0;
@@ -285,6 +543,26 @@ class DbFile
 	{
 		return fileName;
 	}
+	/*
+		the layout version of the table file, read from the table header
+	*/
+	int getFormatVersion() const
+	{
+		return formatVersion;
+	}
+	void setFormatVersion( int version )
+	{
+		formatVersion = version;
+	}
+	DbFile *getHeapFile() const
+	{
+		return heapFile;
+	}
+	void setHeapFile( DbFile *heapFile )
+	{
+		this->heapFile = heapFile;
+	}
+	void replaceWith( const gak::STRING &newFile );
 	~DbFile()
 	{
 		if( isOpen() )
@@ -313,11 +591,52 @@ class DbFile
 
 DbFile	*openTableFile( const gak::STRING &path );
 void closeTableFile( DbFile *dbFile );
+void syncOpenFiles();
+FileStats getOpenFileStats( const gak::STRING &pathPrefix );
 
 // --------------------------------------------------------------------- //
 // ----- module functions ---------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+/*
+	the binary structures in the files are little endian
+*/
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+template <typename ValueT>
+inline ValueT swapBytes( ValueT value )
+{
+	unsigned char	*bytes = reinterpret_cast<unsigned char *>(&value);
+	for( size_t i=0; i<sizeof(ValueT)/2; ++i )
+	{
+		unsigned char tmp = bytes[i];
+		bytes[i] = bytes[sizeof(ValueT)-1-i];
+		bytes[sizeof(ValueT)-1-i] = tmp;
+	}
+	return value;
+}
+#else
+template <typename ValueT>
+inline ValueT swapBytes( ValueT value )
+{
+	return value;
+}
+#endif
+
+template <typename ValueT>
+inline ValueT getBinary( const char *buffer, size_t offset )
+{
+	ValueT	value;
+	memcpy( &value, buffer+offset, sizeof(value) );
+	return swapBytes( value );
+}
+
+template <typename ValueT>
+inline void putBinary( char *buffer, size_t offset, ValueT value )
+{
+	value = swapBytes( value );
+	memcpy( buffer+offset, &value, sizeof(value) );
+}
+
 // --------------------------------------------------------------------- //
 // ----- class inlines ------------------------------------------------- //
 // --------------------------------------------------------------------- //
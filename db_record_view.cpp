@@ -0,0 +1,281 @@
+/*
+		Project:		dbLIB
+		Module:			db_record_view.cpp
+		Description:	A read only view into a record buffer
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <cstring>
+
+#include <gak/stdlib.h>
+
+#include "db_record_view.h"
+#include "db_buffer_pool.h"
+#include "db_exception.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+const std::size_t RecordView::no_frame = std::size_t(-1);
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+/*
+	the lengths follow the values as hex numbers separated by ';', so the
+	values end where the lengths start
+*/
+void RecordView::parseLengths(
+	const char *cpLength, const char *lengthsEnd, std::size_t numFields
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "RecordView::parseLengths" );
+
+	const char	*cpData = m_data;
+	const char	*valuesEnd = cpLength;
+
+	if( m_fields.size() < numFields )
+		m_fields.setSize( numFields );
+
+	for( std::size_t i=0; i<numFields; ++i )
+	{
+		const char	*end = cpLength;
+		while( end < lengthsEnd && *end != ';' )
+			++end;
+		if( end >= lengthsEnd )
+			throw DBillegalRecordlen();
+
+		const std::size_t	lenData = std::size_t(
+			FieldValue::parseHex( cpLength, std::size_t(end-cpLength) )
+		);
+
+		// a corrupt length must not point behind the values
+		if( lenData >= std::size_t(valuesEnd - cpData) )
+			throw DBillegalRecordlen();
+
+		FieldView	&field = m_fields[i];
+		field.data = cpData;
+		field.length = lenData;
+
+		cpData += lenData+1;
+		cpLength = end+1;
+	}
+
+	m_numFields = numFields;
+	m_valuesLen = numFields ? std::size_t(cpData - m_data) - 1 : 0;
+}
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	makes the record buffer at position visible. bufferLen is the length
+	of the values including the node id, lengthsLen the length of the
+	string lengths behind.
+*/
+void RecordView::load(
+	DbFile *dataFileHandle, gak::int64 position,
+	std::size_t bufferLen, std::size_t lengthsLen, std::size_t numFields,
+	bool decimalNumbers
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "RecordView::load" );
+
+	const std::size_t	totalLen = bufferLen + lengthsLen;
+
+	release();
+	m_decimalNumbers = decimalNumbers;
+	m_data = dataFileHandle->getMapped( position, totalLen );
+	if( !m_data )
+	{
+		const gak::int64	pageNo = position / BufferPool::PAGE_SIZE;
+		const std::size_t	offset = std::size_t(position % BufferPool::PAGE_SIZE);
+
+		if( offset + totalLen <= BufferPool::PAGE_SIZE )
+		{
+			BufferPool	&pool = BufferPool::getPool();
+
+			m_frameIdx = pool.pinPage( dataFileHandle, pageNo );
+			m_data = pool.getPageData( m_frameIdx ) + offset;
+		}
+		else
+		{
+			if( m_copy.size() < totalLen )
+				m_copy.setSize( totalLen );
+
+			char	*copy = m_copy.getDataBuffer();
+			if( dataFileHandle->read( position, copy, totalLen ) != long(totalLen) )
+				throw DBillegalRecordlen();
+			m_data = copy;
+		}
+	}
+
+	if( bufferLen < 4 || memcmp( m_data+bufferLen-4, ";EOB", 4 ) )
+	{
+		release();
+		throw DBillegalRecordlen();
+	}
+	dataFileHandle->count( scPayloadRead, totalLen );
+
+	parseLengths( m_data + bufferLen, m_data + totalLen, numFields );
+}
+
+/*
+	unpins the page of the current record
+*/
+void RecordView::release()
+{
+	if( m_frameIdx != no_frame )
+	{
+		BufferPool::getPool().unpinPage( m_frameIdx, false );
+		m_frameIdx = no_frame;
+	}
+	m_data = NULL;
+	m_numFields = 0;
+}
+
+gak::STRING RecordView::getStringValue( std::size_t fieldIdx ) const
+{
+	const FieldView		&field = getField( fieldIdx );
+	gak::Buffer<char>	tmpBuffer( field.length+1 );
+
+	memcpy( tmpBuffer, field.data, field.length );
+	tmpBuffer[field.length] = 0;
+
+	return gak::STRING( static_cast<const char *>(tmpBuffer) );
+}
+
+/*
+	compares the values with the prefix key like strncmp
+*/
+int RecordView::compareValues( const gak::STRING &key ) const
+{
+	const std::size_t	keyLen = strlen( key );
+	int compareVal = memcmp( m_data, (const char *)key, m_valuesLen < keyLen ? m_valuesLen : keyLen );
+	if( !compareVal && m_valuesLen < keyLen )
+		compareVal = -1;
+
+	return compareVal;
+}
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
@@ -0,0 +1,249 @@
+/*
+		Project:		dbLIB
+		Module:			db_record_view.h
+		Description:	A read only view into a record buffer
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+#ifndef DB_RECORD_VIEW_H
+#define DB_RECORD_VIEW_H
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <cassert>
+#include <ctime>
+
+#include <gak/types.h>
+#include <gak/array.h>
+#include <gak/string.h>
+
+#include "db_file_io.h"
+#include "fieldvalue.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	a field inside a record buffer, the data is not terminated by 0
+*/
+struct FieldView
+{
+	const char		*data;
+	std::size_t		length;
+};
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	read only scans can bind a view to a table. The cursor does no longer
+	copy the fields into the FieldValues, the view exposes them in place,
+	in the mapping of the file or in a pinned page of the buffer pool.
+	Only records crossing a page boundary are copied into a buffer, that
+	is reused for the following records. The fields are valid until the
+	cursor moves or the file is written.
+*/
+class RecordView
+{
+	static const std::size_t	no_frame;
+
+	const char				*m_data;			// the values followed by their lengths
+	std::size_t				m_valuesLen;
+	std::size_t				m_frameIdx;
+	gak::Array<char>		m_copy;
+	gak::Array<FieldView>	m_fields;
+	std::size_t				m_numFields;
+	bool					m_decimalNumbers;	// the file is older than fvOrderedNumber
+
+	void parseLengths(
+		const char *cpLength, const char *lengthsEnd, std::size_t numFields
+	);
+
+	public:
+	RecordView()
+	{
+		m_data = NULL;
+		m_valuesLen = 0;
+		m_frameIdx = no_frame;
+		m_numFields = 0;
+		m_decimalNumbers = false;
+	}
+	~RecordView()
+	{
+		release();
+	}
+
+	void load(
+		DbFile *dataFileHandle, gak::int64 position,
+		std::size_t bufferLen, std::size_t lengthsLen, std::size_t numFields,
+		bool decimalNumbers=false
+	);
+	void release();
+
+	const char *getData() const
+	{
+		return m_data;
+	}
+	std::size_t getNumFields() const
+	{
+		return m_numFields;
+	}
+	const FieldView &getField( std::size_t fieldIdx ) const
+	{
+		assert( fieldIdx < m_numFields );
+		return m_fields[fieldIdx];
+	}
+	bool isNull( std::size_t fieldIdx ) const
+	{
+		return !getField( fieldIdx ).length;
+	}
+	gak::STRING getStringValue( std::size_t fieldIdx ) const;
+	long getIntegerValue( std::size_t fieldIdx ) const
+	{
+		const FieldView	&field = getField( fieldIdx );
+		return long(FieldValue::parseOrderedInteger( field.data, field.length ));
+	}
+	double getDoubleValue( std::size_t fieldIdx ) const
+	{
+		const FieldView	&field = getField( fieldIdx );
+		return m_decimalNumbers
+			? FieldValue::parseDecimalNumber( field.data, field.length )
+			: FieldValue::parseOrderedNumber( field.data, field.length );
+	}
+	bool getBooleanValue( std::size_t fieldIdx ) const
+	{
+		const FieldView	&field = getField( fieldIdx );
+		return field.length && field.data[0] == 'Y';
+	}
+	time_t getDateValue( std::size_t fieldIdx ) const
+	{
+		const FieldView	&field = getField( fieldIdx );
+		return time_t(FieldValue::parseOrderedInteger( field.data, field.length ));
+	}
+
+	int compareValues( const gak::STRING &key ) const;
+};
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
+#endif
@@ -0,0 +1,276 @@
+/*
+		Project:		dbLIB
+		Module:			db_tree_analyzer.cpp
+		Description:	the tree shape analyzer
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include "db_tree_analyzer.h"
+#include "db_buffer_pool.h"
+#include "index.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+/*
+	depth first with an explicit stack, so that degenerated trees do not
+	overflow the call stack
+*/
+void TreeAnalyzer::walkTree( gak::int64 rootPos )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "TreeAnalyzer::walkTree" );
+
+	gak::Array<Node>	stack;
+	Node				node;
+
+	node.depth = 1;
+	Record::loadRecordHeader( rootPos, m_file, &node.header );
+	stack.addElement( node );
+
+	while( stack.size() )
+	{
+		node = stack[stack.size()-1];
+		stack.removeElementAt( stack.size()-1 );
+
+		Node	lower, higher;
+
+		lower.depth = higher.depth = node.depth+1;
+		if( node.header.lowerRecordPtr )
+		{
+			Record::loadRecordHeader( node.header.lowerRecordPtr, m_file, &lower.header );
+			addLink( node.header, node.header.lowerRecordPtr );
+			stack.addElement( lower );
+		}
+		if( node.header.higherRecordPtr )
+		{
+			Record::loadRecordHeader( node.header.higherRecordPtr, m_file, &higher.header );
+			addLink( node.header, node.header.higherRecordPtr );
+			stack.addElement( higher );
+		}
+
+		addNode( node, lower.header.numRecords, higher.header.numRecords );
+	}
+}
+
+void TreeAnalyzer::addNode( const Node &node, gak::int64 lowerSize, gak::int64 higherSize )
+{
+	while( m_report->levels.size() < node.depth )
+		m_report->levels.createElement();
+
+	TreeLevel		&level = m_report->levels[node.depth-1];
+	const gak::int64	smaller = lowerSize < higherSize ? lowerSize : higherSize;
+	const gak::int64	larger = lowerSize < higherSize ? higherSize : lowerSize;
+	const double		ratio = double(larger+1) / double(smaller+1);
+	const gak::uint64	capacity = Record::getRecordSize( m_file, node.header );
+
+	level.nodes++;
+	level.sumRatio += ratio;
+	if( ratio > level.maxRatio )
+		level.maxRatio = ratio;
+	if( double(smaller+1) < m_report->balanceAlpha * double(smaller+larger+2) )
+		level.overThreshold++;
+
+	m_report->treeNodes++;
+	m_report->depthSum += node.depth;
+	if( node.depth > m_report->maxDepth )
+		m_report->maxDepth = node.depth;
+
+	if( IsDeleted( node.header ) )
+	{
+		level.deletedNodes++;
+		m_report->deletedNodes++;
+		m_report->deletedBytes += capacity;
+	}
+	else
+		m_report->usedBytes += capacity;
+}
+
+void TreeAnalyzer::addLink( const RecordHeader &parent, gak::int64 childPos )
+{
+	const gak::uint64	distance = gak::uint64(
+		childPos > parent.address ? childPos - parent.address : parent.address - childPos
+	);
+
+	m_report->links++;
+	m_report->distanceSum += distance;
+	if( distance > m_report->maxDistance )
+		m_report->maxDistance = distance;
+	if( childPos / BufferPool::PAGE_SIZE != parent.address / BufferPool::PAGE_SIZE )
+		m_report->farLinks++;
+}
+
+/*
+	with a free space map the records are stored without gaps, so we can
+	step from one record to the next
+*/
+void TreeAnalyzer::scanFreeRecords( gak::int64 rootPos )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "TreeAnalyzer::scanFreeRecords" );
+
+	const gak::int64	headerLength = gak::int64(Record::getHeaderLength( m_file ));
+	RecordHeader		theHeader;
+
+	for( gak::int64 position = rootPos; position + headerLength <= m_report->fileSize; )
+	{
+		Record::readRecordHeader( m_file, position, &theHeader );
+
+		const gak::int64	capacity = gak::int64(Record::getRecordSize( m_file, theHeader ));
+
+		if( theHeader.status & REC_FREE )
+		{
+			m_report->freeRecords++;
+			m_report->freeBytes += gak::uint64(capacity);
+		}
+		position += capacity;
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+void TreeAnalyzer::analyze( DbFile *file, double balanceAlpha, TreeReport *report )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "TreeAnalyzer::analyze" );
+
+	report->clear();
+	report->formatVersion = file->getFormatVersion();
+	report->balanceAlpha = balanceAlpha;
+	report->fileSize = file->getSize();
+	report->headerSize = getTableHeaderSize( report->formatVersion );
+
+	if( report->fileSize <= report->headerSize )
+/***/	return;
+
+	TreeAnalyzer	analyzer( file, report );
+	const gak::int64	rootPos = Record::getRootPosition( file );
+
+	if( rootPos )
+		analyzer.walkTree( rootPos );
+	if( report->formatVersion >= fvFreeSpace )
+		analyzer.scanFreeRecords( report->headerSize );
+}
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
@@ -0,0 +1,288 @@
+/*
+		Project:		dbLIB
+		Module:			db_tree_analyzer.h
+		Description:	the tree shape analyzer
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+#ifndef DB_TREE_ANALYZER_H
+#define DB_TREE_ANALYZER_H
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <gak/types.h>
+#include <gak/array.h>
+
+#include "db_file_io.h"
+#include "record.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	the nodes of one level of the tree. The balance ratio of a node
+	compares the sizes of its subtrees plus one. A node is unbalanced, if
+	one of them has less than alpha of the weight of the node.
+*/
+struct TreeLevel
+{
+	gak::uint64	nodes, deletedNodes;
+	gak::uint64	overThreshold;		// nodes out of the BB[alpha] balance
+	double		sumRatio, maxRatio;
+
+	TreeLevel()
+	{
+		nodes = deletedNodes = overThreshold = 0;
+		sumRatio = maxRatio = 0;
+	}
+	double getAvgRatio() const
+	{
+		return nodes ? sumRatio / double(nodes) : 0.0;
+	}
+};
+
+typedef gak::Array<TreeLevel>	TreeLevels;
+
+/*
+	the shape and the fragmentation of a data file. Depths start with 1
+	for the root, the distances are the bytes between a parent and its
+	children in the file.
+*/
+struct TreeReport
+{
+	int			formatVersion;
+	double		balanceAlpha;
+	gak::int64	fileSize, headerSize;
+
+	gak::uint64	treeNodes, deletedNodes;
+	gak::uint64	freeRecords;
+	gak::uint64	usedBytes, deletedBytes, freeBytes;
+
+	gak::uint64	maxDepth, depthSum;
+	TreeLevels	levels;
+
+	gak::uint64	links, farLinks;	// far links point to another page
+	gak::uint64	distanceSum, maxDistance;
+
+	TreeReport()
+	{
+		clear();
+	}
+	void clear()
+	{
+		formatVersion = 0;
+		balanceAlpha = DEFAULT_BALANCE_ALPHA;
+		fileSize = headerSize = 0;
+		treeNodes = deletedNodes = 0;
+		freeRecords = 0;
+		usedBytes = deletedBytes = freeBytes = 0;
+		maxDepth = depthSum = 0;
+		links = farLinks = 0;
+		distanceSum = maxDistance = 0;
+		levels.clear();
+	}
+
+	gak::uint64 getLiveRecords() const
+	{
+		return treeNodes - deletedNodes;
+	}
+	double getDeadRatio() const
+	{
+		return treeNodes ? double(deletedNodes) / double(treeNodes) : 0.0;
+	}
+	/*
+		deleted records, free records and the padding of reused space
+	*/
+	gak::uint64 getWastedBytes() const
+	{
+		return gak::uint64(fileSize - headerSize) - usedBytes;
+	}
+	double getAvgDepth() const
+	{
+		return treeNodes ? double(depthSum) / double(treeNodes) : 0.0;
+	}
+	/*
+		the depth of a perfectly balanced tree with the same nodes
+	*/
+	gak::uint64 getOptimalDepth() const
+	{
+		gak::uint64	depth = 0;
+		for( gak::uint64 nodes = treeNodes; nodes; nodes >>= 1 )
+			depth++;
+
+		return depth;
+	}
+	/*
+		a subtree has at most 1-alpha of the weight of its parent and a
+		weight of at least 2, that limits the depth of a balanced tree
+	*/
+	gak::uint64 getDepthBound() const
+	{
+		gak::uint64	depth = 0;
+		for( double weight = double(treeNodes+1); weight >= 2.0; weight *= 1.0-balanceAlpha )
+			depth++;
+
+		return depth;
+	}
+	double getAvgDistance() const
+	{
+		return links ? double(distanceSum) / double(links) : 0.0;
+	}
+};
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	walks through a data file and collects a TreeReport. The file is only
+	read, every header once.
+*/
+class TreeAnalyzer
+{
+	struct Node
+	{
+		RecordHeader	header;
+		size_t			depth;
+	};
+
+	DbFile		*m_file;
+	TreeReport	*m_report;
+
+	void walkTree( gak::int64 rootPos );
+	void addNode( const Node &node, gak::int64 lowerSize, gak::int64 higherSize );
+	void addLink( const RecordHeader &parent, gak::int64 childPos );
+	void scanFreeRecords( gak::int64 rootPos );
+
+	TreeAnalyzer( DbFile *file, TreeReport *report )
+	{
+		m_file = file;
+		m_report = report;
+	}
+
+	public:
+	static void analyze( DbFile *file, double balanceAlpha, TreeReport *report );
+};
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
+#endif
@@ -0,0 +1,389 @@
+/*
+		Project:		dbLIB
+		Module:			db_typed_table.h
+		Description:	Typed access to tables with a schema declared in C++
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+#ifndef DB_TYPED_TABLE_H
+#define DB_TYPED_TABLE_H
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <cstddef>
+#include <ctime>
+
+#include "table.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	declares a field handle inside a schema struct:
+
+	struct PersonSchema
+	{
+		DB_SCHEMA_FIELD( Id, ftInteger, 0, "ID" );
+		DB_SCHEMA_FIELD( Name, ftString, 1, "NAME" );
+
+		typedef dbLib::SchemaFields<Id, Name>	Fields;
+	};
+*/
+#define DB_SCHEMA_FIELD( handle, fieldType, fieldIdx, fieldName )		\
+	struct handle : public dbLib::FieldHandle<dbLib::fieldType, fieldIdx>	\
+	{																	\
+		static const char *getName()									\
+		{																\
+			return fieldName;											\
+		}																\
+	}
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	the native type and the accessors of a field type
+*/
+template <fType TYPE>
+struct FieldTraits;
+
+template <>
+struct FieldTraits<ftBoolean>
+{
+	typedef bool native_type;
+
+	static bool get( const FieldValue *field )
+	{
+		return field->getBooleanValue();
+	}
+	static void set( FieldValue *field, bool value )
+	{
+		field->setBooleanValue( value );
+	}
+};
+
+template <>
+struct FieldTraits<ftInteger>
+{
+	typedef long native_type;
+
+	static long get( const FieldValue *field )
+	{
+		return field->getIntegerValue();
+	}
+	static void set( FieldValue *field, long value )
+	{
+		field->setIntegerValue( value );
+	}
+};
+
+template <>
+struct FieldTraits<ftNumber>
+{
+	typedef double native_type;
+
+	static double get( const FieldValue *field )
+	{
+		return field->getDoubleValue();
+	}
+	static void set( FieldValue *field, double value )
+	{
+		field->setDoubleValue( value );
+	}
+};
+
+template <>
+struct FieldTraits<ftDate>
+{
+	typedef time_t native_type;
+
+	static time_t get( const FieldValue *field )
+	{
+		return field->getDateValue();
+	}
+	static void set( FieldValue *field, time_t value )
+	{
+		field->setDateValue( value );
+	}
+};
+
+template <>
+struct FieldTraits<ftString>
+{
+	typedef gak::STRING native_type;
+
+	static const gak::STRING &get( const FieldValue *field )
+	{
+		return field->getStringValue();
+	}
+	static void set( FieldValue *field, const gak::STRING &value )
+	{
+		field->setStringValue( value );
+	}
+};
+
+template <>
+struct FieldTraits<ftBlob> : public FieldTraits<ftString>
+{
+};
+
+/*
+	the compile time handle of a field: its type and its position in the
+	definition
+*/
+template <fType TYPE, std::size_t INDEX>
+struct FieldHandle
+{
+	static const fType			type = TYPE;
+	static const std::size_t	index = INDEX;
+
+	typedef typename FieldTraits<TYPE>::native_type	native_type;
+};
+
+/*
+	all fields of a schema in the order of the definition
+*/
+template <typename ... FieldsT>
+struct SchemaFields
+{
+	static const std::size_t	numFields = sizeof...(FieldsT);
+};
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	compares the fields of a schema with the definition of a table
+*/
+template <std::size_t POSITION, typename ... FieldsT>
+struct SchemaChecker;
+
+template <std::size_t POSITION>
+struct SchemaChecker<POSITION>
+{
+	static void check( Table * )
+	{
+	}
+};
+
+template <std::size_t POSITION, typename FieldT, typename ... MoreT>
+struct SchemaChecker<POSITION, FieldT, MoreT...>
+{
+	static void check( Table *table )
+	{
+		static_assert(
+			FieldT::index == POSITION,
+			"the schema fields must be listed in the order of their index"
+		);
+
+		const FieldValue	*field = table->getField( POSITION );
+		if( strcmpi( field->getName(), FieldT::getName() )
+		|| field->getType() != FieldT::type )
+		{
+			throw DBschemaMismatch( FieldT::getName() );
+		}
+
+		SchemaChecker<POSITION+1, MoreT...>::check( table );
+	}
+};
+
+template <typename FieldsT>
+struct SchemaCheck;
+
+template <typename ... FieldsT>
+struct SchemaCheck< SchemaFields<FieldsT...> >
+{
+	static void check( Table *table )
+	{
+		if( table->getNumFields() != sizeof...(FieldsT) )
+			throw DBschemaMismatch( table->getPathName() );
+
+		SchemaChecker<0, FieldsT...>::check( table );
+	}
+};
+
+/*
+	a table with a schema declared in C++. The schema is checked against
+	the definition of the table once, when the table is opened. The
+	fields are then accessed by their index without any lookup.
+	TypedTable owns the table.
+*/
+template <typename SchemaT>
+class TypedTable
+{
+	Table	*m_table;
+
+	// not copyable
+	TypedTable( const TypedTable & );
+	TypedTable & operator = ( const TypedTable & );
+
+	public:
+	explicit TypedTable( Table *table )
+	{
+		m_table = table;
+		try
+		{
+			SchemaCheck<typename SchemaT::Fields>::check( m_table );
+		}
+		catch( ... )
+		{
+			delete m_table;
+			throw;
+		}
+	}
+	~TypedTable()
+	{
+		delete m_table;
+	}
+
+	Table *operator -> () const
+	{
+		return m_table;
+	}
+	Table &getTable() const
+	{
+		return *m_table;
+	}
+
+	template <typename FieldT>
+	typename FieldT::native_type get() const
+	{
+		return FieldTraits<FieldT::type>::get( m_table->getFieldValue( FieldT::index ) );
+	}
+	template <typename FieldT>
+	void set( const typename FieldT::native_type &value )
+	{
+		FieldTraits<FieldT::type>::set( m_table->getFieldValue( FieldT::index ), value );
+	}
+	template <typename FieldT>
+	bool isNull() const
+	{
+		return m_table->getFieldValue( FieldT::index )->isNull();
+	}
+	template <typename FieldT>
+	void setNull()
+	{
+		m_table->getFieldValue( FieldT::index )->setNull();
+	}
+};
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
+#endif
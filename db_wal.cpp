@@ -0,0 +1,668 @@
+/*
+		Project:		dbLIB
+		Module:			db_wal.cpp
+		Description:	the write ahead log
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <string.h>
+#include <assert.h>
+
+#include "db_wal.h"
+#include "db_file_io.h"
+#include "db_buffer_pool.h"
+#include "db_exception.h"
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+static const gak::uint32	ENTRY_MAGIC = 0x4C574244;		// "DBWL"
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+using gak::STRING;
+
+/*
+	each entry is one transaction:
+		header
+		number of files, for each file the length and the name with the 0
+		items until the end: file index, position, length and the data
+	The checksum covers everything behind the header.
+*/
+struct EntryHeader
+{
+	gak::uint32	magic;
+	gak::uint32	length;
+	gak::uint32	checksum;
+};
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+thread_local Transaction	*Transaction::s_current = NULL;
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	FNV-1a, good enough to detect a torn entry at the end of the log
+*/
+static gak::uint32 checksum( const char *data, size_t length )
+{
+	gak::uint32	hash = 2166136261U;
+
+	for( size_t i=0; i<length; ++i )
+	{
+		hash ^= gak::uint8(data[i]);
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+template <typename ValueT>
+inline void appendValue( std::vector<char> *buffer, ValueT value )
+{
+	const char *data = reinterpret_cast<const char *>(&value);
+	buffer->insert( buffer->end(), data, data+sizeof(value) );
+}
+
+template <typename ValueT>
+inline bool readValue( const char *payload, size_t length, size_t *pos, ValueT *value )
+{
+	if( length - *pos < sizeof(ValueT) )
+/***/	return false;
+
+	memcpy( value, payload + *pos, sizeof(ValueT) );
+	*pos += sizeof(ValueT);
+
+	return true;
+}
+
+/*
+	writes the items of one entry to the data files, the handles of the
+	files remain open for the next entries
+*/
+static void replayEntry(
+	const char *payload, size_t length,
+	gak::Array<STRING> *fileNames, gak::Array<long> *handles
+)
+{
+	size_t			pos = 0;
+	gak::uint32		numFiles, nameLen;
+	gak::Array<long>	entryHandles;
+
+	if( !readValue( payload, length, &pos, &numFiles ) )
+/***/	return;
+
+	for( gak::uint32 i=0; i<numFiles; ++i )
+	{
+		// the names are stored with the terminating 0
+		if( !readValue( payload, length, &pos, &nameLen )
+		|| !nameLen || length - pos < nameLen || payload[pos+nameLen-1] )
+/***/		return;
+
+		STRING	fileName = payload + pos;
+		pos += nameLen;
+
+		size_t	fileIdx = 0;
+		while( fileIdx < fileNames->size() && (*fileNames)[fileIdx] != fileName )
+			++fileIdx;
+
+		if( fileIdx == fileNames->size() )
+		{
+			long	handle = dbFileOpen( fileName );
+			if( handle <= 0 )
+				throw DBopenFaild( fileName );
+
+			fileNames->addElement( fileName );
+			handles->addElement( handle );
+		}
+		entryHandles.addElement( (*handles)[fileIdx] );
+	}
+
+	while( pos < length )
+	{
+		gak::uint32	fileIdx, itemLen;
+		gak::int64	position;
+
+		if( !readValue( payload, length, &pos, &fileIdx )
+		|| !readValue( payload, length, &pos, &position )
+		|| !readValue( payload, length, &pos, &itemLen )
+		|| length - pos < itemLen || fileIdx >= entryHandles.size() )
+/*v*/		break;
+
+		if( dbFileWriteAt( entryHandles[fileIdx], position, payload + pos, itemLen ) != long(itemLen) )
+			throw DBopenFaild( (*fileNames)[fileIdx] );
+
+		pos += itemLen;
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	opening a log replays, what a crash has left
+*/
+WriteAheadLog::WriteAheadLog( const STRING &fileName, gak::uint64 checkpointSize )
+: m_fileName( fileName )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "WriteAheadLog::WriteAheadLog" );
+
+	recover( fileName );
+
+	m_handle = dbFileOpen( fileName );
+	if( m_handle <= 0 )
+		throw DBopenFaild( fileName );
+
+	// a log without a real sync would claim a durability it cannot give
+	if( dbFileSync( m_handle ) )
+	{
+		dbFileClose( m_handle );
+		throw DBopenFaild( fileName );
+	}
+
+	m_size = dbFileSize( m_handle );
+	m_checkpointSize = checkpointSize;
+	m_appended = m_durable = 0;
+	m_flushing = m_checkpointing = m_failed = false;
+	m_activeTransactions = 0;
+	m_numCommits = m_numSyncs = 0;
+}
+
+/*
+	the data files are synced, when they are closed. The log is truncated
+	only by a checkpoint.
+*/
+WriteAheadLog::~WriteAheadLog()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "WriteAheadLog::~WriteAheadLog" );
+
+	assert( !m_activeTransactions );
+	dbFileClose( m_handle );
+}
+
+Transaction::Transaction( WriteAheadLog *log )
+{
+	m_log = log;
+	m_active = log && !s_current;
+	if( m_active )
+	{
+		m_log->beginTransaction();
+		s_current = this;
+	}
+}
+
+Transaction::~Transaction()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Transaction::~Transaction" );
+
+	if( m_active )
+	{
+		rollback();
+		finish();
+	}
+}
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+/*
+	replays all complete entries and truncates the log. Replaying twice
+	does no harm, so a crash during the recovery is no problem.
+	returns the number of entries replayed
+*/
+size_t WriteAheadLog::recover( const STRING &fileName )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "WriteAheadLog::recover" );
+
+	if( !fileExists( fileName ) )
+/***/	return 0;
+
+	long	handle = dbFileOpen( fileName );
+	if( handle <= 0 )
+		throw DBopenFaild( fileName );
+
+	gak::int64			size = dbFileSize( handle );
+	std::vector<char>	log( size_t(size > 0 ? size : 0) );
+
+	if( !log.empty() && dbFileReadAt( handle, 0, &log[0], log.size() ) != long(log.size()) )
+	{
+		dbFileClose( handle );
+		throw DBopenFaild( fileName );
+	}
+
+	gak::Array<STRING>	fileNames;
+	gak::Array<long>	handles;
+	size_t				numEntries = 0;
+	size_t				pos = 0;
+
+	try
+	{
+		while( log.size() - pos >= sizeof(EntryHeader) )
+		{
+			EntryHeader	header;
+
+			memcpy( &header, &log[pos], sizeof(header) );
+			pos += sizeof(header);
+
+			// the end of the log was not written completely
+			if( header.magic != ENTRY_MAGIC
+			|| log.size() - pos < header.length
+			|| checksum( &log[pos], header.length ) != header.checksum )
+/*v*/			break;
+
+			replayEntry( &log[pos], header.length, &fileNames, &handles );
+			pos += header.length;
+			numEntries++;
+		}
+	}
+	catch( ... )
+	{
+		for( size_t i=0; i<handles.size(); ++i )
+			dbFileClose( handles[i] );
+		dbFileClose( handle );
+		throw;
+	}
+
+	bool	success = true;
+	for( size_t i=0; i<handles.size(); ++i )
+	{
+		if( dbFileSync( handles[i] ) )
+			success = false;
+		dbFileClose( handles[i] );
+	}
+
+	// the log may go only, if the data is safe
+	if( success && (dbFileTruncate( handle, 0 ) || dbFileSync( handle )) )
+		success = false;
+	dbFileClose( handle );
+
+	if( !success )
+		throw DBopenFaild( fileName );
+
+	return numEntries;
+}
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+/*
+	the mutex must be locked and no transaction may be active
+*/
+void WriteAheadLog::writeCheckpoint()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "WriteAheadLog::writeCheckpoint" );
+
+	assert( !m_activeTransactions && !m_flushing );
+
+	syncOpenFiles();
+	if( dbFileTruncate( m_handle, 0 ) || dbFileSync( m_handle ) )
+		throw DBopenFaild( m_fileName );
+
+	m_size = 0;
+}
+
+size_t Transaction::touchFile( DbFile *file )
+{
+	for( size_t i=0; i<m_files.size(); ++i )
+	{
+		if( m_files[i].file == file )
+/***/		return i;
+	}
+
+	FileState	&state = m_files.createElement();
+	state.file = file;
+	state.fileSize = file->fileSize;
+
+	// without a checkpoint the data must reach the disk when closing
+	file->syncOnClose = true;
+
+	return m_files.size()-1;
+}
+
+void Transaction::releasePages()
+{
+	BufferPool	&pool = BufferPool::getPool();
+
+	for( size_t i=0; i<m_writes.size(); ++i )
+		pool.releasePage( m_writes[i].frameIdx );
+
+	m_writes.clear();
+	m_files.clear();
+	m_undo.clear();
+	m_redo.clear();
+}
+
+void Transaction::rollback()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Transaction::rollback" );
+
+	BufferPool	&pool = BufferPool::getPool();
+
+	for( size_t i=m_writes.size(); i>0; --i )
+	{
+		const Write	&write = m_writes[i-1];
+
+		memcpy(
+			pool.getPageData( write.frameIdx ) + write.pageOffset,
+			&m_undo[write.undoOffset], write.length
+		);
+	}
+	for( size_t i=0; i<m_files.size(); ++i )
+		m_files[i].file->fileSize = m_files[i].fileSize;
+
+	releasePages();
+}
+
+void Transaction::finish()
+{
+	s_current = NULL;
+	m_active = false;
+	m_log->endTransaction();
+}
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+void WriteAheadLog::beginTransaction()
+{
+	std::unique_lock<std::mutex>	lock( m_mutex );
+
+	while( m_checkpointing )
+		m_changed.wait( lock );
+
+	m_activeTransactions++;
+}
+
+/*
+	the checkpoint is done by the last transaction, when the log has
+	become too large
+*/
+void WriteAheadLog::endTransaction()
+{
+	std::lock_guard<std::mutex>	lock( m_mutex );
+
+	assert( m_activeTransactions > 0 );
+	m_activeTransactions--;
+	if( !m_activeTransactions && !m_checkpointing && !m_failed
+	&& gak::uint64(m_size) >= m_checkpointSize )
+	{
+		try
+		{
+			writeCheckpoint();
+		}
+		catch( ... )
+		{
+			// the log is still valid, the next checkpoint will try again
+		}
+	}
+	m_changed.notify_all();
+}
+
+/*
+	appends the entry and waits until it is on the disk. If no other
+	thread is writing, this thread writes all pending entries, otherwise
+	it waits for the writer and may find it's entry written with the
+	others.
+*/
+void WriteAheadLog::commit( const std::vector<char> &entry )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "WriteAheadLog::commit" );
+
+	std::unique_lock<std::mutex>	lock( m_mutex );
+
+	if( m_failed )
+		throw DBopenFaild( m_fileName );
+
+	m_pending.insert( m_pending.end(), entry.begin(), entry.end() );
+	gak::uint64	entryNo = ++m_appended;
+	m_numCommits++;
+
+	while( m_durable < entryNo )
+	{
+		if( m_failed )
+			throw DBopenFaild( m_fileName );
+
+		if( m_flushing )
+		{
+			m_changed.wait( lock );
+/*^*/		continue;
+		}
+
+		std::vector<char>	batch;
+		batch.swap( m_pending );
+
+		gak::uint64	lastEntry = m_appended;
+		gak::int64	position = m_size;
+
+		m_flushing = true;
+		lock.unlock();
+
+		bool	success = dbFileWriteAt( m_handle, position, &batch[0], batch.size() ) == long(batch.size())
+						&& !dbFileSync( m_handle );
+
+		lock.lock();
+		m_flushing = false;
+		if( success )
+		{
+			m_size += batch.size();
+			m_durable = lastEntry;
+			m_numSyncs++;
+		}
+		else
+			m_failed = true;		// all waiting transactions are rolled back
+		m_changed.notify_all();
+	}
+}
+
+/*
+	waits for the active transactions, writes all pages and truncates the
+	log. Must be called before the data files are replaced by other means
+	than transactions.
+*/
+void WriteAheadLog::checkpoint()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "WriteAheadLog::checkpoint" );
+
+	// we would wait for ourself
+	assert( !Transaction::getCurrent() );
+
+	std::unique_lock<std::mutex>	lock( m_mutex );
+
+	while( m_checkpointing )
+		m_changed.wait( lock );
+
+	m_checkpointing = true;
+	while( m_activeTransactions || m_flushing )
+		m_changed.wait( lock );
+
+	try
+	{
+		writeCheckpoint();
+	}
+	catch( ... )
+	{
+		m_checkpointing = false;
+		m_changed.notify_all();
+		throw;
+	}
+	m_checkpointing = false;
+	m_changed.notify_all();
+}
+
+/*
+	writes the log entry and releases the pages
+*/
+void Transaction::commit()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Transaction::commit" );
+
+	if( !m_active )
+/***/	return;
+
+	if( !m_redo.empty() )
+	{
+		std::vector<char>	entry( sizeof(EntryHeader) );
+
+		appendValue( &entry, gak::uint32(m_files.size()) );
+		for( size_t i=0; i<m_files.size(); ++i )
+		{
+			const char	*fileName = m_files[i].file->getFileName();
+			size_t		nameLen = strlen( fileName ) + 1;
+
+			appendValue( &entry, gak::uint32(nameLen) );
+			entry.insert( entry.end(), fileName, fileName+nameLen );
+		}
+		entry.insert( entry.end(), m_redo.begin(), m_redo.end() );
+
+		EntryHeader	header;
+		header.magic = ENTRY_MAGIC;
+		header.length = gak::uint32(entry.size() - sizeof(EntryHeader));
+		header.checksum = checksum( &entry[sizeof(EntryHeader)], header.length );
+		memcpy( &entry[0], &header, sizeof(header) );
+
+		// if this fails, the destructor restores the old data
+		m_log->commit( entry );
+	}
+
+	releasePages();
+	finish();
+}
+
+/*
+	called by DbFile::write for each page. The caller has pinned the page
+	and has not yet copied the new data.
+*/
+void Transaction::addWrite(
+	DbFile *file, size_t frameIdx, gak::int64 position,
+	char *pageData, const void *newData, size_t length
+)
+{
+	size_t	fileIdx = touchFile( file );
+	size_t	pageOffset = size_t(position % BufferPool::PAGE_SIZE);
+
+	Write	&write = m_writes.createElement();
+	write.frameIdx = frameIdx;
+	write.pageOffset = pageOffset;
+	write.undoOffset = m_undo.size();
+	write.length = length;
+	m_undo.insert( m_undo.end(), pageData+pageOffset, pageData+pageOffset+length );
+
+	appendValue( &m_redo, gak::uint32(fileIdx) );
+	appendValue( &m_redo, position );
+	appendValue( &m_redo, gak::uint32(length) );
+	const char	*source = static_cast<const char *>(newData);
+	m_redo.insert( m_redo.end(), source, source+length );
+
+	BufferPool::getPool().holdPage( frameIdx );
+}
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
@@ -0,0 +1,275 @@
+/*
+		Project:		dbLIB
+		Module:			db_wal.h
+		Description:	the write ahead log
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify  
+		it under the terms of the GNU General Public License as published by  
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License 
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+#ifndef DB_WAL_H
+#define DB_WAL_H
+
+// --------------------------------------------------------------------- //
+// ----- switches ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- includes ------------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+#include <stddef.h>
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include <gak/types.h>
+#include <gak/array.h>
+#include <gak/string.h>
+
+// --------------------------------------------------------------------- //
+// ----- imported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module switches ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+#ifdef __BORLANDC__
+#	pragma option -RT-
+#	ifdef __WIN32__
+#		pragma option -a4
+#		pragma option -pc
+#	else
+#		pragma option -po
+#		pragma option -a2
+#	endif
+#endif
+
+namespace dbLib
+{
+
+// --------------------------------------------------------------------- //
+// ----- constants ----------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- macros -------------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- type definitions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class definitions --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+class DbFile;
+
+/*
+	the redo log of a database. Each transaction appends the new bytes of
+	all it's writes as one entry. The entry is synced before the pages may
+	reach the data files, so after a crash the entries can be replayed.
+	Transactions committing at the same time share one sync. A checkpoint
+	syncs all data files and truncates the log.
+
+	The entries are written in native byte order, a log cannot be moved
+	to another platform.
+*/
+class WriteAheadLog
+{
+	public:
+	static const gak::uint64	DEFAULT_CHECKPOINT_SIZE = 16*1024*1024;
+
+	private:
+	gak::STRING				m_fileName;
+	long					m_handle;
+	gak::int64				m_size;
+	gak::uint64				m_checkpointSize;
+
+	/*
+		group commit: the first thread waiting for it's entry writes and
+		syncs all pending entries, the others wait for the result
+	*/
+	std::mutex				m_mutex;
+	std::condition_variable	m_changed;
+	std::vector<char>		m_pending;
+	gak::uint64				m_appended, m_durable;
+	bool					m_flushing, m_checkpointing;
+	bool					m_failed;
+	size_t					m_activeTransactions;
+
+	gak::uint64				m_numCommits, m_numSyncs;
+
+	void writeCheckpoint();
+
+	public:
+	WriteAheadLog( const gak::STRING &fileName, gak::uint64 checkpointSize=DEFAULT_CHECKPOINT_SIZE );
+	~WriteAheadLog();
+
+	static size_t recover( const gak::STRING &fileName );
+
+	void beginTransaction();
+	void endTransaction();
+	void commit( const std::vector<char> &entry );
+	void checkpoint();
+
+	const gak::STRING &getFileName() const
+	{
+		return m_fileName;
+	}
+	gak::int64 getSize() const
+	{
+		return m_size;
+	}
+	gak::uint64 getNumCommits() const
+	{
+		return m_numCommits;
+	}
+	gak::uint64 getNumSyncs() const
+	{
+		return m_numSyncs;
+	}
+};
+
+/*
+	collects the writes of one thread. The pages written remain pinned
+	until the end, so the buffer pool cannot write uncommitted data.
+	Without commit all old bytes are restored.
+
+	Transactions of one thread nest, only the outermost one commits. So
+	an application can put several posts into one transaction and one sync.
+*/
+class Transaction
+{
+	struct Write
+	{
+		size_t		frameIdx;
+		size_t		pageOffset;
+		size_t		undoOffset;
+		size_t		length;
+	};
+	struct FileState
+	{
+		DbFile		*file;
+		gak::int64	fileSize;
+	};
+
+	WriteAheadLog			*m_log;
+	bool					m_active;
+	gak::Array<Write>		m_writes;
+	gak::Array<FileState>	m_files;
+	std::vector<char>		m_undo;
+	std::vector<char>		m_redo;
+
+	static thread_local Transaction	*s_current;
+
+	size_t touchFile( DbFile *file );
+	void releasePages();
+	void rollback();
+	void finish();
+
+	Transaction( const Transaction & );
+	const Transaction & operator = ( const Transaction & );
+
+	public:
+	explicit Transaction( WriteAheadLog *log );
+	~Transaction();
+
+	void commit();
+
+	static Transaction *getCurrent()
+	{
+		return s_current;
+	}
+	void addWrite(
+		DbFile *file, size_t frameIdx, gak::int64 position,
+		char *pageData, const void *newData, size_t length
+	);
+};
+
+// --------------------------------------------------------------------- //
+// ----- exported datas ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module static data -------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static data --------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- prototypes ---------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- module functions ---------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class privates ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class protected ----------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class virtuals ------------------------------------------------ //
+// --------------------------------------------------------------------- //
+   
+// --------------------------------------------------------------------- //
+// ----- class publics ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- entry points -------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+} // namespace dbLib
+
+#ifdef __BORLANDC__
+#	pragma option -RT.
+#	pragma option -a.
+#	pragma option -p.
+#endif
+
+#endif
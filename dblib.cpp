@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			dblib.cpp
 		Description:	the unit test
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -30,15 +30,20 @@
 */
 
 #include <memory>
+#include <fstream>
+#include <random>
+#include <vector>
 
 #include <gak/unitTest.h>
 #include <gak/directory.h>
 
 #include "db_exception.h"
+#include "db_buffer_pool.h"
 
 #include "database.h"
 #include "table.h"
 #include "record.h"
+#include "db_typed_table.h"
 
 using gak::STRING;
 using gak::F_STRING;
@@ -65,6 +70,36 @@ const char THIRD_INDEX[] = "THIRD_INDEX";
 const char FORTH_INDEX_FIELD[] = "FORTH_INDEX_FIELD";
 const char FORTH_INDEX[] = "FORTH_INDEX";
 
+const char formatTable[] = "formatTable";
+const char legacyTable[] = "legacyTable";
+const char decimalTable[] = "decimalTable";
+const char reuseTable[] = "reuseTable";
+const char bulkTable[] = "bulkTable";
+const char orderTable[] = "orderTable";
+const char walTable[] = "walTable";
+const char btreeTable[] = "btreeTable";
+const char heapTable[] = "heapTable";
+const char balanceTable[] = "balanceTable";
+const char NUMBER_FIELD[] = "NUMBER_FIELD";
+const char DATE_FIELD[] = "DATE_FIELD";
+const char DATE_INDEX[] = "DATE_INDEX";
+
+struct OrderSchema
+{
+	DB_SCHEMA_FIELD( Number, ftNumber, 0, NUMBER_FIELD );
+	DB_SCHEMA_FIELD( Date, ftDate, 1, DATE_FIELD );
+
+	typedef dbLib::SchemaFields<Number, Date>	Fields;
+};
+
+struct WrongSchema
+{
+	DB_SCHEMA_FIELD( Number, ftInteger, 0, NUMBER_FIELD );
+	DB_SCHEMA_FIELD( Date, ftDate, 1, DATE_FIELD );
+
+	typedef dbLib::SchemaFields<Number, Date>	Fields;
+};
+
 class MydbUnitTest : public gak::UnitTest
 {
 	virtual const char *GetClassName() const
@@ -77,6 +112,15 @@ class MydbUnitTest : public gak::UnitTest
 
 	void createIndexTable(dbLib::Database *db);
 
+	void createKeyTable(
+		dbLib::Database *db, const char *name,
+		int formatVersion=dbLib::fvCurrent, const char *payloadField=NULL
+	);
+	void fillKeyTable(
+		dbLib::Table *tab, int from, int to,
+		const char *payloadField=NULL, char payload='x'
+	);
+
 	void createTable(dbLib::Database *db);
 	void fillTable(dbLib::Table *tab);
 
@@ -89,6 +133,19 @@ class MydbUnitTest : public gak::UnitTest
 
 	void simpleTest(dbLib::Database *db);
 	void indexTest(dbLib::Database *db);
+	void formatTest(dbLib::Database *db);
+	void legacyTest(dbLib::Database *db);
+	void mappingTest(dbLib::Database *db);
+	void assertOrder(dbLib::Table *tab, int expected);
+	void reuseTest(dbLib::Database *db);
+	void compactTest(dbLib::Database *db);
+	void bulkTest(dbLib::Database *db);
+	void orderTest(dbLib::Database *db);
+	void walTest(dbLib::Database *db);
+	void btreeTest(dbLib::Database *db);
+	void heapTest(dbLib::Database *db);
+	void assertBalance(dbLib::Table *tab);
+	void balanceTest(dbLib::Database *db);
 
 	virtual void PerformTest();
 };
@@ -132,9 +189,9 @@ void MydbUnitTest::fillTable(dbLib::Table *tab)
 	int i=0;
 
 	tab->insertRecord();
-	tab->getField( my_FIRST_field )->setStringValue( "Bldmann" );
+	tab->getField( my_FIRST_field )->setStringValue( "Blödmann" );
 	tab->getField( MY_SECOND_FIELD )->setStringValue( "Dummkopf" );
-	tab->getField( MY_THIRD_FIELD )->setStringValue( "Knalltte" );
+	tab->getField( MY_THIRD_FIELD )->setStringValue( "Knalltüte" );
 	tab->getField( UNIQUE_INT_FIELD )->setIntegerValue( ++i );
 	tab->getField( NORMAL_INT_FIELD )->setIntegerValue( INT_FILTER );
 	tab->getField( BOOL_FIELD )->setBooleanValue( false );
@@ -144,7 +201,7 @@ void MydbUnitTest::fillTable(dbLib::Table *tab)
 	tab->insertRecord();
 	tab->getField( my_FIRST_field )->setStringValue( "Martin" );
 	tab->getField( MY_SECOND_FIELD )->setStringValue( "Richard" );
-	tab->getField( MY_THIRD_FIELD )->setStringValue( "Gckler" );
+	tab->getField( MY_THIRD_FIELD )->setStringValue( "Gäckler" );
 	tab->getField( UNIQUE_INT_FIELD )->setIntegerValue( ++i );
 	tab->getField( NORMAL_INT_FIELD )->setIntegerValue( INT_FILTER );
 	tab->getField( BOOL_FIELD )->setBooleanValue( true );
@@ -307,10 +364,7 @@ void MydbUnitTest::processTablesNullNkeyViolation(dbLib::Table *tab)
 void MydbUnitTest::assertRecords(dbLib::Table *tab, gak::int64 expected)
 {
 	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::processTables4" );
-	tab->root();
-	const dbLib::Record &record = tab->getRecord();
-	const dbLib::RecordHeader &header = record.getHeader();
-	UT_ASSERT_EQUAL( header.numRecords, expected );
+	UT_ASSERT_EQUAL( tab->getNumRecords(), expected );
 }
 
 void MydbUnitTest::processTablesEmptyTable(dbLib::Table *tab)
@@ -322,12 +376,20 @@ void MydbUnitTest::processTablesEmptyTable(dbLib::Table *tab)
 		tab->deleteRecord();
 	}
 	UT_ASSERT_EXCEPTION(
-		tab->getField( "test" )->setStringValue( "Bldmann" ), 
+		tab->getField( "test" )->setStringValue( "Blödmann" ), 
 		dbLib::DBfieldNotFound
 	);
 }
 
 
+static void copyFile( const STRING &source, const STRING &target )
+{
+	std::ifstream	in( source, std::ios::binary );
+	std::ofstream	out( target, std::ios::binary|std::ios::trunc );
+
+	out << in.rdbuf();
+}
+
 // ******************************************************************************************************************************************
 // the simple test
 // ******************************************************************************************************************************************
@@ -539,6 +601,1339 @@ void MydbUnitTest::indexTest(dbLib::Database *db)
 	);
 }
 
+// ******************************************************************************************************************************************
+// the tables with a primary key and a secondary index
+// ******************************************************************************************************************************************
+static STRING makeString( char c, int len )
+{
+	STRING	result;
+
+	while( len-- > 0 )
+		result += c;
+
+	return result;
+}
+
+void MydbUnitTest::createKeyTable(
+	dbLib::Database *db, const char *name, int formatVersion, const char *payloadField
+)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::createKeyTable" );
+
+	std::auto_ptr<dbLib::Table> 	 t1( db->createTable( name ) );
+
+	if( formatVersion != dbLib::fvCurrent )
+		t1->create( formatVersion );
+	t1->addField( PRIM_INDEX_FIELD, dbLib::ftInteger, true, true );
+	t1->addField( SEC_INDEX_FIELD, dbLib::ftInteger );
+	if( payloadField )
+		t1->addField( payloadField, dbLib::ftString );
+
+	t1->createIndex( SEC_INDEX );
+	t1->addFieldToIndex( SEC_INDEX, SEC_INDEX_FIELD, true, true );
+}
+
+/*
+	posts the keys from up to to, the secondary index gets them negated.
+	The length of the payload depends on the key.
+*/
+void MydbUnitTest::fillKeyTable(
+	dbLib::Table *tab, int from, int to, const char *payloadField, char payload
+)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::fillKeyTable" );
+
+	for( int i=from; i<=to; ++i )
+	{
+		tab->insertRecord();
+		tab->getField( PRIM_INDEX_FIELD )->setIntegerValue( i );
+		tab->getField( SEC_INDEX_FIELD )->setIntegerValue( -i );
+		if( payloadField )
+			tab->getField( payloadField )->setStringValue( makeString( payload, i%37 ) );
+		tab->postRecord();
+	}
+}
+
+// ******************************************************************************************************************************************
+// the format conversion test
+// ******************************************************************************************************************************************
+void MydbUnitTest::formatTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::formatTest" );
+
+	const int numData = 100;
+
+	createKeyTable( db, formatTable, dbLib::fvAsciiHeader );
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( formatTable ) );
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvAsciiHeader) );
+
+	fillKeyTable( tt.get(), 1, numData );
+
+	tt->convertFormat();
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvCurrent) );
+	UT_ASSERT_EQUAL( tt->getNumRecords(), numData );
+
+	int prevValue = 0;
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		int newValue = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_LESS( prevValue, newValue );
+		prevValue = newValue;
+	}
+	UT_ASSERT_EQUAL( prevValue, numData );
+
+	tt->setIndex( SEC_INDEX );
+	prevValue = numData+1;
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		int newValue = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_GREATER( prevValue, newValue );
+		prevValue = newValue;
+	}
+	UT_ASSERT_EQUAL( prevValue, 1 );
+	tt.reset();
+
+	// the numbers of older files are decimal and sorted as text
+	{
+		std::auto_ptr<dbLib::Table> 	 t1( db->createTable( decimalTable ) );
+
+		t1->create( dbLib::fvRootLink );
+		t1->addField( NUMBER_FIELD, dbLib::ftNumber, true, true );
+		t1->addField( PRIM_INDEX_FIELD, dbLib::ftInteger );
+
+		t1->createIndex( SEC_INDEX );
+		t1->addFieldToIndex( SEC_INDEX, PRIM_INDEX_FIELD, true, true );
+	}
+
+	static const char *decimals[] =
+	{
+		"-2.5", "0.5", "9", "10", "100", "1234567.89012345"
+	};
+	const int	numDecimals = int(sizeof(decimals)/sizeof(decimals[0]));
+
+	tt.reset( db->openTable( decimalTable ) );
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvRootLink) );
+	{
+		// the table refuses to write them, so we must go below
+		dbLib::Index	*data = tt.get();
+		for( int i=0; i<numDecimals; ++i )
+		{
+			tt->insertRecord();
+			tt->getField( NUMBER_FIELD )->setStringValue( decimals[i] );
+			tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( i+1 );
+			data->m_currentRecord.postRecord( data->m_dataFileHandle, data->getBalanceAlpha() );
+		}
+	}
+
+	// they are read as numbers, even with 16 digits
+	double	sum = 0;
+	int		count = 0;
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		const int	i = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue() - 1;
+		UT_ASSERT_EQUAL( tt->getField( NUMBER_FIELD )->getDoubleValue(), atof( decimals[i] ) );
+		sum += tt->getField( NUMBER_FIELD )->getDoubleValue();
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, numDecimals );
+	tt->lastRecord();
+	UT_ASSERT_EQUAL( tt->getField( NUMBER_FIELD )->getDoubleValue(), 9.0 );
+
+	{
+		dbLib::RecordView	view;
+		double				viewSum = 0;
+
+		tt->setRecordView( &view );
+		for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+			viewSum += view.getDoubleValue( 0 );
+		tt->setRecordView( NULL );
+		UT_ASSERT_EQUAL( viewSum, sum );
+	}
+
+	// ordered numbers must not be mixed into the decimal ones
+	tt->firstRecord();
+	UT_ASSERT_EXCEPTION( tt->postRecord(), dbLib::DBformatTooOld );
+	UT_ASSERT_EXCEPTION( tt->deleteRecord(), dbLib::DBformatTooOld );
+	tt->insertRecord();
+	tt->getField( NUMBER_FIELD )->setDoubleValue( 5.0 );
+	tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( numDecimals+1 );
+	UT_ASSERT_EXCEPTION( tt->postRecord(), dbLib::DBformatTooOld );
+
+	// the keys are decimal text, too, a search with ordered numbers would miss them
+	const STRING	nine = dbLib::FieldValue::convertFieldType<double>( 9.0 );
+	const STRING	ten = dbLib::FieldValue::convertFieldType<double>( 10.0 );
+	UT_ASSERT_EXCEPTION( tt->firstRecord( nine ), dbLib::DBformatTooOld );
+	UT_ASSERT_EXCEPTION( tt->lastRecord( nine ), dbLib::DBformatTooOld );
+	UT_ASSERT_EXCEPTION(
+		tt->countRange( dbLib::FieldValue::convertFieldType<double>( 1.0 ), ten ),
+		dbLib::DBformatTooOld
+	);
+	UT_ASSERT_EXCEPTION(
+		tt->firstRecord( dbLib::KeyRange( nine, true, ten, true ) ),
+		dbLib::DBformatTooOld
+	);
+	{
+		dbLib::Index	*data = tt.get();
+		gak::int64		posFound;
+		UT_ASSERT_EXCEPTION( data->locateValue( &posFound, nine, true ), dbLib::DBformatTooOld );
+		UT_ASSERT_EXCEPTION( data->locateEntry( nine ), dbLib::DBformatTooOld );
+	}
+
+	tt->convertFormat();
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvCurrent) );
+	UT_ASSERT_EQUAL( tt->getNumRecords(), numDecimals );
+
+	count = 0;
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		++count;
+		UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), count );
+		UT_ASSERT_EQUAL( tt->getField( NUMBER_FIELD )->getDoubleValue(), atof( decimals[count-1] ) );
+	}
+	UT_ASSERT_EQUAL( count, numDecimals );
+
+	tt->firstRecord( dbLib::FieldValue::convertFieldType<double>( 9.0 ) );
+	UT_ASSERT_FALSE( tt->eof() );
+	UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 3 );
+
+	tt->insertRecord();
+	tt->getField( NUMBER_FIELD )->setDoubleValue( 5.0 );
+	tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( numDecimals+1 );
+	tt->postRecord();
+	UT_ASSERT_EQUAL( tt->countRange(
+		dbLib::FieldValue::convertFieldType<double>( 0.5 ),
+		dbLib::FieldValue::convertFieldType<double>( 9.0 )
+	), 3 );
+
+	tt->setIndex( SEC_INDEX );
+	count = 0;
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+		UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), ++count );
+	UT_ASSERT_EQUAL( count, numDecimals+1 );
+	tt->setIndex( "" );
+}
+
+// ******************************************************************************************************************************************
+// the old formats without conversion
+// ******************************************************************************************************************************************
+void MydbUnitTest::legacyTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::legacyTest" );
+
+	const int numData = 10;
+
+	createKeyTable( db, legacyTable, dbLib::fvBinaryHeader );
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( legacyTable ) );
+
+	fillKeyTable( tt.get(), 1, numData );
+
+	// these files keep every deleted record in the tree, not only the root
+	for( tt->firstRecord(); !tt->eof(); )
+	{
+		const int value = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		if( value == 3 || value == 7 || value == 9 )
+			tt->deleteRecord();
+		else
+			tt->nextRecord();
+	}
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvBinaryHeader) );
+
+	dbLib::TreeReport	report;
+	tt->analyzeTree( &report );
+	UT_ASSERT_EQUAL( report.deletedNodes, gak::uint64(3) );
+	UT_ASSERT_EQUAL( report.getLiveRecords(), gak::uint64(numData-3) );
+
+	assertOrder( tt.get(), numData-3 );
+	UT_ASSERT_EQUAL( tt->countRange( "", "" ), numData-3 );
+	UT_ASSERT_TRUE( tt->seekToRank( 2 ) );
+	UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 4 );
+	UT_ASSERT_TRUE( tt->seekToRank( 6 ) );
+	UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), numData );
+	UT_ASSERT_EQUAL( tt->getRank(), 6 );
+	UT_ASSERT_EQUAL( tt->getNumRecords(), numData-3 );
+
+	// the scans of unthreaded files walk along a path
+	const int bigData = 300;
+	fillKeyTable( tt.get(), numData+1, bigData );
+	assertOrder( tt.get(), bigData-3 );
+
+	const STRING	prefix = dbLib::FieldValue::convertFieldType<long>( 256 ).leftString( 15 );
+	int				count = 0;
+	for( tt->firstRecord( prefix ); !tt->eof(); tt->nextRecord() )
+	{
+		UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 256+count );
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, 16 );
+	for( tt->lastRecord( prefix ); !tt->bof(); tt->previousRecord() )
+	{
+		--count;
+		UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 256+count );
+	}
+	UT_ASSERT_EQUAL( count, 0 );
+
+	// any write to the file, even by another cursor, invalidates the path
+	std::auto_ptr<dbLib::Table> 	 other( db->openTable( legacyTable ) );
+	int		prevValue = 0;
+
+	tt->firstRecord();
+	while( !tt->eof() )
+	{
+		const int value = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_LESS( prevValue, value );
+		prevValue = value;
+		if( value % 50 == 10 )
+		{
+			tt->deleteRecord();
+/*^*/		continue;
+		}
+
+		++count;
+		if( value % 50 == 0 )
+			fillKeyTable( other.get(), bigData + value/50, bigData + value/50 );
+		tt->nextRecord();
+	}
+	UT_ASSERT_EQUAL( count, bigData-3 );
+	UT_ASSERT_EQUAL( prevValue, bigData+6 );
+
+	count = 0;
+	prevValue = std::numeric_limits<int>::max();
+	for( tt->lastRecord(); !tt->bof(); tt->previousRecord() )
+	{
+		const int value = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_GREATER( prevValue, value );
+		prevValue = value;
+		++count;
+		if( value % 50 == 40 )
+			tt->deleteRecord();
+		else if( value % 50 == 25 )
+		{
+			tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -value );
+			tt->postRecord();
+		}
+	}
+	UT_ASSERT_EQUAL( count, bigData-3 );
+	UT_ASSERT_EQUAL( prevValue, 1 );
+
+	other.reset();
+	assertOrder( tt.get(), bigData-9 );
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvBinaryHeader) );
+}
+
+// ******************************************************************************************************************************************
+// the free space test
+// ******************************************************************************************************************************************
+void MydbUnitTest::assertOrder(dbLib::Table *tab, int expected)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::assertOrder" );
+
+	int count = 0;
+	int prevValue = -1;
+	int middleValue = -1;
+
+	tab->setIndex( "" );
+	for( tab->firstRecord(); !tab->eof(); tab->nextRecord() )
+	{
+		int newValue = tab->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_LESS( prevValue, newValue );
+		UT_ASSERT_EQUAL( tab->getRank(), count );
+		if( count == expected/2 )
+			middleValue = newValue;
+		prevValue = newValue;
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, expected );
+
+	// order statistics
+	UT_ASSERT_EQUAL( tab->countRange( "", "" ), expected );
+	UT_ASSERT_FALSE( tab->seekToRank( expected ) );
+	UT_ASSERT_TRUE( tab->eof() );
+	if( expected )
+	{
+		UT_ASSERT_TRUE( tab->seekToRank( expected/2 ) );
+		UT_ASSERT_EQUAL( tab->getField( PRIM_INDEX_FIELD )->getIntegerValue(), middleValue );
+		UT_ASSERT_EQUAL( tab->getRank(), expected/2 );
+	}
+
+	// the same records backwards
+	count = 0;
+	prevValue = std::numeric_limits<int>::max();
+	for( tab->lastRecord(); !tab->bof(); tab->previousRecord() )
+	{
+		int newValue = tab->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_GREATER( prevValue, newValue );
+		prevValue = newValue;
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, expected );
+
+	count = 0;
+	prevValue = std::numeric_limits<int>::min();
+	tab->setIndex( SEC_INDEX );
+	for( tab->firstRecord(); !tab->eof(); tab->nextRecord() )
+	{
+		int newValue = tab->getField( SEC_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_LESS( prevValue, newValue );
+		UT_ASSERT_EQUAL( newValue, -tab->getField( PRIM_INDEX_FIELD )->getIntegerValue() );
+		UT_ASSERT_EQUAL( tab->getRank(), count );
+		prevValue = newValue;
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, expected );
+	tab->setIndex( "" );
+
+	UT_ASSERT_EQUAL( tab->getNumRecords(), expected );
+}
+
+void MydbUnitTest::reuseTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::reuseTest" );
+
+	const int numData = 200;
+	const int numUpdates = 10;
+
+	createKeyTable( db, reuseTable, dbLib::fvCurrent, MY_SECOND_FIELD );
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( reuseTable ) );
+
+	fillKeyTable( tt.get(), 1, numData, MY_SECOND_FIELD );
+	assertOrder( tt.get(), numData );
+
+	const gak::int64 initialSize = tt->getDataFileSize();
+
+	// updates with changing record sizes must not let the file grow without limit
+	for( int u=1; u<=numUpdates; ++u )
+	{
+		for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+		{
+			int i = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+			tt->getField( MY_SECOND_FIELD )->setStringValue( makeString( 'y', (i*u)%41 ) );
+			tt->postRecord();
+		}
+		assertOrder( tt.get(), numData );
+	}
+	UT_ASSERT_LESS( tt->getDataFileSize(), 3*initialSize );
+
+	// delete every second record and fill the gaps
+	tt->firstRecord();
+	while( !tt->eof() && !tt->bof() )
+	{
+		tt->deleteRecord();
+		if( !tt->eof() && !tt->bof() )
+			tt->nextRecord();
+	}
+	assertOrder( tt.get(), numData/2 );
+
+	// the deleted records are either free or still in the tree
+	dbLib::TreeReport	report;
+	tt->analyzeTree( &report );
+	UT_ASSERT_EQUAL( report.getLiveRecords(), gak::uint64(numData/2) );
+	UT_ASSERT_EQUAL( report.levels.size(), size_t(report.maxDepth) );
+	UT_ASSERT_GREATER( report.freeRecords + report.deletedNodes, gak::uint64(0) );
+	UT_ASSERT_LESSEQ( report.deletedBytes + report.freeBytes, report.getWastedBytes() );
+	UT_ASSERT_LESSEQ( report.getOptimalDepth(), report.maxDepth );
+	UT_ASSERT_LESSEQ( report.maxDepth, 3*report.getOptimalDepth() );
+
+	gak::uint64	levelNodes = 0;
+	for( size_t i=0; i<report.levels.size(); ++i )
+		levelNodes += report.levels[i].nodes;
+	UT_ASSERT_EQUAL( levelNodes, report.treeNodes );
+
+	tt->analyzeIndex( SEC_INDEX, &report );
+	UT_ASSERT_EQUAL( report.getLiveRecords(), gak::uint64(numData/2) );
+
+	const gak::int64 deletedSize = tt->getDataFileSize();
+	fillKeyTable( tt.get(), numData+1, numData+numData/2, MY_SECOND_FIELD, 'z' );
+	assertOrder( tt.get(), numData );
+	UT_ASSERT_EQUAL( tt->getDataFileSize(), deletedSize );
+
+	// deleting from one end must keep the tree balanced, the root goes, too
+	tt->firstRecord();
+	for( int i=0; i<numData/2; ++i )
+		tt->deleteRecord();
+	assertOrder( tt.get(), numData/2 );
+
+	tt->analyzeTree( &report );
+	UT_ASSERT_EQUAL( report.deletedNodes, gak::uint64(0) );
+	UT_ASSERT_LESSEQ( report.maxDepth, 3*report.getOptimalDepth() );
+
+	tt->firstRecord();
+	while( !tt->eof() && !tt->bof() )
+		tt->deleteRecord();
+	assertOrder( tt.get(), 0 );
+
+	tt->analyzeTree( &report );
+	UT_ASSERT_EQUAL( report.treeNodes, gak::uint64(0) );
+	UT_ASSERT_LESSEQ( gak::uint64(numData), report.freeRecords );
+
+	fillKeyTable( tt.get(), 1, numData, MY_SECOND_FIELD );
+	assertOrder( tt.get(), numData );
+	UT_ASSERT_EQUAL( tt->getDataFileSize(), deletedSize );
+
+	// another cursor deletes the current record and reuses its space
+	std::auto_ptr<dbLib::Table> 	 other( db->openTable( reuseTable ) );
+
+	other->firstRecord();
+	while( !other->eof() && other->getField( PRIM_INDEX_FIELD )->getIntegerValue() != 100 )
+		other->nextRecord();
+	const gak::int64 otherPos = other->getRecord().getCurrentPosition();
+
+	tt->firstRecord();
+	while( !tt->eof() )
+	{
+		int i = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		if( i == 100 || i == 101 )
+			tt->deleteRecord();
+		else
+			tt->nextRecord();
+	}
+	bool reused = false;
+	for( int i=500; i<=502; ++i )
+	{
+		tt->insertRecord();
+		tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( i );
+		tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -i );
+		tt->getField( MY_SECOND_FIELD )->setStringValue( makeString( 'x', (i-400)%37 ) );
+		tt->postRecord();
+		reused = reused || tt->getRecord().getCurrentPosition() == otherPos;
+	}
+	UT_ASSERT_TRUE( reused );
+
+	int expected = 102;
+	for( other->nextRecord(); !other->eof(); other->nextRecord() )
+	{
+		UT_ASSERT_EQUAL( other->getField( PRIM_INDEX_FIELD )->getIntegerValue(), expected );
+		expected = expected == numData ? 500 : expected+1;
+	}
+	UT_ASSERT_EQUAL( expected, 503 );
+
+	// the same backwards
+	other->firstRecord();
+	while( !other->eof() && other->getField( PRIM_INDEX_FIELD )->getIntegerValue() != 150 )
+		other->nextRecord();
+
+	tt->firstRecord();
+	while( !tt->eof() && tt->getField( PRIM_INDEX_FIELD )->getIntegerValue() != 150 )
+		tt->nextRecord();
+	tt->deleteRecord();
+	tt->insertRecord();
+	tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( 550 );
+	tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -550 );
+	tt->getField( MY_SECOND_FIELD )->setStringValue( makeString( 'x', 150%37 ) );
+	tt->postRecord();
+
+	other->previousRecord();
+	UT_ASSERT_FALSE( other->bof() );
+	UT_ASSERT_EQUAL( other->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 149 );
+	assertOrder( tt.get(), numData+1 );
+}
+
+// ******************************************************************************************************************************************
+// the compaction test
+// ******************************************************************************************************************************************
+void MydbUnitTest::compactTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::compactTest" );
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( reuseTable ) );
+	std::auto_ptr<dbLib::Table> 	 reader( db->openTable( reuseTable ) );
+
+	int numData = int(tt->getNumRecords());
+
+	// delete every third record to get some garbage
+	tt->firstRecord();
+	while( !tt->eof() && !tt->bof() )
+	{
+		if( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue() % 3 == 0 )
+		{
+			tt->deleteRecord();
+			--numData;
+		}
+		else
+			tt->nextRecord();
+	}
+	assertOrder( tt.get(), numData );
+
+	const gak::int64 oldSize = tt->getDataFileSize();
+
+	// the reader works between the steps, the writer restarts the compaction
+	int numSteps = 0;
+	while( !tt->compactStep( 16 ) )
+	{
+		UT_ASSERT_EQUAL( reader->getNumRecords(), numData );
+		if( ++numSteps == 5 )
+		{
+			tt->insertRecord();
+			tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( 1000 );
+			tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -1000 );
+			tt->getField( MY_SECOND_FIELD )->setStringValue( "compact" );
+			tt->postRecord();
+			++numData;
+		}
+	}
+	UT_ASSERT_GREATER( numSteps, 5 );
+	UT_ASSERT_LESS( tt->getDataFileSize(), oldSize );
+	assertOrder( tt.get(), numData );
+	assertOrder( reader.get(), numData );
+
+	// the root of the balanced tree contains all records
+	tt->root();
+	UT_ASSERT_EQUAL( tt->getRecord().getHeader().numRecords, numData );
+
+	// the compacted table can be modified as usual
+	fillKeyTable( tt.get(), 1001, 1010, MY_SECOND_FIELD, 'c' );
+	tt->firstRecord();
+	tt->deleteRecord();
+	assertOrder( tt.get(), numData+9 );
+
+	tt->compact();
+	assertOrder( tt.get(), numData+9 );
+}
+
+// ******************************************************************************************************************************************
+// the bulk load test
+// ******************************************************************************************************************************************
+void MydbUnitTest::bulkTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::bulkTest" );
+
+	const int numData = 1000;
+
+	createKeyTable( db, bulkTable, dbLib::fvCurrent, MY_SECOND_FIELD );
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( bulkTable ) );
+
+	// a small memory budget forces sorted runs on disk
+	tt->beginBulkLoad( true, 4096 );
+	for( int i=0; i<numData; ++i )
+	{
+		int value = (i*7919) % numData + 1;
+		fillKeyTable( tt.get(), value, value, MY_SECOND_FIELD, 'b' );
+	}
+	UT_ASSERT_EQUAL( tt->getNumRecords(), 0 );
+	tt->endBulkLoad();
+	assertOrder( tt.get(), numData );
+
+	tt->root();
+	UT_ASSERT_EQUAL( tt->getRecord().getHeader().numRecords, numData );
+
+	UT_ASSERT_EQUAL(
+		tt->countRange(
+			dbLib::FieldValue::convertFieldType<long>( 101 ),
+			dbLib::FieldValue::convertFieldType<long>( 200 )
+		),
+		100
+	);
+	UT_ASSERT_EQUAL(
+		tt->countRange(
+			dbLib::FieldValue::convertFieldType<long>( 200 ),
+			dbLib::FieldValue::convertFieldType<long>( 101 )
+		),
+		0
+	);
+
+	// the prefix of 256 to 271
+	const STRING	prefix = dbLib::FieldValue::convertFieldType<long>( 256 ).leftString( 15 );
+	int				count = 0;
+	for( tt->firstRecord( prefix ); !tt->eof(); tt->nextRecord() )
+	{
+		UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 256+count );
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, 16 );
+	for( tt->lastRecord( prefix ); !tt->bof(); tt->previousRecord() )
+	{
+		--count;
+		UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 256+count );
+	}
+	UT_ASSERT_EQUAL( count, 0 );
+	UT_ASSERT_EQUAL( tt->countRange( prefix, prefix ), 16 );
+	tt->firstRecord( dbLib::FieldValue::convertFieldType<long>( numData+1 ) );
+	UT_ASSERT_TRUE( tt->eof() );
+
+	// range loops stop at the bounds
+	const dbLib::KeyRange	range(
+		dbLib::FieldValue::convertFieldType<long>( 100 ), false,
+		dbLib::FieldValue::convertFieldType<long>( 200 ), true
+	);
+	count = 0;
+	for( tt->firstRecord( range ); !tt->eof(); tt->nextRecord() )
+	{
+		UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 101+count );
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, 100 );
+	for( tt->lastRecord( range ); !tt->bof(); tt->previousRecord() )
+	{
+		--count;
+		UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 101+count );
+	}
+	UT_ASSERT_EQUAL( count, 0 );
+
+	tt->setIndex( SEC_INDEX );
+	const dbLib::KeyRange	lowest(
+		"", true, dbLib::FieldValue::convertFieldType<long>( -numData+10 ), false
+	);
+	for( tt->firstRecord( lowest ); !tt->eof(); tt->nextRecord() )
+	{
+		UT_ASSERT_EQUAL( tt->getField( SEC_INDEX_FIELD )->getIntegerValue(), -numData+count );
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, 10 );
+	tt->lastRecord( lowest );
+	UT_ASSERT_EQUAL( tt->getField( SEC_INDEX_FIELD )->getIntegerValue(), -numData+9 );
+	tt->setIndex( "" );
+
+	// a duplicate key leaves the table unchanged
+	tt->beginBulkLoad();
+	tt->insertRecord();
+	tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( numData+1 );
+	tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -1 );
+	tt->postRecord();
+	UT_ASSERT_EXCEPTION( tt->endBulkLoad(), dbLib::DBkeyViolation );
+	assertOrder( tt.get(), numData );
+
+	// the existing records are kept
+	tt->beginBulkLoad();
+	fillKeyTable( tt.get(), numData+1, 2*numData );
+	tt->endBulkLoad();
+	assertOrder( tt.get(), 2*numData );
+
+	// the loaded table can be modified as usual
+	tt->insertRecord();
+	tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( 0 );
+	tt->getField( SEC_INDEX_FIELD )->setIntegerValue( 0 );
+	tt->postRecord();
+	tt->lastRecord();
+	tt->deleteRecord();
+	assertOrder( tt.get(), 2*numData );
+
+	// scans with a view see the same values as with the fields
+	gak::int64	sum = 0;
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+		sum += tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+
+	for( int mapped=0; mapped<2; ++mapped )
+	{
+		dbLib::RecordView	view;
+		gak::int64			viewSum = 0;
+
+		tt->setMemoryMapped( mapped != 0 );
+		tt->setIndex( SEC_INDEX );
+		tt->setRecordView( &view );
+		for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+		{
+			UT_ASSERT_EQUAL( view.getIntegerValue( 0 ), -view.getIntegerValue( 1 ) );
+			viewSum += view.getIntegerValue( 0 );
+		}
+		UT_ASSERT_EQUAL( viewSum, sum );
+
+		tt->setIndex( "" );
+		count = 0;
+		for( tt->lastRecord( range ); !tt->bof(); tt->previousRecord() )
+		{
+			UT_ASSERT_EQUAL( view.getIntegerValue( 0 ), 200-count );
+			++count;
+		}
+		UT_ASSERT_EQUAL( count, 100 );
+
+		// a view is for reading only
+		tt->lastRecord();
+		UT_ASSERT_EXCEPTION( tt->postRecord(), dbLib::DBviewReadOnly );
+		UT_ASSERT_EXCEPTION( tt->deleteRecord(), dbLib::DBviewReadOnly );
+		tt->setRecordView( NULL );
+	}
+	tt->setMemoryMapped( false );
+}
+
+// ******************************************************************************************************************************************
+// the key order test
+// ******************************************************************************************************************************************
+void MydbUnitTest::orderTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::orderTest" );
+
+	static const double numbers[] =
+	{
+		1e300, -2.5, 0.5, -1e10, 3.0, -0.0, 1e-300, -7e-3, 1024.0
+	};
+	const int numData = int(sizeof(numbers)/sizeof(numbers[0]));
+
+	{
+		std::auto_ptr<dbLib::Table> 	 t1( db->createTable( orderTable ) );
+
+		t1->addField( NUMBER_FIELD, dbLib::ftNumber, true, true );
+		t1->addField( DATE_FIELD, dbLib::ftDate );
+
+		t1->createIndex( DATE_INDEX );
+		t1->addFieldToIndex( DATE_INDEX, DATE_FIELD, true, true );
+	}
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( orderTable ) );
+
+	for( int i=0; i<numData; ++i )
+	{
+		tt->insertRecord();
+		tt->getField( NUMBER_FIELD )->setDoubleValue( numbers[i] );
+		tt->getField( DATE_FIELD )->setDateValue( time_t(numbers[i] < 0 ? -i*86400 : i*86400) );
+		tt->postRecord();
+	}
+
+	// numbers and dates sort like their values
+	int		count = 0;
+	double	prevNumber = -std::numeric_limits<double>::max();
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		double	newNumber = tt->getField( NUMBER_FIELD )->getDoubleValue();
+		UT_ASSERT_LESS( prevNumber, newNumber );
+		prevNumber = newNumber;
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, numData );
+
+	count = 0;
+	time_t	prevDate = std::numeric_limits<time_t>::min();
+	tt->setIndex( DATE_INDEX );
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		time_t	newDate = tt->getField( DATE_FIELD )->getDateValue();
+		UT_ASSERT_LESS( prevDate, newDate );
+		prevDate = newDate;
+		++count;
+	}
+	UT_ASSERT_EQUAL( count, numData );
+	tt->setIndex( "" );
+
+	// -0 and 0 are the same key
+	tt->insertRecord();
+	tt->getField( NUMBER_FIELD )->setDoubleValue( 0.0 );
+	tt->getField( DATE_FIELD )->setDateValue( 1 );
+	UT_ASSERT_EXCEPTION( tt->postRecord(), dbLib::DBkeyViolation );
+
+	tt->firstRecord( dbLib::FieldValue::convertFieldType<double>( 1024.0 ) );
+	UT_ASSERT_FALSE( tt->eof() );
+	UT_ASSERT_EQUAL( tt->getField( NUMBER_FIELD )->getDoubleValue(), 1024.0 );
+
+	// native values are encoded on demand
+	dbLib::FieldValue	value;
+	UT_ASSERT_TRUE( value.isNull() );
+	value.setIntegerValue( -5 );
+	UT_ASSERT_FALSE( value.isNull() );
+	UT_ASSERT_EQUAL( value.getIntegerValue(), -5 );
+	UT_ASSERT_EQUAL( value.getStringValue(), dbLib::FieldValue::convertFieldType<long>( -5 ) );
+	value.setDoubleValue( -1.5 );
+	UT_ASSERT_EQUAL( value.getBackupValue(), dbLib::FieldValue::convertFieldType<long>( -5 ) );
+	value.setStringValue( dbLib::FieldValue::convertFieldType<double>( 2.25 ) );
+	UT_ASSERT_EQUAL( value.getDoubleValue(), 2.25 );
+	UT_ASSERT_EQUAL( value.getBackupValue(), dbLib::FieldValue::convertFieldType<double>( -1.5 ) );
+	value.setBooleanValue( true );
+	UT_ASSERT_EQUAL( value.getStringValue(), STRING( "Y" ) );
+	value.setNull();
+	UT_ASSERT_TRUE( value.isNull() );
+
+	// the statistic counters
+	tt->firstRecord();
+	tt->resetStats();
+	UT_ASSERT_EQUAL( tt->getStats().headersRead, gak::uint64(0) );
+	tt->insertRecord();
+	tt->getField( NUMBER_FIELD )->setDoubleValue( -4.5 );
+	tt->getField( DATE_FIELD )->setDateValue( time_t(-4242) );
+	tt->postRecord();
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+		;
+
+	dbLib::FileStats	stats = tt->getStats();
+	UT_ASSERT_GREATER( stats.headersRead, gak::uint64(numData) );
+	UT_ASSERT_GREATER( stats.headersWritten, gak::uint64(0) );
+	UT_ASSERT_GREATER( stats.bytesWritten, gak::uint64(0) );
+	UT_ASSERT_GREATER( stats.payloadRead, gak::uint64(numData) );
+	UT_ASSERT_GREATER( stats.payloadWritten, gak::uint64(0) );
+	UT_ASSERT_LESSEQ( stats.payloadWritten, stats.bytesWritten );
+	UT_ASSERT_GREATER( stats.descents, gak::uint64(0) );
+	UT_ASSERT_LESSEQ( stats.getAvgDepth(), double(stats.maxDepth) );
+	UT_ASSERT_LESSEQ( stats.headersRead, db->getStats().headersRead );
+
+	// the key prefixes in the headers decide the lookup
+	tt->resetStats();
+	tt->firstRecord( dbLib::FieldValue::convertFieldType<double>( 3.0 ) );
+	UT_ASSERT_FALSE( tt->eof() );
+	UT_ASSERT_EQUAL( tt->getField( NUMBER_FIELD )->getDoubleValue(), 3.0 );
+	stats = tt->getStats();
+	UT_ASSERT_GREATER( stats.headersRead, gak::uint64(0) );
+	UT_ASSERT_EQUAL( stats.keyReads, gak::uint64(0) );
+		// the typed facade
+	tt.reset();
+	{
+		dbLib::TypedTable<OrderSchema>	typed( db->openTable( orderTable ) );
+
+		count = 0;
+		prevNumber = -std::numeric_limits<double>::max();
+		for( typed->firstRecord(); !typed->eof(); typed->nextRecord() )
+		{
+			double	newNumber = typed.get<OrderSchema::Number>();
+			UT_ASSERT_LESS( prevNumber, newNumber );
+			UT_ASSERT_FALSE( typed.isNull<OrderSchema::Date>() );
+			prevNumber = newNumber;
+			++count;
+		}
+		UT_ASSERT_EQUAL( count, numData+1 );
+
+		typed->insertRecord();
+		typed.set<OrderSchema::Number>( 4.5 );
+		typed.set<OrderSchema::Date>( time_t(42) );
+		typed->postRecord();
+		UT_ASSERT_EQUAL( typed->getNumRecords(), numData+2 );
+
+		typed->firstRecord( dbLib::FieldValue::convertFieldType<double>( 4.5 ) );
+		UT_ASSERT_FALSE( typed->eof() );
+		UT_ASSERT_EQUAL( typed.get<OrderSchema::Date>(), time_t(42) );
+	}
+	UT_ASSERT_EXCEPTION(
+		dbLib::TypedTable<WrongSchema> wrong( db->openTable( orderTable ) ),
+		dbLib::DBschemaMismatch
+	);
+}
+
+void MydbUnitTest::walTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::walTest" );
+
+	// a second connection with a log, the other tests work without
+	std::auto_ptr<dbLib::Database>	walDB( dbLib::Database::createDB( "", "c:\\temp\\gak\\", "gak", "" ) );
+	walDB->openWriteAheadLog();
+
+	dbLib::WriteAheadLog	*wal = walDB->getWriteAheadLog();
+	const STRING			logFile = wal->getFileName();
+	STRING					dataFile;
+	int						numData = 0;
+
+	createKeyTable( walDB.get(), walTable );
+	{
+		std::auto_ptr<dbLib::Table> 	 tt( walDB->openTable( walTable ) );
+
+		dataFile = tt->getPathName() + ".data";
+
+		// mapped files are written directly
+		UT_ASSERT_FALSE( tt->setMemoryMapped( true ) );
+
+		// each post is one transaction with one sync
+		fillKeyTable( tt.get(), 0, 9 );
+		numData = 10;
+		UT_ASSERT_EQUAL( wal->getNumCommits(), 10 );
+		UT_ASSERT_EQUAL( wal->getNumSyncs(), 10 );
+
+		// a batch needs one sync only
+		{
+			dbLib::Transaction	transaction( wal );
+			fillKeyTable( tt.get(), numData, 29 );
+			numData = 30;
+			transaction.commit();
+		}
+		UT_ASSERT_EQUAL( wal->getNumCommits(), 11 );
+		UT_ASSERT_EQUAL( wal->getNumSyncs(), 11 );
+		assertOrder( tt.get(), numData );
+
+		// without commit everything is undone
+		{
+			dbLib::Transaction	transaction( wal );
+			fillKeyTable( tt.get(), numData, numData+4 );
+			tt->firstRecord();
+			tt->deleteRecord();
+			UT_ASSERT_EQUAL( tt->getNumRecords(), numData+4 );
+		}
+		UT_ASSERT_EQUAL( wal->getNumCommits(), 11 );
+		UT_ASSERT_EQUAL( tt->getNumRecords(), numData );
+		assertOrder( tt.get(), numData );
+
+		tt->setIndex( SEC_INDEX );
+		tt->firstRecord();
+		UT_ASSERT_EQUAL( tt->getField( SEC_INDEX_FIELD )->getIntegerValue(), 1-numData );
+		tt->setIndex( "" );
+
+		wal->checkpoint();
+		UT_ASSERT_EQUAL( wal->getSize(), 0 );
+
+		// a connection without log can map the shared file, then the log refuses
+		{
+			std::auto_ptr<dbLib::Table> 	 plain( db->openTable( walTable ) );
+			UT_ASSERT_TRUE( plain->setMemoryMapped( true ) );
+
+			tt->insertRecord();
+			tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( numData );
+			tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -numData );
+			UT_ASSERT_EXCEPTION( tt->postRecord(), dbLib::DBmappedTransaction );
+
+			plain->setMemoryMapped( false );
+		}
+		assertOrder( tt.get(), numData );
+		UT_ASSERT_EQUAL( wal->getSize(), 0 );
+	}
+
+	// simulate a crash: the data file loses all changes since the backup
+	copyFile( dataFile, dataFile + ".backup" );
+	{
+		std::auto_ptr<dbLib::Table> 	 tt( walDB->openTable( walTable ) );
+
+		fillKeyTable( tt.get(), numData, 39 );
+		numData = 40;
+		UT_ASSERT_GREATER( wal->getSize(), 0 );
+	}
+	walDB.reset();
+	copyFile( dataFile + ".backup", dataFile );
+	strRemove( dataFile + ".backup" );
+
+	// the last entry was not written completely
+	{
+		std::ofstream	log( logFile, std::ios::binary|std::ios::app );
+		log << "DBWL torn entry";
+	}
+	UT_ASSERT_EQUAL( dbLib::WriteAheadLog::recover( logFile ), 10U );
+	UT_ASSERT_EQUAL( dbLib::WriteAheadLog::recover( logFile ), 0U );
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( walTable ) );
+	assertOrder( tt.get(), numData );
+	tt->setIndex( SEC_INDEX );
+	tt->firstRecord();
+	UT_ASSERT_EQUAL( tt->getField( SEC_INDEX_FIELD )->getIntegerValue(), 1-numData );
+}
+
+// ******************************************************************************************************************************************
+// the B+tree index test
+// ******************************************************************************************************************************************
+void MydbUnitTest::btreeTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::btreeTest" );
+
+	const int numData = 2000;
+
+	{
+		std::auto_ptr<dbLib::Table> 	 t1( db->createTable( btreeTable ) );
+
+		t1->addField( PRIM_INDEX_FIELD, dbLib::ftInteger, true, true );
+		t1->addField( SEC_INDEX_FIELD, dbLib::ftInteger );
+		t1->addField( THIRD_INDEX_FIELD, dbLib::ftInteger );
+
+		t1->createIndex( SEC_INDEX, dbLib::fvBTree );
+		t1->addFieldToIndex( SEC_INDEX, SEC_INDEX_FIELD, true, true );
+
+		// the same keys in a binary tree for comparison
+		t1->createIndex( THIRD_INDEX );
+		t1->addFieldToIndex( THIRD_INDEX, THIRD_INDEX_FIELD, true, true );
+	}
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( btreeTable ) );
+
+	// scattered inserts split leaves and inner pages
+	for( int i=0; i<numData; ++i )
+	{
+		int value = (i * 7919) % numData;
+
+		tt->insertRecord();
+		tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( value );
+		tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -value );
+		tt->getField( THIRD_INDEX_FIELD )->setIntegerValue( -value );
+		tt->postRecord();
+	}
+	assertOrder( tt.get(), numData );
+
+	tt->insertRecord();
+	tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( numData );
+	tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -5 );
+	tt->getField( THIRD_INDEX_FIELD )->setIntegerValue( -numData );
+	UT_ASSERT_EXCEPTION( tt->postRecord(), dbLib::DBkeyViolation );
+
+	// ranges in both directions
+	const STRING	lower = dbLib::FieldValue::convertFieldType<long>( -100 );
+	const STRING	upper = dbLib::FieldValue::convertFieldType<long>( -50 );
+	int				count = 0;
+
+	tt->setIndex( SEC_INDEX );
+	for( tt->firstRecord( dbLib::KeyRange( lower, true, upper, false ) ); !tt->eof(); tt->nextRecord() )
+		++count;
+	UT_ASSERT_EQUAL( count, 50 );
+	for( tt->lastRecord( dbLib::KeyRange( lower, false, upper, true ) ); !tt->bof(); tt->previousRecord() )
+		--count;
+	UT_ASSERT_EQUAL( count, 0 );
+	UT_ASSERT_EQUAL( tt->countRange( lower, upper ), 51 );
+
+	tt->firstRecord( upper );
+	UT_ASSERT_FALSE( tt->eof() );
+	UT_ASSERT_EQUAL( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue(), 50 );
+	UT_ASSERT_EQUAL( tt->getRank(), numData-51 );
+	tt->setIndex( "" );
+
+	// a lookup reads one page per level
+	dbLib::TreeReport	btreeReport, binaryReport;
+	tt->analyzeIndex( SEC_INDEX, &btreeReport );
+	tt->analyzeIndex( THIRD_INDEX, &binaryReport );
+	UT_ASSERT_EQUAL( btreeReport.formatVersion, int(dbLib::fvBTree) );
+	UT_ASSERT_EQUAL( btreeReport.treeNodes, gak::uint64(numData) );
+	UT_ASSERT_LESSEQ( btreeReport.maxDepth, gak::uint64(3) );
+	UT_ASSERT_LESS( btreeReport.maxDepth, binaryReport.maxDepth );
+
+	// delete every third record
+	int numDeleted = 0;
+	tt->firstRecord();
+	while( !tt->eof() && !tt->bof() )
+	{
+		if( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue() % 3 == 0 )
+		{
+			tt->deleteRecord();
+			++numDeleted;
+		}
+		else
+			tt->nextRecord();
+	}
+	assertOrder( tt.get(), numData-numDeleted );
+
+	// the rebuilt tree has its leaves in key order
+	tt->compact();
+	assertOrder( tt.get(), numData-numDeleted );
+	tt->analyzeIndex( SEC_INDEX, &btreeReport );
+	UT_ASSERT_EQUAL( btreeReport.treeNodes, gak::uint64(numData-numDeleted) );
+	UT_ASSERT_GREATER( btreeReport.links, gak::uint64(0) );
+	UT_ASSERT_EQUAL( btreeReport.farLinks, gak::uint64(0) );
+
+	// the format is kept in the file
+	tt.reset( db->openTable( btreeTable ) );
+	tt->analyzeIndex( SEC_INDEX, &btreeReport );
+	UT_ASSERT_EQUAL( btreeReport.formatVersion, int(dbLib::fvBTree) );
+	assertOrder( tt.get(), numData-numDeleted );
+}
+
+// ******************************************************************************************************************************************
+// the split table test
+// ******************************************************************************************************************************************
+void MydbUnitTest::heapTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::heapTest" );
+
+	const int	numData = 500;
+	STRING		payload;
+
+	for( int i=0; i<20; ++i )
+		payload += "0123456789";
+
+	createKeyTable( db, heapTable, dbLib::fvSplitHeap, MY_ONLY_FIELD );
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( heapTable ) );
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvSplitHeap) );
+	UT_ASSERT_TRUE( dbLib::fileExists( tt->getPathName() + ".heap" ) );
+
+	for( int i=0; i<numData; ++i )
+	{
+		int value = (i * 7919) % numData;
+
+		tt->insertRecord();
+		tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( value );
+		tt->getField( SEC_INDEX_FIELD )->setIntegerValue( -value );
+		tt->getField( MY_ONLY_FIELD )->setStringValue( payload );
+		tt->postRecord();
+	}
+	assertOrder( tt.get(), numData );
+
+	// the data file contains the headers only
+	dbLib::TreeReport	report;
+	tt->analyzeTree( &report );
+	UT_ASSERT_EQUAL( report.treeNodes, gak::uint64(numData) );
+	UT_ASSERT_LESS( report.fileSize, gak::int64(numData) * gak::int64(payload.strlen()) );
+
+	// updates append new buffers, the headers stay in place
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		if( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue() % 5 == 0 )
+		{
+			tt->getField( MY_ONLY_FIELD )->setStringValue( "short" );
+			tt->postRecord();
+		}
+	}
+	tt->setIndex( SEC_INDEX );
+	tt->firstRecord( dbLib::FieldValue::convertFieldType<long>( -10 ) );
+	UT_ASSERT_FALSE( tt->eof() );
+	UT_ASSERT_EQUAL( tt->getField( MY_ONLY_FIELD )->getStringValue(), STRING("short") );
+	tt->setIndex( "" );
+
+	int numDeleted = 0;
+	tt->firstRecord();
+	while( !tt->eof() && !tt->bof() )
+	{
+		if( tt->getField( PRIM_INDEX_FIELD )->getIntegerValue() % 3 == 0 )
+		{
+			tt->deleteRecord();
+			++numDeleted;
+		}
+		else
+			tt->nextRecord();
+	}
+	assertOrder( tt.get(), numData-numDeleted );
+
+	tt->compact();
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvSplitHeap) );
+	assertOrder( tt.get(), numData-numDeleted );
+
+	tt.reset( db->openTable( heapTable ) );
+	UT_ASSERT_EQUAL( tt->getFormatVersion(), int(dbLib::fvSplitHeap) );
+	assertOrder( tt.get(), numData-numDeleted );
+	tt->firstRecord( dbLib::FieldValue::convertFieldType<long>( 1 ) );
+	UT_ASSERT_FALSE( tt->eof() );
+	UT_ASSERT_EQUAL( tt->getField( MY_ONLY_FIELD )->getStringValue(), payload );
+}
+
+// ******************************************************************************************************************************************
+// the memory mapping test
+// ******************************************************************************************************************************************
+void MydbUnitTest::mappingTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::mappingTest" );
+
+	const int numData = 2000;
+
+	std::auto_ptr<dbLib::Table> 	 tt( db->openTable( formatTable ) );
+	if( !tt->setMemoryMapped( true ) )
+/***/	return;		// not supported by this port
+
+	const int firstValue = int(tt->getNumRecords())+1;
+
+	// the file must be remapped while we append
+	fillKeyTable( tt.get(), firstValue, numData );
+	UT_ASSERT_EQUAL( tt->getNumRecords(), numData );
+
+	int prevValue = 0;
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		int newValue = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_LESS( prevValue, newValue );
+		prevValue = newValue;
+	}
+	UT_ASSERT_EQUAL( prevValue, numData );
+
+	tt->setIndex( SEC_INDEX );
+	prevValue = numData+1;
+	for( tt->firstRecord(); !tt->eof(); tt->nextRecord() )
+	{
+		int newValue = tt->getField( PRIM_INDEX_FIELD )->getIntegerValue();
+		UT_ASSERT_GREATER( prevValue, newValue );
+		prevValue = newValue;
+	}
+	UT_ASSERT_EQUAL( prevValue, 1 );
+
+	tt->insertRecord();
+	tt->getField( PRIM_INDEX_FIELD )->setIntegerValue( 1 );
+	tt->getField( SEC_INDEX_FIELD )->setIntegerValue( 0 );
+	UT_ASSERT_EXCEPTION( tt->postRecord(), dbLib::DBkeyViolation );
+
+	tt->setMemoryMapped( false );
+	UT_ASSERT_EQUAL( tt->getNumRecords(), numData );
+}
+
+// ******************************************************************************************************************************************
+// the balance test
+// ******************************************************************************************************************************************
+void MydbUnitTest::assertBalance(dbLib::Table *tab)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::assertBalance" );
+
+	dbLib::TreeReport	reports[2];
+
+	tab->analyzeTree( &reports[0] );
+	tab->analyzeIndex( SEC_INDEX, &reports[1] );
+	UT_ASSERT_EQUAL( reports[0].balanceAlpha, tab->getBalanceAlpha() );
+
+	for( size_t r=0; r<2; ++r )
+	{
+		const dbLib::TreeReport	&report = reports[r];
+
+		UT_ASSERT_EQUAL( report.deletedNodes, gak::uint64(0) );
+		UT_ASSERT_LESSEQ( report.maxDepth, report.getDepthBound() );
+		for( size_t i=0; i<report.levels.size(); ++i )
+			UT_ASSERT_EQUAL( report.levels[i].overThreshold, gak::uint64(0) );
+	}
+}
+
+void MydbUnitTest::balanceTest(dbLib::Database *db)
+{
+	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::balanceTest" );
+
+	const double	alphas[] =
+	{
+		dbLib::MIN_BALANCE_ALPHA, dbLib::DEFAULT_BALANCE_ALPHA, dbLib::MAX_BALANCE_ALPHA
+	};
+	const int		numAlphas = int(sizeof(alphas)/sizeof(alphas[0]));
+	const int		numData = 400;
+
+	createKeyTable( db, balanceTable );
+	{
+		std::auto_ptr<dbLib::Table> 	 t1( db->openTable( balanceTable ) );
+
+		UT_ASSERT_EXCEPTION( t1->setBalanceAlpha( 0.1 ), dbLib::DBillegalBalance );
+		UT_ASSERT_EXCEPTION( t1->setBalanceAlpha( 0.3, SEC_INDEX ), dbLib::DBillegalBalance );
+		UT_ASSERT_EQUAL( t1->getBalanceAlpha(), dbLib::DEFAULT_BALANCE_ALPHA );
+	}
+
+	for( int a=0; a<numAlphas; ++a )
+	{
+		{
+			std::auto_ptr<dbLib::Table> 	 t1( db->openTable( balanceTable ) );
+
+			t1->setBalanceAlpha( alphas[a] );
+			t1->setBalanceAlpha( alphas[numAlphas-1-a], SEC_INDEX );
+		}
+
+		std::auto_ptr<dbLib::Table> 	 tt( db->openTable( balanceTable ) );
+		UT_ASSERT_EQUAL( tt->getBalanceAlpha(), alphas[a] );
+
+		// ascending keys degenerate a tree without rotations at the root
+		std::vector<bool>	used( 4*numData+1, false );
+		int					numRecords = numData;
+
+		fillKeyTable( tt.get(), 1, numData );
+		for( int i=1; i<=numData; ++i )
+			used[i] = true;
+		assertBalance( tt.get() );
+		assertOrder( tt.get(), numRecords );
+
+		// random inserts and deletes anywhere in the tree
+		std::mt19937	random( a+1 );
+		for( int step=1; step<=4*numData; ++step )
+		{
+			if( random() % 2 )
+			{
+				int	key = int(random() % (4*numData)) + 1;
+				if( !used[key] )
+				{
+					fillKeyTable( tt.get(), key, key );
+					used[key] = true;
+					++numRecords;
+				}
+			}
+			else if( numRecords )
+			{
+				UT_ASSERT_TRUE( tt->seekToRank( gak::int64(random() % numRecords) ) );
+				used[tt->getField( PRIM_INDEX_FIELD )->getIntegerValue()] = false;
+				tt->deleteRecord();
+				--numRecords;
+			}
+			if( !(step % numData) )
+			{
+				assertBalance( tt.get() );
+				assertOrder( tt.get(), numRecords );
+			}
+		}
+
+		// deleting from one end is the worst case for the deletes
+		tt->firstRecord();
+		while( numRecords )
+		{
+			tt->deleteRecord();
+			if( !(--numRecords % (numData/4)) )
+				assertBalance( tt.get() );
+		}
+		assertOrder( tt.get(), 0 );
+	}
+}
+
 // ******************************************************************************************************************************************
 
 void MydbUnitTest::PerformTest()
@@ -546,8 +1941,22 @@ void MydbUnitTest::PerformTest()
 	doEnterFunctionEx( gakLogging::llInfo, "MydbUnitTest::PerformTest" );
 	std::auto_ptr<dbLib::Database>	db( dbLib::Database::createDB( "", "c:\\temp\\gak\\", "gak", "" ) );
 
+	// force the buffer pool to replace pages
+	dbLib::BufferPool::getPool().setMemoryBudget( 0 );
 	simpleTest(db.get());
+	dbLib::BufferPool::getPool().setMemoryBudget( dbLib::BufferPool::DEFAULT_BUDGET );
 	indexTest(db.get());
+	formatTest(db.get());
+	legacyTest(db.get());
+	mappingTest(db.get());
+	reuseTest(db.get());
+	compactTest(db.get());
+	bulkTest(db.get());
+	orderTest(db.get());
+	walTest(db.get());
+	btreeTest(db.get());
+	heapTest(db.get());
+	balanceTest(db.get());
 
 	createTable(db.get());
 
@@ -561,16 +1970,24 @@ void MydbUnitTest::PerformTest()
 		processTablesReadRecords(t1.get());
 		assertRecords(t1.get(),4);
 		processTablesUpdateRecords(t2.get());
-		assertRecords(t1.get(),8);
+		assertRecords(t1.get(),4);
 		processTablesNullNkeyViolation(t3.get());
-		assertRecords(t1.get(),8);
+		assertRecords(t1.get(),4);
 		processTablesEmptyTable(t1.get());
-		assertRecords(t1.get(),8);
+		assertRecords(t1.get(),0);
 	}
 
 	db->dropTable(test1);
 	db->dropTable(simple);
 	db->dropTable(indexTable);
+	db->dropTable(formatTable);
+	db->dropTable(reuseTable);
+	db->dropTable(bulkTable);
+	db->dropTable(orderTable);
+	db->dropTable(walTable);
+	db->dropTable(btreeTable);
+	db->dropTable(heapTable);
+	db->dropTable(balanceTable);
 
 	UT_ASSERT_EXCEPTION(db->openTable( test1 ), dbLib::DBtableNotFound);
 }
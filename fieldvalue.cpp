@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			fieldValue.cpp
 		Description:	The definitions for a table field value
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -37,6 +37,8 @@
 // ----- includes ------------------------------------------------------ //
 // --------------------------------------------------------------------- //
 
+#include <cstdlib>
+
 #include "fieldvalue.h"
 
 // --------------------------------------------------------------------- //
@@ -109,6 +111,79 @@ namespace dbLib
 // ----- class static functions ---------------------------------------- //
 // --------------------------------------------------------------------- //
 
+gak::uint64 FieldValue::parseHex( const char *data, std::size_t len )
+{
+	gak::uint64	value = 0;
+
+	for( std::size_t i=0; i<len; ++i )
+	{
+		const char	c = data[i];
+		int			digit;
+
+		if( c >= '0' && c <= '9' )
+			digit = c - '0';
+		else if( c >= 'A' && c <= 'F' )
+			digit = c - 'A' + 10;
+		else if( c >= 'a' && c <= 'f' )
+			digit = c - 'a' + 10;
+		else
+/*v*/		break;
+
+		value = (value << 4) | gak::uint64(digit);
+	}
+
+	return value;
+}
+
+/*
+	reverses the IEEE-754 total order transform of convertFieldType<double>
+*/
+double FieldValue::parseOrderedNumber( const char *data, std::size_t len )
+{
+	gak::uint64	bits = parseHex( data, len );
+	bits = (bits & ORDERED_SIGN_BIT) ? bits & ~ORDERED_SIGN_BIT : ~bits;
+
+	double	value;
+	memcpy( &value, &bits, sizeof(value) );
+	return value;
+}
+
+/*
+	files older than fvOrderedNumber store numbers as decimal text
+*/
+double FieldValue::parseDecimalNumber( const char *data, std::size_t len )
+{
+	char	tmpBuffer[64];
+
+	if( len >= sizeof(tmpBuffer) )
+		len = sizeof(tmpBuffer)-1;
+	memcpy( tmpBuffer, data, len );
+	tmpBuffer[len] = 0;
+	return strtod( tmpBuffer, NULL );
+}
+
+/*
+	creates the encoded form of a value from its native form
+*/
+void FieldValue::encodeValue( TypedValue *value )
+{
+	switch( value->kind )
+	{
+		case nkInteger:
+			value->encoded = convertOrderedInteger( value->integer );
+/*v*/		break;
+		case nkNumber:
+			value->encoded = convertFieldType<double>( value->number );
+/*v*/		break;
+		case nkBoolean:
+			value->encoded = convertFieldType<bool>( value->integer != 0 );
+/*v*/		break;
+		case nkNone:
+/*v*/		break;
+	}
+	value->encodedValid = true;
+}
+
 // --------------------------------------------------------------------- //
 // ----- class privates ------------------------------------------------ //
 // --------------------------------------------------------------------- //
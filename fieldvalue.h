@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			fieldValue.h
 		Description:	The definitions for a table field value
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -41,6 +41,8 @@
 // --------------------------------------------------------------------- //
 
 #include <limits>
+#include <cstring>
+#include <ctime>
 
 #include <gak/string.h>
 #include <gak/fmtNumber.h>
@@ -73,6 +75,13 @@ namespace dbLib
 // ----- constants ----------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+/*
+	integers, numbers and dates are stored with a fixed number of hex
+	digits, so that the field values sort like their numeric values
+*/
+static const std::size_t	ORDERED_KEY_LEN = 16;
+static const gak::uint64	ORDERED_SIGN_BIT = gak::uint64(1) << 63;
+
 // --------------------------------------------------------------------- //
 // ----- macros -------------------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -97,6 +106,36 @@ struct FieldDefinition
 
 typedef gak::Array<FieldDefinition> FieldDefinitions;
 
+/*
+	the native form of a value, that is currently cached
+*/
+enum NativeKind
+{
+	nkNone, nkInteger, nkNumber, nkBoolean
+};
+
+/*
+	a field value in its encoded form, as it is stored in the record
+	buffer, and in its native form. At least one of both is valid, the
+	other is created on demand.
+*/
+struct TypedValue
+{
+	gak::STRING		encoded;
+	bool			encodedValid;
+	NativeKind		kind;
+	gak::int64		integer;			// integers, dates and booleans
+	double			number;
+
+	TypedValue()
+	{
+		encodedValid = true;
+		kind = nkNone;
+		integer = 0;
+		number = 0;
+	}
+};
+
 // --------------------------------------------------------------------- //
 // ----- class definitions --------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -104,8 +143,22 @@ typedef gak::Array<FieldDefinition> FieldDefinitions;
 class FieldValue
 {
 	const FieldDefinition	*m_definition;
-	gak::STRING				m_fieldValue;
-	gak::STRING				m_fieldBackup;
+	mutable TypedValue		m_fieldValue;
+	mutable TypedValue		m_fieldBackup;
+
+	static void encodeValue( TypedValue *value );
+	static const gak::STRING &getEncoded( TypedValue *value )
+	{
+		if( !value->encodedValid )
+			encodeValue( value );
+		return value->encoded;
+	}
+	void setNative( NativeKind kind )
+	{
+		m_fieldValue.kind = kind;
+		m_fieldValue.encodedValid = false;
+	}
+	gak::int64 getInteger() const;
 
 	public:
 	FieldValue()
@@ -124,7 +177,7 @@ class FieldValue
 	}
 	gak::STRING getBackupValue() const
 	{
-		return m_fieldBackup;
+		return getEncoded( &m_fieldBackup );
 	}
 	fType getType() const
 	{
@@ -145,110 +198,85 @@ class FieldValue
 
 	bool isNull() const
 	{
-		return !m_fieldValue[0U];
+		return m_fieldValue.encodedValid && !m_fieldValue.encoded[0U];
 	}
 	void setNull()
 	{
 		backupValue();
-		m_fieldValue = (const char*)NULL;
+		m_fieldValue.encoded = (const char*)NULL;
+		m_fieldValue.encodedValid = true;
+		m_fieldValue.kind = nkNone;
 	}
 
 
 	template <typename INPUT_t>
-	static gak::STRING convertFieldType( const INPUT_t &val )
+	static gak::STRING convertFieldType( const INPUT_t &val );
+	template <typename FIELD_t>
+	static FIELD_t parseFieldType( const gak::STRING &val );
+
+	static gak::STRING convertOrderedBits( gak::uint64 bits )
 	{
-		return val;
+		return gak::formatBinary( bits, 16, int(ORDERED_KEY_LEN) );
 	}
-	template <typename FIELD_t>
-	static FIELD_t parseFieldType( const gak::STRING &val )
+	static gak::STRING convertOrderedInteger( gak::int64 val )
+	{
+		return convertOrderedBits( gak::uint64(val) ^ ORDERED_SIGN_BIT );
+	}
+	static gak::int64 parseOrderedInteger( const gak::STRING &val )
 	{
-		return val;
+		return parseOrderedInteger( val, strlen( val ) );
 	}
 
+	/*
+		the parsers for views into record buffers, they do not need a
+		terminating 0
+	*/
+	static gak::uint64 parseHex( const char *data, std::size_t len );
+	static gak::int64 parseOrderedInteger( const char *data, std::size_t len )
+	{
+		return gak::int64(parseHex( data, len ) ^ ORDERED_SIGN_BIT);
+	}
+	static double parseOrderedNumber( const char *data, std::size_t len );
+	static double parseDecimalNumber( const char *data, std::size_t len );
+
 	// *******************************************************************************************************
 	// String fields
 	// *******************************************************************************************************
 	const gak::STRING &getStringValue() const
 	{
-		return m_fieldValue;
+		return getEncoded( &m_fieldValue );
 	}
 	void setStringValue( const gak::STRING &value )
 	{
 		backupValue();
-		m_fieldValue = value;
+		m_fieldValue.encoded = value;
+		m_fieldValue.encodedValid = true;
+		m_fieldValue.kind = nkNone;
 	}
 
 	// *******************************************************************************************************
 	// Integer fields
 	// *******************************************************************************************************
-	template <>
-	static gak::STRING convertFieldType<long>( const long &val )
-	{
-		return gak::formatBinary(
-			gak::uint64(gak::int64(val) + std::numeric_limits<gak::int64>::max() + 1), 
-			16, 16 
-		);	
-	}
-	void setIntegerValue( long value )
-	{
-		backupValue();
-		m_fieldValue = convertFieldType(value);
-	}
-	template <>
-	static long parseFieldType<long>( const gak::STRING &val )
-	{
-		return long(val.getValueN<gak::uint64>(16) - std::numeric_limits<gak::int64>::max() - 1);
-	}
-	long getIntegerValue() const
-	{
-		return parseFieldType<long>( m_fieldValue );
-	}
+	void setIntegerValue( long value );
+	long getIntegerValue() const;
 
 	// *******************************************************************************************************
 	// Double fields
 	// *******************************************************************************************************
-	template <>
-	static gak::STRING convertFieldType<double>( const double &val )
-	{
-		return gak::formatNumber( val );
-	}
-	void setDoubleValue( double value )
-	{
-		backupValue();
-		m_fieldValue = convertFieldType(value);
-	}
-	template <>
-	static double parseFieldType<double>( const gak::STRING &val )
-	{
-		return val.getValueN<double>();
-	}
-	double getDoubleValue() const
-	{
-		return parseFieldType<double>( m_fieldValue );
-	}
+	void setDoubleValue( double value );
+	double getDoubleValue() const;
 
 	// *******************************************************************************************************
 	// Boolean fields
 	// *******************************************************************************************************
-	template <>
-	static gak::STRING convertFieldType<bool>( const bool &val )
-	{
-		return gak::STRING(val ? 'Y' : 'N');
-	}
-	void setBooleanValue( bool value )
-	{
-		backupValue();
-		m_fieldValue = convertFieldType(value);
-	}
-	template <>
-	static bool parseFieldType<bool>( const gak::STRING &val )
-	{
-		return val[0U] == 'Y';
-	}
-	bool getBooleanValue() const
-	{
-		return parseFieldType<bool>( m_fieldValue );
-	}
+	void setBooleanValue( bool value );
+	bool getBooleanValue() const;
+
+	// *******************************************************************************************************
+	// Date fields
+	// *******************************************************************************************************
+	void setDateValue( time_t value );
+	time_t getDateValue() const;
 };
 
 // --------------------------------------------------------------------- //
@@ -275,6 +303,131 @@ class FieldValue
 // ----- class inlines ------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+template <typename INPUT_t>
+inline gak::STRING FieldValue::convertFieldType( const INPUT_t &val )
+{
+	return val;
+}
+
+template <typename FIELD_t>
+inline FIELD_t FieldValue::parseFieldType( const gak::STRING &val )
+{
+	return val;
+}
+
+// *******************************************************************************************************
+// Integer fields
+// *******************************************************************************************************
+template <>
+inline gak::STRING FieldValue::convertFieldType<long>( const long &val )
+{
+	return convertOrderedInteger( val );
+}
+template <>
+inline long FieldValue::parseFieldType<long>( const gak::STRING &val )
+{
+	return long(parseOrderedInteger( val ));
+}
+inline void FieldValue::setIntegerValue( long value )
+{
+	backupValue();
+	m_fieldValue.integer = value;
+	setNative( nkInteger );
+}
+inline gak::int64 FieldValue::getInteger() const
+{
+	if( m_fieldValue.kind != nkInteger )
+	{
+		m_fieldValue.integer = parseOrderedInteger( getEncoded( &m_fieldValue ) );
+		m_fieldValue.kind = nkInteger;
+	}
+	return m_fieldValue.integer;
+}
+inline long FieldValue::getIntegerValue() const
+{
+	return long(getInteger());
+}
+
+// *******************************************************************************************************
+// Double fields
+// *******************************************************************************************************
+/*
+	the IEEE-754 bits of positive numbers get the sign bit, negative
+	numbers are inverted. -0 is stored as 0, so that both are equal keys.
+*/
+template <>
+inline gak::STRING FieldValue::convertFieldType<double>( const double &val )
+{
+	const double	value = val == 0 ? 0.0 : val;
+	gak::uint64		bits;
+
+	memcpy( &bits, &value, sizeof(bits) );
+	return convertOrderedBits( (bits & ORDERED_SIGN_BIT) ? ~bits : bits | ORDERED_SIGN_BIT );
+}
+template <>
+inline double FieldValue::parseFieldType<double>( const gak::STRING &val )
+{
+	return parseOrderedNumber( val, strlen( val ) );
+}
+inline void FieldValue::setDoubleValue( double value )
+{
+	backupValue();
+	m_fieldValue.number = value;
+	setNative( nkNumber );
+}
+inline double FieldValue::getDoubleValue() const
+{
+	if( m_fieldValue.kind != nkNumber )
+	{
+		m_fieldValue.number = parseFieldType<double>( getEncoded( &m_fieldValue ) );
+		m_fieldValue.kind = nkNumber;
+	}
+	return m_fieldValue.number;
+}
+
+// *******************************************************************************************************
+// Boolean fields
+// *******************************************************************************************************
+template <>
+inline gak::STRING FieldValue::convertFieldType<bool>( const bool &val )
+{
+	return gak::STRING(val ? 'Y' : 'N');
+}
+template <>
+inline bool FieldValue::parseFieldType<bool>( const gak::STRING &val )
+{
+	return val[0U] == 'Y';
+}
+inline void FieldValue::setBooleanValue( bool value )
+{
+	backupValue();
+	m_fieldValue.integer = value;
+	setNative( nkBoolean );
+}
+inline bool FieldValue::getBooleanValue() const
+{
+	if( m_fieldValue.kind != nkBoolean )
+	{
+		m_fieldValue.integer = parseFieldType<bool>( getEncoded( &m_fieldValue ) );
+		m_fieldValue.kind = nkBoolean;
+	}
+	return m_fieldValue.integer != 0;
+}
+
+// *******************************************************************************************************
+// Date fields
+// *******************************************************************************************************
+inline void FieldValue::setDateValue( time_t value )
+{
+	backupValue();
+	m_fieldValue.integer = value;
+	setNative( nkInteger );
+}
+inline time_t FieldValue::getDateValue() const
+{
+	return time_t(getInteger());
+}
+
 // --------------------------------------------------------------------- //
 // ----- class constructors/destructors -------------------------------- //
 // --------------------------------------------------------------------- //
@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			index.cpp
 		Description:	The definitions for one table index
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -37,6 +37,8 @@
 // ----- includes ------------------------------------------------------ //
 // --------------------------------------------------------------------- //
 
+#include <gak/stdlib.h>
+
 #include "table.h"
 
 // --------------------------------------------------------------------- //
@@ -137,6 +139,41 @@ size_t Index::findField( const char *fieldName )
 	return fieldIdx;
 }
 
+void Index::readFormatVersion()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::readFormatVersion" );
+
+	char	tableHeader[TABLE_HEADER_SIZE+1];
+
+	if( m_dataFileHandle->getSize() >= gak::int64(TABLE_HEADER_SIZE) )
+	{
+		if( m_dataFileHandle->read( 0, tableHeader, TABLE_HEADER_SIZE ) != long(TABLE_HEADER_SIZE) )
+			throw DBillegalRecordHeader( m_dataFile );
+
+		tableHeader[TABLE_HEADER_SIZE] = 0;
+		m_dataFileHandle->setFormatVersion( STRING(tableHeader).getValueN<int>() );
+	}
+	else
+		m_dataFileHandle->setFormatVersion( fvCurrent );
+}
+
+void Index::openHeapFile()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::openHeapFile" );
+
+	m_heapFileHandle = openTableFile( m_heapFile );
+	m_dataFileHandle->setHeapFile( m_heapFileHandle );
+}
+
+void Index::closeHeapFile()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::closeHeapFile" );
+
+	m_dataFileHandle->setHeapFile( NULL );
+	closeTableFile( m_heapFileHandle );
+	m_heapFileHandle = nullptr;
+}
+
 // --------------------------------------------------------------------- //
 // ----- class protected ----------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -157,6 +194,11 @@ void Index::open( Element *theXmlFieldDefs )
 	STRING				value;
 	size_t				defIdx = 0;
 
+	// the alpha is stored in thousandths, older definitions have none
+	value = theXmlFieldDefs->getAttribute( "BALANCE" );
+	if( !value.isEmpty() )
+		setBalanceAlpha( value.getValueN<int>() / 1000.0 );
+
 	m_fieldDefinitions.setMinSize(theXmlFieldDefs->getNumObjects());
 
 	for( size_t i=0; i<theXmlFieldDefs->getNumObjects(); i++ )
@@ -191,6 +233,8 @@ void Index::writeXmlDefinition( Element *theXmlFieldDefs ) const
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Index::writeXmlDefinition" );
 
+	theXmlFieldDefs->setIntegerAttribute( "BALANCE", int(getBalanceAlpha()*1000.0 + 0.5) );
+
 	for( size_t i=0; i<m_fieldDefinitions.size(); ++i )
 	{
 		const FieldDefinition &fieldDef = m_fieldDefinitions[i];
@@ -205,20 +249,190 @@ void Index::writeXmlDefinition( Element *theXmlFieldDefs ) const
 	}
 }
 
+void Index::setBalanceAlpha( double alpha )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::setBalanceAlpha" );
+
+	if( alpha < MIN_BALANCE_ALPHA || alpha > MAX_BALANCE_ALPHA )
+		throw DBillegalBalance( m_dataFile );
+
+	m_balanceAlpha = alpha;
+}
+
 void Index::truncateFile()
 {
-	closeTableFile( m_dataFileHandle );
-	strRemove( m_dataFile );
-	m_dataFileHandle = openTableFile( m_dataFile );
-	create();
+	bool	mapped = isMemoryMapped();
+
+	create( isCurrentFormat() ? getFormatVersion() : fvCurrent );
+	if( mapped )
+		m_dataFileHandle->mapFile();
 }
 
-void Index::create()
+void Index::create( int formatVersion )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Index::create" );
 
-	m_dataFileHandle->toStart();
-	m_dataFileHandle->write( TABLE_HEADER, TABLE_HEADER_SIZE );
+	cancelCompaction();
+	cancelBulkLoad();
+
+	// the size of the table header depends on the version
+	if( m_dataFileHandle->getSize() )
+	{
+		closeTableFile( m_dataFileHandle );
+		strRemove( m_dataFile );
+		m_dataFileHandle = openTableFile( m_dataFile );
+	}
+	if( m_heapFileHandle )
+	{
+		closeHeapFile();
+		strRemove( m_heapFile );
+	}
+	if( formatVersion == fvBTree )
+		BTree::create( m_dataFileHandle );
+	else
+		writeTableHeader( m_dataFileHandle, formatVersion );
+	if( formatVersion == fvSplitHeap )
+		openHeapFile();
+}
+
+/*
+	rewrites a data file of an older format version with the current
+	format. All record positions may change. Decimal numbers of files
+	older than fvOrderedNumber are replaced by ordered numbers.
+*/
+void Index::convertFormat()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::convertFormat" );
+
+	if( isCurrentFormat() )
+/***/	return;
+
+	// the ordered numbers sort differently, the bulk load sorts them again
+	if( !Record::hasOrderedNumbers( m_dataFileHandle ) && m_currentRecord.hasNumberFields() )
+	{
+		beginBulkLoad();
+		endBulkLoad();
+/***/	return;
+	}
+
+	STRING	convertFile = m_dataFile + ".convert";
+	strRemove( convertFile );
+	{
+		DbFile	target;
+
+		target.open( convertFile );
+		writeTableHeader( &target, fvCurrent );
+
+		Record::convertFile( m_dataFileHandle, &target, m_balanceAlpha );
+	}
+	m_dataFileHandle->replaceWith( convertFile );
+	m_dataFileHandle->setFormatVersion( fvCurrent );
+}
+
+bool Index::compactStep( size_t maxRecords, const Compactor *recPosMap )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::compactStep" );
+
+	// a B+tree is rewritten in one step with its leaves in key order
+	if( isBTree() )
+	{
+		assert( !recPosMap );
+		beginBulkLoad();
+		endBulkLoad();
+/***/	return true;
+	}
+
+	// somebody has changed the file, start again
+	if( !isCompactionValid() )
+		cancelCompaction();
+
+	if( !m_compactor )
+		m_compactor = new Compactor( m_dataFileHandle, m_dataFile + ".compact", recPosMap );
+
+	return m_compactor->step( maxRecords );
+}
+
+void Index::finishCompaction()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::finishCompaction" );
+
+	if( m_compactor )
+	{
+		// the pages of the old file are discarded
+		m_currentRecord.releaseView();
+		m_compactor->finish();
+		cancelCompaction();
+	}
+}
+
+void Index::compact()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::compact" );
+
+	while( !compactStep( Compactor::DEFAULT_STEP_SIZE ) )
+		;
+	finishCompaction();
+}
+
+void Index::beginBulkLoad( bool keepRecords, size_t memoryBudget )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::beginBulkLoad" );
+
+	// the file will be replaced anyway
+	cancelCompaction();
+	cancelBulkLoad();
+
+	m_bulkLoader = new BulkLoader( m_dataFileHandle, m_dataFile + ".bulk", memoryBudget );
+	if( keepRecords )
+	{
+		for( firstRecord(); !eof(); nextRecord() )
+			m_bulkLoader->addRecord( &m_currentRecord );
+	}
+	m_currentRecord.setInsertMode();
+}
+
+/*
+	writes the new file, the old one is still in use
+*/
+void Index::writeBulkLoad()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::writeBulkLoad" );
+
+	if( m_bulkLoader )
+	{
+		m_bulkLoader->prepare( getPathName() );
+		while( m_bulkLoader->writeNext() )
+			;
+	}
+}
+
+void Index::finishBulkLoad()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::finishBulkLoad" );
+
+	if( m_bulkLoader )
+	{
+		m_currentRecord.releaseView();
+		m_bulkLoader->finish();
+		cancelBulkLoad();
+		m_currentRecord.setInsertMode();
+	}
+}
+
+void Index::endBulkLoad()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::endBulkLoad" );
+
+	try
+	{
+		writeBulkLoad();
+	}
+	catch( ... )
+	{
+		cancelBulkLoad();
+		throw;
+	}
+	finishBulkLoad();
 }
 
 void Index::addField(
@@ -279,14 +493,128 @@ gak::int64 Index::getNumRecords()
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Index::getNumRecords" );
 
+	if( isBTree() )
+/***/	return BTree::getNumEntries( m_dataFileHandle );
+
+	if( !Record::getRootPosition( m_dataFileHandle ) )
+/***/	return 0;
+
 	root();
-	return m_currentRecord.getHeader().numRecords;
+
+	return Record::getLiveCount( m_dataFileHandle, m_currentRecord.getHeader().address );
+}
+
+/*
+	makes the record with the given rank the current record
+*/
+bool Index::seekToRank( gak::int64 rank )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::seekToRank" );
+
+	if( isBTree() )
+/***/	return m_btree.seekToRank( m_dataFileHandle, &m_currentRecord, rank );
+
+	const gak::int64	rootPos = Record::getRootPosition( m_dataFileHandle );
+	gak::int64			position = 0;
+
+	if( rootPos )
+		position = Record::locateRank( m_dataFileHandle, rootPos, rank );
+
+	if( !position )
+	{
+		m_currentRecord.m_theRecMode = rank < 0 ? rmBof : rmEof;
+/***/	return false;
+	}
+
+	m_currentRecord.readRecord( m_dataFileHandle, position );
+	return true;
+}
+
+/*
+	returns the rank of the current record or -1 if there is none
+*/
+gak::int64 Index::getRank() const
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::getRank" );
+
+	const RecordMode	mode = m_currentRecord.m_theRecMode;
+	if( mode != rmBrowse && mode != rmUpdate )
+/***/	return -1;
+
+	if( isBTree() )
+/***/	return m_btree.getRank( m_dataFileHandle );
+
+	return Record::getRank( m_dataFileHandle, m_currentRecord.getHeader().address );
+}
+
+/*
+	counts the records from lo up to hi. Both are prefixes like the
+	searchBuffer of firstRecord, records starting with hi are included.
+*/
+gak::int64 Index::countRange( const STRING &lo, const STRING &hi ) const
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::countRange" );
+
+	const gak::int64	rootPos = isBTree() ? 0 : Record::getRootPosition( m_dataFileHandle );
+
+	if( !isBTree() && !rootPos )
+/***/	return 0;
+
+	if( !isBTree() )
+		checkSearchFormat( lo, hi );
+
+	gak::int64	count = isBTree()
+		? BTree::countLess( m_dataFileHandle, hi, true )
+			- BTree::countLess( m_dataFileHandle, lo, false )
+		: Record::countLess( m_dataFileHandle, rootPos, hi, true )
+			- Record::countLess( m_dataFileHandle, rootPos, lo, false );
+
+	return count > 0 ? count : 0;
+}
+
+/*
+	searches the entry starting with prefix and makes it the current record
+*/
+bool Index::locateEntry( const STRING &prefix )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Index::locateEntry" );
+
+	if( isBTree() )
+/***/	return m_btree.locateEntry( m_dataFileHandle, &m_currentRecord, prefix );
+
+	checkSearchFormat( prefix );
+	const gak::int64	rootPos = Record::getRootPosition( m_dataFileHandle );
+
+	if( !rootPos )
+/***/	return false;
+
+	gak::int64	position = Record::locatePrefix( m_dataFileHandle, rootPos, prefix );
+	if( position )
+	{
+		m_currentRecord.readRecord( m_dataFileHandle, position );
+/***/	return true;
+	}
+
+	return false;
 }
 
 // --------------------------------------------------------------------- //
 // ----- entry points -------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+void writeTableHeader( DbFile *dataFileHandle, int formatVersion )
+{
+	STRING	tableHeader = gak::formatBinary( formatVersion, 10, int(TABLE_HEADER_SIZE), '0' );
+	std::size_t	headerSize = std::size_t(getTableHeaderSize( formatVersion ));
+
+	gak::Buffer<char>	buffer( headerSize );
+	memset( buffer, 0, headerSize );
+	memcpy( buffer, (const char *)tableHeader, TABLE_HEADER_SIZE );
+
+	dataFileHandle->write( 0, buffer, headerSize );
+	dataFileHandle->setFormatVersion( formatVersion );
+}
+
 } // namespace dbLib
 
 #ifdef __BORLANDC__
@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			index.h
 		Description:	The definitions for one table index
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -46,6 +46,10 @@
 
 #include "db_file_io.h"
 #include "record.h"
+#include "db_compactor.h"
+#include "db_bulk_loader.h"
+#include "db_tree_analyzer.h"
+#include "db_btree.h"
 
 // --------------------------------------------------------------------- //
 // ----- imported datas ------------------------------------------------ //
@@ -73,9 +77,59 @@ namespace dbLib
 // ----- constants ----------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
-static const char	TABLE_HEADER[] = "0000000000000000";
+/*
+	the table header contains the format version of the file
+*/
+enum FormatVersion
+{
+	fvAsciiHeader,				// record headers are written as decimal text
+	fvBinaryHeader,				// record headers are little endian binary
+	fvFreeSpace,				// deleted records are reused via free lists
+	fvThreaded,					// records are linked in key order
+	fvKeyPrefix,				// record headers contain the start of the key
+	fvRootLink,					// the table header points to the root record
+	fvOrderedNumber,			// numbers are stored in their sort order
+	fvCurrent = fvOrderedNumber,
+
+	/*
+		the versions below have fixed numbers, that later versions must
+		not take. fvSplitHeap has all features of fvOrderedNumber.
+	*/
+	fvSplitHeap = 50,			// the record buffers are stored in a heap file
+	fvBTree = 100				// index files only: a page structured B+tree
+};
+
+static const char	TABLE_HEADER[] = "0000000000000006";
 static const size_t	TABLE_HEADER_SIZE = sizeof(TABLE_HEADER)-1;
 
+/*
+	since fvFreeSpace the version is followed by the heads of the free
+	lists, one for each size class
+*/
+static const size_t	FREE_SIZE_CLASSES = 16;
+
+/*
+	since fvRootLink the free lists are followed by the position of the
+	root record, 0 for an empty tree. Older files have the root at the
+	start of the data.
+*/
+static const size_t	ROOT_LINK_POS = TABLE_HEADER_SIZE + FREE_SIZE_CLASSES*sizeof(gak::int64);
+
+/*
+	returns the size of the table header, the first record follows
+*/
+inline gak::int64 getTableHeaderSize( int formatVersion )
+{
+	if( formatVersion == fvBTree )
+/***/	return gak::int64(BTree::PAGE_SIZE);
+
+	return formatVersion >= fvRootLink
+		? gak::int64(ROOT_LINK_POS + sizeof(gak::int64))
+		: formatVersion >= fvFreeSpace
+			? gak::int64(ROOT_LINK_POS)
+			: gak::int64(TABLE_HEADER_SIZE);
+}
+
 // --------------------------------------------------------------------- //
 // ----- macros -------------------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -93,12 +147,17 @@ class Index
 	bool			m_dropAfterClose;
 	gak::STRING		m_pathName;
 	gak::STRING		m_dataFile;
-
+	gak::STRING		m_heapFile;
+	double			m_balanceAlpha;		// set from the definition
 
 	protected:
 	DbFile						*m_dataFileHandle;
+	DbFile						*m_heapFileHandle;
 	Record						m_currentRecord;
 	FieldDefinitions			m_fieldDefinitions;
+	Compactor					*m_compactor;
+	BulkLoader					*m_bulkLoader;
+	BTree						m_btree;
 
 	const FieldDefinition &getFieldDef( size_t fieldDefIdx ) const
 	{
@@ -106,6 +165,11 @@ class Index
 		return m_fieldDefinitions[fieldDefIdx];
 	}
 	size_t	findField( const char *fieldName );
+	void	readFormatVersion();
+	void	openHeapFile();
+	void	closeHeapFile();
+
+	friend class ::MydbUnitTest;
 
 	public:
 	Index( const gak::STRING &pathName )
@@ -113,18 +177,34 @@ class Index
 		m_pathName = pathName;
 
 		m_dataFileHandle = nullptr;
+		m_heapFileHandle = nullptr;
+		m_compactor = nullptr;
+		m_bulkLoader = nullptr;
 		m_dropAfterClose = false;
+		m_balanceAlpha = DEFAULT_BALANCE_ALPHA;
 
 		m_dataFile = pathName;
 		m_dataFile += ".data";
+		m_heapFile = pathName;
+		m_heapFile += ".heap";
 		m_dataFileHandle = openTableFile( m_dataFile );
+		readFormatVersion();
+		if( getFormatVersion() == fvSplitHeap )
+			openHeapFile();
 	}
 	~Index()
 	{
+		cancelCompaction();
+		cancelBulkLoad();
+		if( m_heapFileHandle )
+			closeTableFile( m_heapFileHandle );
 		if( m_dataFileHandle )
 			closeTableFile( m_dataFileHandle );
 		if( m_dropAfterClose )
+		{
 			strRemove( m_dataFile );
+			strRemove( m_heapFile );
+		}
 	}
 	static const size_t no_index;
 
@@ -132,7 +212,54 @@ class Index
 	void writeXmlDefinition( gak::xml::Element *theXmlFieldDefs ) const;
 
 	void truncateFile();
-	void create();
+
+	/*
+		fvBTree is possible for index files only, the positions of table
+		records must not change. fvSplitHeap keeps the record headers in the
+		data file and the record buffers in an append only heap file.
+	*/
+	void create( int formatVersion=fvCurrent );
+	void convertFormat();
+
+	/*
+		compaction rewrites the data file in key order as a perfectly
+		balanced tree without deleted records. Every step copies maxRecords
+		records at most, the file remains usable between the steps. A step
+		returns true, when finishCompaction can swap the files.
+	*/
+	bool compactStep( size_t maxRecords, const Compactor *recPosMap=NULL );
+	void finishCompaction();
+	void cancelCompaction()
+	{
+		delete m_compactor;
+		m_compactor = nullptr;
+	}
+	bool isCompactionValid() const
+	{
+		return !m_compactor || m_compactor->isValid();
+	}
+	void compact();
+
+	/*
+		after beginBulkLoad postRecord only collects the new records,
+		endBulkLoad writes them as a balanced tree. With keepRecords the
+		existing records are loaded, too, otherwise they are dropped.
+	*/
+	void beginBulkLoad(
+		bool keepRecords=true, size_t memoryBudget=BulkLoader::DEFAULT_BUDGET
+	);
+	void writeBulkLoad();
+	void finishBulkLoad();
+	void cancelBulkLoad()
+	{
+		delete m_bulkLoader;
+		m_bulkLoader = nullptr;
+	}
+	void endBulkLoad();
+	bool isBulkLoading() const
+	{
+		return m_bulkLoader != nullptr;
+	}
 
 	size_t	getNumFields() const
 	{
@@ -140,6 +267,105 @@ class Index
 	}
 	gak::int64 getNumRecords();
 
+	/*
+		order statistics: ranks are 0 based positions in key order. The
+		tree is descended once, so paging does not walk all records before.
+	*/
+	bool seekToRank( gak::int64 rank );
+	gak::int64 getRank() const;
+	gak::int64 countRange( const gak::STRING &lo, const gak::STRING &hi ) const;
+
+	int getFormatVersion() const
+	{
+		return m_dataFileHandle->getFormatVersion();
+	}
+	bool isBTree() const
+	{
+		return getFormatVersion() == fvBTree;
+	}
+	bool isCurrentFormat() const
+	{
+		return getFormatVersion() == fvCurrent || getFormatVersion() == fvSplitHeap || isBTree();
+	}
+
+	/*
+		files older than fvOrderedNumber store the numbers as decimal text.
+		The records are read with ordered numbers, so they can not be
+		written back before convertFormat has sorted the file again.
+	*/
+	void checkNumberFormat() const
+	{
+		if( !Record::hasOrderedNumbers( m_dataFileHandle ) && m_currentRecord.hasNumberFields() )
+			throw DBformatTooOld( m_dataFile );
+	}
+	/*
+		the keys of these files contain the decimal text, too. A search
+		with ordered numbers would miss the records without any error.
+	*/
+	void checkSearchFormat( const gak::STRING &lower, const gak::STRING &upper="" ) const
+	{
+		if( lower[0U] || upper[0U] )
+			checkNumberFormat();
+	}
+
+	/*
+		a smaller alpha rotates less often, a larger one keeps the tree
+		flatter. The depth is at most log(n+1)/log(1/(1-alpha)). The root
+		of older format versions is not rotated.
+	*/
+	double getBalanceAlpha() const
+	{
+		return m_balanceAlpha;
+	}
+	void setBalanceAlpha( double alpha );
+
+	/*
+		the counters of the data and heap file, they are shared by all
+		openers of the same file
+	*/
+	FileStats getStats() const
+	{
+		FileStats	stats = m_dataFileHandle->getStats();
+		if( m_heapFileHandle )
+			stats += m_heapFileHandle->getStats();
+		return stats;
+	}
+	void resetStats()
+	{
+		m_dataFileHandle->resetStats();
+		if( m_heapFileHandle )
+			m_heapFileHandle->resetStats();
+	}
+
+	/*
+		the shape of the tree and the space lost by deleted records, to
+		decide whether a compaction is worth the work
+	*/
+	void analyzeTree( TreeReport *report ) const
+	{
+		if( isBTree() )
+			BTree::analyze( m_dataFileHandle, report );
+		else
+			TreeAnalyzer::analyze( m_dataFileHandle, m_balanceAlpha, report );
+	}
+	/*
+		read mostly tables can be mapped into memory, so that a lookup does
+		not need any system call. Of a table with a heap file only the
+		record headers are mapped. returns false if mapping is not possible.
+	*/
+	bool setMemoryMapped( bool mapped )
+	{
+		if( mapped )
+/***/		return m_dataFileHandle->mapFile();
+
+		m_dataFileHandle->unmapFile();
+		return true;
+	}
+	bool isMemoryMapped() const
+	{
+		return m_dataFileHandle->isMapped();
+	}
+
 	void addField(
 		const gak::STRING &name, fType type,
 		bool primary=false,
@@ -153,36 +379,86 @@ class Index
 	}
 	void postRecord()
 	{
-		m_currentRecord.postRecord( m_dataFileHandle );
+		if( m_bulkLoader )
+			m_bulkLoader->addRecord( &m_currentRecord );
+		else if( isBTree() )
+			m_btree.postRecord( m_dataFileHandle, &m_currentRecord );
+		else
+		{
+			checkNumberFormat();
+			m_currentRecord.postRecord( m_dataFileHandle, m_balanceAlpha );
+		}
 	}
-	void deleteRecord()
+	void deleteRecord( bool noMove=false )
 	{
-		m_currentRecord.deleteRecord( m_dataFileHandle );
+		checkNumberFormat();
+		if( isBTree() )
+			m_btree.deleteRecord( m_dataFileHandle, &m_currentRecord, noMove );
+		else
+			m_currentRecord.deleteRecord( m_dataFileHandle, m_balanceAlpha, noMove );
 	}
 	void root()
 	{
 		m_currentRecord.root( m_dataFileHandle );
 	}
 
+	/*
+		read only scans with a view do not copy the values into the fields
+	*/
+	void setRecordView( RecordView *view )
+	{
+		m_currentRecord.setView( view );
+	}
+	RecordView *getRecordView() const
+	{
+		return m_currentRecord.getView();
+	}
+
 
 	/*
 	 * cursor loop
 	 */
 	void firstRecord( const gak::STRING &searchBuffer="" )
 	{
-		m_currentRecord.firstRecord( m_dataFileHandle, searchBuffer );
+		firstRecord( KeyRange( searchBuffer, true, searchBuffer, true ) );
+	}
+	void firstRecord( const KeyRange &range )
+	{
+		if( isBTree() )
+			m_btree.firstRecord( m_dataFileHandle, &m_currentRecord, range );
+		else
+		{
+			checkSearchFormat( range.lower, range.upper );
+			m_currentRecord.firstRecord( m_dataFileHandle, range );
+		}
 	}
 	void nextRecord()
 	{
-		m_currentRecord.nextRecord( m_dataFileHandle );
+		if( isBTree() )
+			m_btree.nextRecord( m_dataFileHandle, &m_currentRecord );
+		else
+			m_currentRecord.nextRecord( m_dataFileHandle );
 	}
 	void previousRecord()
 	{
-		m_currentRecord.prevRecord( m_dataFileHandle );
+		if( isBTree() )
+			m_btree.prevRecord( m_dataFileHandle, &m_currentRecord );
+		else
+			m_currentRecord.prevRecord( m_dataFileHandle );
 	}
 	void lastRecord( const gak::STRING &searchBuffer="" )
 	{
-		m_currentRecord.lastRecord( m_dataFileHandle, searchBuffer );
+		lastRecord( KeyRange( searchBuffer, true, searchBuffer, true ) );
+	}
+	void lastRecord( const KeyRange &range )
+	{
+		if( isBTree() )
+			m_btree.lastRecord( m_dataFileHandle, &m_currentRecord, range );
+		else
+		{
+			checkSearchFormat( range.lower, range.upper );
+			m_currentRecord.lastRecord( m_dataFileHandle, range );
+		}
 	}
 	bool bof() const
 	{
@@ -195,27 +471,46 @@ class Index
 
 	FieldValue *getField( const gak::STRING &name );
 	FieldValue *getField( size_t fieldIdx );
+	/*
+		without lookup and check for typed tables, that know the index
+	*/
+	FieldValue *getFieldValue( size_t fieldIdx )
+	{
+		assert( fieldIdx < m_fieldDefinitions.size() );
+		return m_currentRecord.getFieldValue( fieldIdx );
+	}
 
 	const gak::STRING &getPathName() const
 	{
 		return m_pathName;
 	}
 
-	const gak::STRING getIndexPathName( const gak::STRING &indexName )
+	const gak::STRING getIndexPathName( const gak::STRING &indexName ) const
 	{
 		return getPathName() + '.' + indexName;
 	}
 
+	gak::int64 getDataFileSize() const
+	{
+		return m_dataFileHandle->getSize();
+	}
+
 	int locateValue(
 		gak::int64 *posFound,
 		const gak::STRING &searchFor, bool primary
 	)
 	{
-		if( (m_dataFileHandle->toEnd() - TABLE_HEADER_SIZE) > 0 )
+		if( isBTree() )
+/***/		return BTree::locateValue( m_dataFileHandle, posFound, searchFor, primary );
+
+		checkSearchFormat( searchFor );
+		const gak::int64	rootPos = Record::getRootPosition( m_dataFileHandle );
+
+		if( rootPos )
 		{
 			RecordHeader headerFound;
 
-			*posFound = TABLE_HEADER_SIZE;
+			*posFound = rootPos;
 			return Record::locateValue(
 				m_dataFileHandle,
 				posFound, &headerFound,
@@ -229,9 +524,14 @@ class Index
 		}
 	}
 
+	bool locateEntry( const gak::STRING &prefix );
+
 	void readRecord( gak::int64 position )
 	{
-		m_currentRecord.readRecord( m_dataFileHandle, position );
+		if( isBTree() )
+			m_btree.readRecord( m_dataFileHandle, &m_currentRecord, position );
+		else
+			m_currentRecord.readRecord( m_dataFileHandle, position );
 	}
 	const Record &getRecord() const
 	{
@@ -262,6 +562,8 @@ class Index
 // ----- prototypes ---------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+void writeTableHeader( DbFile *dataFileHandle, int formatVersion );
+
 // --------------------------------------------------------------------- //
 // ----- module functions ---------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			record.cpp
 		Description:	The definitions for one table record
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -73,6 +73,48 @@ namespace dbLib
 // ----- constants ----------------------------------------------------- //
 // --------------------------------------------------------------------- //
 
+static const int INT_LEN = 16;
+static const int NUM_INT = 8;
+static const int STATUS_LEN = 2;
+static const int MAGIC_LEN = 3;
+
+#define HEADER_LENGTH	NUM_INT*(INT_LEN+1)+STATUS_LEN+1+MAGIC_LEN
+
+/*
+	layout of the binary record header (fvBinaryHeader), all values are
+	little endian
+*/
+static const size_t BIN_TOP_PTR			= 0;
+static const size_t BIN_LOWER_PTR		= 8;
+static const size_t BIN_HIGHER_PTR		= 16;
+static const size_t BIN_NUM_RECORDS		= 24;
+static const size_t BIN_STRING_LENGTHS	= 32;
+static const size_t BIN_PRIMARY_LEN		= 40;
+static const size_t BIN_BUFFER_LEN		= 48;
+static const size_t BIN_NUM_FIELDS		= 56;
+static const size_t BIN_STATUS			= 60;
+static const size_t BIN_PREV_PTR		= 64;		// since fvThreaded
+static const size_t BIN_NEXT_PTR		= 72;
+static const size_t BIN_KEY_PREFIX		= 80;		// since fvKeyPrefix
+static const size_t BIN_HEAP_POS		= 96;		// fvSplitHeap only
+
+#define BINARY_HEADER_LENGTH	64
+#define THREADED_HEADER_LENGTH	80
+#define PREFIX_HEADER_LENGTH	96
+#define SPLIT_HEADER_LENGTH		104
+
+/*
+	free space management (fvFreeSpace): the small size classes grow by
+	SIZE_CLASS_STEP bytes, so that updates find a matching record easily,
+	the large classes grow by factor four. Every record in a higher class
+	is larger than any record in a lower class.
+*/
+static const gak::uint64	MIN_SLOT_SIZE = BINARY_HEADER_LENGTH;
+static const gak::uint64	SIZE_CLASS_STEP = 32;
+static const size_t			LINEAR_SIZE_CLASSES = 12;
+static const gak::uint64	MIN_SPLIT_SIZE = PREFIX_HEADER_LENGTH + 16;
+static const int			MAX_FREE_PROBES = 8;
+
 // --------------------------------------------------------------------- //
 // ----- macros -------------------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -107,35 +149,28 @@ using gak::STRING;
 // ----- module functions ---------------------------------------------- //
 // --------------------------------------------------------------------- //
 
-// --------------------------------------------------------------------- //
-// ----- class inlines ------------------------------------------------- //
-// --------------------------------------------------------------------- //
-
-// --------------------------------------------------------------------- //
-// ----- class constructors/destructors -------------------------------- //
-// --------------------------------------------------------------------- //
-
-// --------------------------------------------------------------------- //
-// ----- class static functions ---------------------------------------- //
-// --------------------------------------------------------------------- //
-
-static const int INT_LEN = 16;
-static const int NUM_INT = 8;
-static const int STATUS_LEN = 2;
-static const int MAGIC_LEN = 3;
+/*
+	true, if the cursor has to skip this record
+*/
+static bool skipDeleted( DbFile *dataFileHandle, const RecordHeader &theHeader )
+{
+	if( IsDeleted( theHeader ) )
+	{
+		dataFileHandle->count( scDeletedSkipped );
+/***/	return true;
+	}
 
-#define HEADER_LENGTH	NUM_INT*(INT_LEN+1)+STATUS_LEN+1+MAGIC_LEN
+	return false;
+}
 
-void Record::readRecordHeader(
-	DbFile *dataFileHandle, RecordHeader *theHeader
+static void readAsciiHeader(
+	DbFile *dataFileHandle, gak::int64 position, RecordHeader *theHeader
 )
 {
-	doEnterFunctionEx( gakLogging::llDetail, "Record::readRecordHeader" );
-
 	char	tmpBuffer[HEADER_LENGTH+1];
 	long	readLen;
 
-	readLen = dataFileHandle->read( tmpBuffer, HEADER_LENGTH );
+	readLen = dataFileHandle->read( position, tmpBuffer, HEADER_LENGTH );
 	if( readLen == HEADER_LENGTH )
 	{
 		tmpBuffer[HEADER_LENGTH] = 0;
@@ -157,17 +192,16 @@ void Record::readRecordHeader(
 		inp >> theHeader->bufferLen;
 		inp.get();
 		inp >> theHeader->status;
+		theHeader->prevPtr = theHeader->nextPtr = 0;
 	}
 	else
 		throw DBillegalRecordHeader();
 }
 
-void Record::writeRecordHeader(
-	DbFile *dataFileHandle, const RecordHeader &theHeader
+static void writeAsciiHeader(
+	DbFile *dataFileHandle, gak::int64 position, const RecordHeader &theHeader
 )
 {
-	doEnterFunctionEx( gakLogging::llDetail, "Record::writeRecordHeader" );
-
 	std::ostringstream	sout;
 
 	sout << std::setfill('0')
@@ -181,11 +215,510 @@ void Record::writeRecordHeader(
 		<< std::setw(INT_LEN) << theHeader.bufferLen << ';'
 		<< std::setw(STATUS_LEN) << theHeader.status << ";EOH";
 	sout.flush();
-	dataFileHandle->write( sout.str().c_str(), HEADER_LENGTH );
+	dataFileHandle->write( position, sout.str().c_str(), HEADER_LENGTH );
+}
+
+static void decodeBinaryHeader( const char *buffer, size_t headerLength, RecordHeader *theHeader )
+{
+	theHeader->topPtr = getBinary<gak::int64>( buffer, BIN_TOP_PTR );
+	theHeader->lowerRecordPtr = getBinary<gak::int64>( buffer, BIN_LOWER_PTR );
+	theHeader->higherRecordPtr = getBinary<gak::int64>( buffer, BIN_HIGHER_PTR );
+	theHeader->numRecords = getBinary<gak::int64>( buffer, BIN_NUM_RECORDS );
+	theHeader->stringLengths = getBinary<gak::uint64>( buffer, BIN_STRING_LENGTHS );
+	theHeader->primaryLen = getBinary<gak::uint64>( buffer, BIN_PRIMARY_LEN );
+	theHeader->bufferLen = getBinary<gak::uint64>( buffer, BIN_BUFFER_LEN );
+	theHeader->numFields = getBinary<gak::uint32>( buffer, BIN_NUM_FIELDS );
+	theHeader->status = getBinary<gak::int32>( buffer, BIN_STATUS );
+	if( headerLength >= THREADED_HEADER_LENGTH )
+	{
+		theHeader->prevPtr = getBinary<gak::int64>( buffer, BIN_PREV_PTR );
+		theHeader->nextPtr = getBinary<gak::int64>( buffer, BIN_NEXT_PTR );
+	}
+	else
+		theHeader->prevPtr = theHeader->nextPtr = 0;
+	if( headerLength >= PREFIX_HEADER_LENGTH )
+		memcpy( theHeader->keyPrefix, buffer + BIN_KEY_PREFIX, KEY_PREFIX_LEN );
+	else
+		memset( theHeader->keyPrefix, 0, KEY_PREFIX_LEN );
+	theHeader->heapPos = headerLength >= SPLIT_HEADER_LENGTH
+		? getBinary<gak::int64>( buffer, BIN_HEAP_POS )
+		: 0;
+}
+
+static void encodeBinaryHeader( const RecordHeader &theHeader, size_t headerLength, char *buffer )
+{
+	putBinary<gak::int64>( buffer, BIN_TOP_PTR, theHeader.topPtr );
+	putBinary<gak::int64>( buffer, BIN_LOWER_PTR, theHeader.lowerRecordPtr );
+	putBinary<gak::int64>( buffer, BIN_HIGHER_PTR, theHeader.higherRecordPtr );
+	putBinary<gak::int64>( buffer, BIN_NUM_RECORDS, theHeader.numRecords );
+	putBinary<gak::uint64>( buffer, BIN_STRING_LENGTHS, theHeader.stringLengths );
+	putBinary<gak::uint64>( buffer, BIN_PRIMARY_LEN, theHeader.primaryLen );
+	putBinary<gak::uint64>( buffer, BIN_BUFFER_LEN, theHeader.bufferLen );
+	putBinary<gak::uint32>( buffer, BIN_NUM_FIELDS, gak::uint32(theHeader.numFields) );
+	putBinary<gak::int32>( buffer, BIN_STATUS, theHeader.status );
+	if( headerLength >= THREADED_HEADER_LENGTH )
+	{
+		putBinary<gak::int64>( buffer, BIN_PREV_PTR, theHeader.prevPtr );
+		putBinary<gak::int64>( buffer, BIN_NEXT_PTR, theHeader.nextPtr );
+	}
+	if( headerLength >= PREFIX_HEADER_LENGTH )
+		memcpy( buffer + BIN_KEY_PREFIX, theHeader.keyPrefix, KEY_PREFIX_LEN );
+	if( headerLength >= SPLIT_HEADER_LENGTH )
+		putBinary<gak::int64>( buffer, BIN_HEAP_POS, theHeader.heapPos );
+}
+
+static bool hasFreeSpaceMap( const DbFile *dataFileHandle )
+{
+	return dataFileHandle->getFormatVersion() >= fvFreeSpace;
+}
+
+static bool hasThreadLinks( const DbFile *dataFileHandle )
+{
+	return dataFileHandle->getFormatVersion() >= fvThreaded;
+}
+
+static bool hasKeyPrefix( const DbFile *dataFileHandle )
+{
+	return dataFileHandle->getFormatVersion() >= fvKeyPrefix;
+}
+
+/*
+	the result of a comparison, if the first compareLen bytes are equal
+*/
+static int compareLengths( std::size_t recordLen, std::size_t searchLen, bool prefixOnly )
+{
+	if( recordLen < searchLen )
+/***/	return -1;
+	else if( recordLen > searchLen && !prefixOnly )
+/***/	return 1;
+
+	return 0;
+}
+
+/*
+	compares the key prefix of theHeader with searchFor like
+	Record::compareRecordBuffer.
+	returns false, if both continue behind the prefix and we need the buffer
+*/
+static bool compareKeyPrefix(
+	const RecordHeader &theHeader, std::size_t recordLen,
+	const char *searchFor, std::size_t searchLen, bool prefixOnly,
+	int *compareVal
+)
+{
+	const std::size_t	prefixLen = recordLen < KEY_PREFIX_LEN ? recordLen : KEY_PREFIX_LEN;
+
+	*compareVal = memcmp( theHeader.keyPrefix, searchFor, prefixLen < searchLen ? prefixLen : searchLen );
+	if( *compareVal )
+/***/	return true;
+
+	if( prefixLen < recordLen && prefixLen < searchLen )
+/***/	return false;
+
+	*compareVal = compareLengths( recordLen, searchLen, prefixOnly );
+	return true;
+}
+
+static size_t getSizeClass( gak::uint64 capacity )
+{
+	gak::uint64	limit = MIN_SLOT_SIZE + LINEAR_SIZE_CLASSES*SIZE_CLASS_STEP;
+
+	if( capacity < limit )
+/***/	return capacity > MIN_SLOT_SIZE ? size_t((capacity - MIN_SLOT_SIZE)/SIZE_CLASS_STEP) : 0;
+
+	size_t	sizeClass = LINEAR_SIZE_CLASSES;
+	while( sizeClass < FREE_SIZE_CLASSES-1 && (limit <<= 2) <= capacity )
+		sizeClass++;
+
+	return sizeClass;
+}
+
+static gak::int64 getFreeListHead( DbFile *dataFileHandle, size_t sizeClass )
+{
+	char	buffer[sizeof(gak::int64)];
+
+	if( dataFileHandle->read( TABLE_HEADER_SIZE + sizeClass*sizeof(gak::int64), buffer, sizeof(buffer) ) != long(sizeof(buffer)) )
+		throw DBillegalRecordHeader();
+
+	return getBinary<gak::int64>( buffer, 0 );
+}
+
+static void setFreeListHead( DbFile *dataFileHandle, size_t sizeClass, gak::int64 position )
+{
+	char	buffer[sizeof(gak::int64)];
+
+	putBinary<gak::int64>( buffer, 0, position );
+	dataFileHandle->write( TABLE_HEADER_SIZE + sizeClass*sizeof(gak::int64), buffer, sizeof(buffer) );
+}
+
+static gak::int64 translatePosition(
+	const gak::Array<gak::int64> &oldPositions,
+	const gak::Array<gak::int64> &newPositions,
+	gak::int64 oldPosition
+)
+{
+	if( !oldPositions.size() )
+/***/	return 0;
+
+	// the positions are sorted, because we collected them sequentially
+	size_t	left = 0, right = oldPositions.size();
+	while( left < right )
+	{
+		size_t	mid = (left+right)/2;
+		if( oldPositions[mid] < oldPosition )
+			left = mid+1;
+		else
+			right = mid;
+	}
+	if( left >= oldPositions.size() || oldPositions[left] != oldPosition )
+		throw DBillegalRecordHeader();
+
+	return newPositions[left];
+}
+
+// --------------------------------------------------------------------- //
+// ----- class inlines ------------------------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class constructors/destructors -------------------------------- //
+// --------------------------------------------------------------------- //
+
+// --------------------------------------------------------------------- //
+// ----- class static functions ---------------------------------------- //
+// --------------------------------------------------------------------- //
+
+size_t Record::getHeaderLength( const DbFile *dataFileHandle )
+{
+	const int	formatVersion = dataFileHandle->getFormatVersion();
+
+	return formatVersion == fvSplitHeap
+		? SPLIT_HEADER_LENGTH
+		: formatVersion == fvAsciiHeader
+			? HEADER_LENGTH
+			: formatVersion < fvThreaded
+				? BINARY_HEADER_LENGTH
+				: formatVersion < fvKeyPrefix
+					? THREADED_HEADER_LENGTH
+					: PREFIX_HEADER_LENGTH;
+}
+
+bool Record::hasHeapFile( const DbFile *dataFileHandle )
+{
+	return dataFileHandle->getFormatVersion() == fvSplitHeap;
+}
+
+bool Record::hasRootLink( const DbFile *dataFileHandle )
+{
+	return dataFileHandle->getFormatVersion() >= fvRootLink;
+}
+
+/*
+	older files store ftNumber values as decimal text
+*/
+bool Record::hasOrderedNumbers( const DbFile *dataFileHandle )
+{
+	return dataFileHandle->getFormatVersion() >= fvOrderedNumber;
+}
+
+/*
+	returns the position of the root record or 0 for an empty tree
+*/
+gak::int64 Record::getRootPosition( DbFile *dataFileHandle )
+{
+	if( hasRootLink( dataFileHandle ) )
+	{
+		char	buffer[sizeof(gak::int64)];
+
+		if( dataFileHandle->read( ROOT_LINK_POS, buffer, sizeof(buffer) ) != long(sizeof(buffer)) )
+			throw DBillegalRecordHeader();
+
+/***/	return getBinary<gak::int64>( buffer, 0 );
+	}
+
+	// the root of older files is the first record
+	const gak::int64	rootPos = getTableHeaderSize( dataFileHandle->getFormatVersion() );
+	return dataFileHandle->getSize() > rootPos ? rootPos : 0;
+}
+
+/*
+	older files have their root at a fixed position, there is nothing to do
+*/
+void Record::setRootPosition( DbFile *dataFileHandle, gak::int64 position )
+{
+	if( hasRootLink( dataFileHandle ) )
+	{
+		char	buffer[sizeof(gak::int64)];
+
+		putBinary<gak::int64>( buffer, 0, position );
+		dataFileHandle->write( ROOT_LINK_POS, buffer, sizeof(buffer) );
+	}
+}
+
+gak::int64 Record::getBufferPosition( const DbFile *dataFileHandle, const RecordHeader &theHeader )
+{
+	return hasHeapFile( dataFileHandle )
+		? theHeader.heapPos
+		: theHeader.address + gak::int64(getHeaderLength( dataFileHandle ));
+}
+
+/*
+	returns the space of the record in the data file
+*/
+gak::uint64 Record::getRecordSize( const DbFile *dataFileHandle, const RecordHeader &theHeader )
+{
+	const gak::uint64	headerLength = getHeaderLength( dataFileHandle );
+
+	return hasHeapFile( dataFileHandle )
+		? headerLength
+		: headerLength + theHeader.bufferLen + theHeader.stringLengths;
+}
+
+void Record::readRecordHeader(
+	DbFile *dataFileHandle, gak::int64 position, RecordHeader *theHeader
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::readRecordHeader" );
+
+	dataFileHandle->count( scHeadersRead );
+
+	if( dataFileHandle->getFormatVersion() == fvAsciiHeader )
+	{
+		readAsciiHeader( dataFileHandle, position, theHeader );
+	}
+	else
+	{
+		const size_t	headerLength = getHeaderLength( dataFileHandle );
+
+		if( const char *mapped = dataFileHandle->getMapped( position, headerLength ) )
+		{
+			decodeBinaryHeader( mapped, headerLength, theHeader );
+		}
+		else
+		{
+			char	tmpBuffer[SPLIT_HEADER_LENGTH];
+
+			if( dataFileHandle->read( position, tmpBuffer, headerLength ) != long(headerLength) )
+				throw DBillegalRecordHeader();
+
+			decodeBinaryHeader( tmpBuffer, headerLength, theHeader );
+		}
+	}
+}
+
+void Record::writeRecordHeader(
+	DbFile *dataFileHandle, gak::int64 position, const RecordHeader &theHeader
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::writeRecordHeader" );
+
+	dataFileHandle->count( scHeadersWritten );
+
+	if( dataFileHandle->getFormatVersion() == fvAsciiHeader )
+	{
+		writeAsciiHeader( dataFileHandle, position, theHeader );
+	}
+	else
+	{
+		const size_t	headerLength = getHeaderLength( dataFileHandle );
+		char			tmpBuffer[SPLIT_HEADER_LENGTH];
+
+		encodeBinaryHeader( theHeader, headerLength, tmpBuffer );
+		dataFileHandle->write( position, tmpBuffer, headerLength );
+	}
+}
+
+/*
+	copies all records of source to target with the record header format
+	of target. The records keep their order, so we can translate the tree
+	pointers with a sorted position table. The values are copied as they
+	are, Index::convertFormat sorts files with decimal numbers again.
+*/
+void Record::convertFile( DbFile *source, DbFile *target, double balanceAlpha )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::convertFile" );
+
+	gak::Array<gak::int64>	oldPositions, newPositions, deletedPositions;
+	RecordHeader			theHeader;
+
+	const gak::int64	sourceEnd = source->getSize();
+	const size_t		sourceHeaderLength = getHeaderLength( source );
+	const size_t		targetHeaderLength = getHeaderLength( target );
+
+	gak::int64	oldPosition = getTableHeaderSize( source->getFormatVersion() );
+	gak::int64	newPosition = getTableHeaderSize( target->getFormatVersion() );
+	while( oldPosition < sourceEnd )
+	{
+		loadRecordHeader( oldPosition, source, &theHeader );
+		gak::int64	dataSize = theHeader.bufferLen + theHeader.stringLengths;
+
+		// free records are not part of the tree, we can drop them
+		if( !IsFree( theHeader ) )
+		{
+			oldPositions.addElement( oldPosition );
+			newPositions.addElement( newPosition );
+			newPosition += targetHeaderLength + dataSize;
+		}
+		oldPosition += sourceHeaderLength + dataSize;
+	}
+
+	for( size_t i=0; i<oldPositions.size(); ++i )
+	{
+		loadRecordHeader( oldPositions[i], source, &theHeader );
+		gak::Buffer<char>	recBuffer( readRecordBuffer(
+			source, oldPositions[i] + sourceHeaderLength,
+			theHeader.bufferLen + theHeader.stringLengths, true
+		) );
+
+		if( theHeader.topPtr )
+			theHeader.topPtr = translatePosition( oldPositions, newPositions, theHeader.topPtr );
+		if( theHeader.lowerRecordPtr )
+			theHeader.lowerRecordPtr = translatePosition( oldPositions, newPositions, theHeader.lowerRecordPtr );
+		if( theHeader.higherRecordPtr )
+			theHeader.higherRecordPtr = translatePosition( oldPositions, newPositions, theHeader.higherRecordPtr );
+		if( theHeader.prevPtr )
+			theHeader.prevPtr = translatePosition( oldPositions, newPositions, theHeader.prevPtr );
+		if( theHeader.nextPtr )
+			theHeader.nextPtr = translatePosition( oldPositions, newPositions, theHeader.nextPtr );
+		theHeader.setKeyPrefix( recBuffer );
+		if( IsDeleted( theHeader ) )
+			deletedPositions.addElement( newPositions[i] );
+
+		writeRecordHeader( target, newPositions[i], theHeader );
+		target->write(
+			newPositions[i] + targetHeaderLength,
+			recBuffer, std::size_t(theHeader.bufferLen + theHeader.stringLengths)
+		);
+		target->count( scPayloadWritten, theHeader.bufferLen + theHeader.stringLengths );
+	}
+
+	const gak::int64	rootPos = getRootPosition( source );
+	if( rootPos )
+		setRootPosition( target, translatePosition( oldPositions, newPositions, rootPos ) );
+
+	if( hasThreadLinks( target ) && !hasThreadLinks( source ) )
+		threadRecords( target );
+
+	// deleted records, that older files kept in the tree, can be removed now
+	if( hasRootLink( target ) )
+	{
+		for( size_t i=0; i<deletedPositions.size(); ++i )
+		{
+			rebalancePath( target, unlinkRecord( target, deletedPositions[i] ), balanceAlpha );
+			freeRecord( target, deletedPositions[i] );
+		}
+	}
+}
+
+/*
+	links all records of the tree in key order. Deleted records that are
+	still part of the tree are linked, too.
+*/
+void Record::threadRecords( DbFile *dataFileHandle )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::threadRecords" );
+
+	const gak::int64	rootPos = getRootPosition( dataFileHandle );
+	if( !rootPos )
+/***/	return;
+
+	gak::Array<gak::int64>	path;
+	gak::int64				position = rootPos;
+	RecordHeader			theHeader, prevHeader;
+
+	while( position || path.size() )
+	{
+		if( position )
+		{
+			path.addElement( position );
+			loadRecordHeader( position, dataFileHandle, &theHeader );
+			position = theHeader.lowerRecordPtr;
+		}
+		else
+		{
+			position = path[path.size()-1];
+			path.removeElementAt( path.size()-1 );
+			loadRecordHeader( position, dataFileHandle, &theHeader );
+
+			// the previous record is complete, now
+			theHeader.prevPtr = prevHeader.address;
+			if( prevHeader.address )
+			{
+				prevHeader.nextPtr = position;
+				updateRecordHeader( dataFileHandle, prevHeader );
+			}
+			prevHeader = theHeader;
+			position = theHeader.higherRecordPtr;
+		}
+	}
+
+	prevHeader.nextPtr = 0;
+	updateRecordHeader( dataFileHandle, prevHeader );
+}
+
+/*
+	positions contains the sizes of the records in key order and gets
+	their new positions. The root of the balanced tree is the middle record,
+	it must be the first one in the file.
+*/
+void Record::layoutBalancedTree( gak::Array<gak::int64> *positions, gak::int64 rootPos )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::layoutBalancedTree" );
+
+	const size_t	numRecords = positions->size();
+	const size_t	rootIdx = numRecords/2;
+	gak::int64		newPos = rootPos;
+
+	if( numRecords )
+	{
+		newPos += (*positions)[rootIdx];
+		(*positions)[rootIdx] = rootPos;
+	}
+	for( size_t i=0; i<numRecords; ++i )
+	{
+		if( i != rootIdx )
+		{
+			gak::int64	size = (*positions)[i];
+			(*positions)[i] = newPos;
+			newPos += size;
+		}
+	}
+}
+
+/*
+	the subtree of a record covers a range of records, the record is in the
+	middle of its range. We find that range by descending from the root.
+*/
+void Record::getBalancedLinks(
+	const gak::Array<gak::int64> &positions, size_t recordIdx,
+	RecordHeader *theHeader
+)
+{
+	size_t	lower = 0, upper = positions.size();
+	size_t	mid = (lower+upper)/2;
+
+	theHeader->topPtr = 0;
+	while( mid != recordIdx )
+	{
+		theHeader->topPtr = positions[mid];
+		if( recordIdx < mid )
+			upper = mid;
+		else
+			lower = mid+1;
+
+		mid = (lower+upper)/2;
+	}
+
+	theHeader->lowerRecordPtr = lower < mid ? positions[(lower+mid)/2] : 0;
+	theHeader->higherRecordPtr = mid+1 < upper ? positions[(mid+1+upper)/2] : 0;
+	theHeader->numRecords = gak::int64(upper - lower);
+
+	theHeader->prevPtr = recordIdx ? positions[recordIdx-1] : 0;
+	theHeader->nextPtr = recordIdx+1 < positions.size() ? positions[recordIdx+1] : 0;
 }
 
 char *Record::readRecordBuffer(
-	DbFile *dataFileHandle, gak::int64 length, bool primary
+	DbFile *dataFileHandle, gak::int64 position, gak::int64 length, bool primary
 )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Record::readRecordBuffer" );
@@ -196,7 +729,8 @@ char *Record::readRecordBuffer(
 
 	if( recBuffer )
 	{
-		readLen = dataFileHandle->read( recBuffer, std::size_t(length) );
+		readLen = dataFileHandle->read( position, recBuffer, std::size_t(length) );
+		dataFileHandle->count( scPayloadRead, gak::uint64(length) );
 		if( readLen == length )
 		{
 			recBuffer[readLen] = 0;
@@ -211,9 +745,684 @@ char *Record::readRecordBuffer(
 		}
 	}
 	else
-		throw DBmemoryException();
+		throw DBmemoryException();
+
+	return recBuffer.prepareMove();
+}
+
+/*
+	writes the header and the buffer of a record to the position in
+	theHeader. The lengths are padded with 0 up to stringLengths. With a
+	heap file the buffer is appended to the heap.
+*/
+void Record::writeRecord(
+	DbFile *dataFileHandle, RecordHeader *theHeader,
+	const char *theValues, const char *theStringLengths
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::writeRecord" );
+	static const char	padding[MIN_SPLIT_SIZE] = { 0 };
+
+	const std::size_t	lengthsLen = strlen( theStringLengths );
+	DbFile				*bufferFile = getBufferFile( dataFileHandle );
+
+	if( bufferFile != dataFileHandle )
+		theHeader->heapPos = bufferFile->getSize();
+
+	gak::int64	dataPosition = getBufferPosition( dataFileHandle, *theHeader );
+	writeRecordHeader( dataFileHandle, theHeader->address, *theHeader );
+	bufferFile->write( dataPosition, theValues, std::size_t(theHeader->bufferLen) );
+	dataPosition += theHeader->bufferLen;
+	bufferFile->write( dataPosition, theStringLengths, lengthsLen );
+	bufferFile->count( scPayloadWritten, theHeader->bufferLen + lengthsLen );
+	if( theHeader->stringLengths > lengthsLen )
+	{
+		dataPosition += lengthsLen;
+		bufferFile->write( dataPosition, padding, std::size_t(theHeader->stringLengths - lengthsLen) );
+	}
+}
+
+/*
+	compares the record buffer of theHeader (or its primary part) with
+	searchFor like strcmp. All field values are encoded in their sort
+	order, so a single memcmp does the job. Usually the key prefix in the
+	header decides, otherwise we read the buffer. For mapped files we
+	compare in place without copying the buffer.
+*/
+int Record::compareRecordBuffer(
+	DbFile *dataFileHandle, const RecordHeader &theHeader, bool primary,
+	const STRING &searchFor, bool prefixOnly
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::compareRecordBuffer" );
+
+	const gak::int64	length = primary ? theHeader.primaryLen : theHeader.bufferLen;
+	const std::size_t	recordLen = std::size_t(length);
+	const std::size_t	searchLen = strlen( searchFor );
+	int					compareVal;
+
+	if( hasKeyPrefix( dataFileHandle )
+	&& compareKeyPrefix( theHeader, recordLen, searchFor, searchLen, prefixOnly, &compareVal ) )
+/***/	return compareVal;
+
+	dataFileHandle->count( scKeyReads );
+
+	DbFile				*bufferFile = getBufferFile( dataFileHandle );
+	const char			*recBuffer = bufferFile->getMapped(
+		getBufferPosition( dataFileHandle, theHeader ), recordLen
+	);
+	gak::Buffer<char>	tmpRecord(
+		recBuffer ? NULL : readRecordBuffer( dataFileHandle, theHeader, length, primary )
+	);
+	if( !recBuffer )
+		recBuffer = tmpRecord;
+	else if( !primary && (length < 4 || memcmp( recBuffer+length-4, ";EOB", 4 )) )
+	{
+		throw DBillegalRecordlen();
+	}
+	else
+		bufferFile->count( scPayloadRead, gak::uint64(length) );
+
+	compareVal = memcmp( recBuffer, (const char *)searchFor, recordLen < searchLen ? recordLen : searchLen );
+	if( !compareVal )
+		compareVal = compareLengths( recordLen, searchLen, prefixOnly );
+
+	return compareVal;
+}
+
+/*
+	searches a live record, whose buffer starts with prefix, in the subtree
+	at position. All records with the same prefix are neighbours, so we
+	only have to look into both subtrees of deleted records.
+	returns the position of the record or 0
+*/
+gak::int64 Record::locatePrefix(
+	DbFile *dataFileHandle, gak::int64 position, const STRING &prefix
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::locatePrefix" );
+
+	RecordHeader	theHeader;
+
+	while( position )
+	{
+		loadRecordHeader( position, dataFileHandle, &theHeader );
+
+		int compareVal = compareRecordBuffer( dataFileHandle, theHeader, false, prefix, true );
+		if( !compareVal )
+		{
+			if( !IsDeleted( theHeader ) )
+/***/			return position;
+
+			gak::int64	higherRecordPtr = theHeader.higherRecordPtr;
+			if( theHeader.lowerRecordPtr )
+			{
+				gak::int64	found = locatePrefix( dataFileHandle, theHeader.lowerRecordPtr, prefix );
+				if( found )
+/***/				return found;
+			}
+			position = higherRecordPtr;
+		}
+		else if( compareVal < 0 )
+			position = theHeader.higherRecordPtr;
+		else
+			position = theHeader.lowerRecordPtr;
+	}
+
+	return 0;
+}
+
+/*
+	searches the first record, whose buffer is greater than key or starts
+	with it, if inclusive. With upper we search the last record, that is
+	less than key or starts with it. The ancestors of the record found are
+	stored in path.
+	returns the position of the record or 0
+*/
+gak::int64 Record::locateBound(
+	DbFile *dataFileHandle, gak::int64 position, const STRING &key,
+	bool upper, bool inclusive, RecordPath *path
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::locateBound" );
+
+	gak::int64		found = 0;
+	size_t			foundDepth = 0;
+	RecordHeader	theHeader;
+
+	path->clear();
+	while( position )
+	{
+		loadRecordHeader( position, dataFileHandle, &theHeader );
+
+		bool	isCandidate = true;
+		if( key[0U] )
+		{
+			int compareVal = compareRecordBuffer( dataFileHandle, theHeader, false, key, true );
+			if( upper )
+				isCandidate = inclusive ? compareVal <= 0 : compareVal < 0;
+			else
+				isCandidate = inclusive ? compareVal >= 0 : compareVal > 0;
+		}
+
+		path->addElement( theHeader );
+		if( isCandidate )
+		{
+			found = position;
+			foundDepth = path->size()-1;
+			position = upper ? theHeader.higherRecordPtr : theHeader.lowerRecordPtr;
+		}
+		else
+			position = upper ? theHeader.lowerRecordPtr : theHeader.higherRecordPtr;
+	}
+	path->setSize( foundDepth );
+
+	return found;
+}
+
+/*
+	returns the number of records in the lower subtree of theHeader
+*/
+gak::int64 Record::getLowerCount( DbFile *dataFileHandle, const RecordHeader &theHeader )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::getLowerCount" );
+
+	return getLiveCount( dataFileHandle, theHeader.lowerRecordPtr );
+}
+
+/*
+	returns the number of live records in the subtree at position. Since
+	fvFreeSpace only the root can be a deleted record. Older files never
+	unlink a deleted record and numRecords counts them, too, so we must
+	visit every record of the subtree.
+*/
+gak::int64 Record::getLiveCount( DbFile *dataFileHandle, gak::int64 position )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::getLiveCount" );
+
+	gak::int64		count = 0;
+	RecordHeader	theHeader;
+
+	if( hasFreeSpaceMap( dataFileHandle ) )
+	{
+		if( !position )
+/***/		return 0;
+
+		readRecordHeader( dataFileHandle, position, &theHeader );
+		return IsDeleted( theHeader ) ? theHeader.numRecords-1 : theHeader.numRecords;
+	}
+
+	while( position )
+	{
+		readRecordHeader( dataFileHandle, position, &theHeader );
+		if( !IsDeleted( theHeader ) )
+			count++;
+		count += getLiveCount( dataFileHandle, theHeader.lowerRecordPtr );
+		position = theHeader.higherRecordPtr;
+	}
+
+	return count;
+}
+
+/*
+	returns the number of records in the subtree at position
+*/
+gak::int64 Record::getSubtreeSize( DbFile *dataFileHandle, gak::int64 position )
+{
+	if( !position )
+/***/	return 0;
+
+	RecordHeader	theHeader;
+	readRecordHeader( dataFileHandle, position, &theHeader );
+	return theHeader.numRecords;
+}
+
+/*
+	searches the record with the given rank. The lower counts exclude
+	deleted records, so only a deleted record on the path must be skipped.
+	returns the position of the record or 0
+*/
+gak::int64 Record::locateRank(
+	DbFile *dataFileHandle, gak::int64 rootPos, gak::int64 rank
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::locateRank" );
+
+	gak::int64		position = rootPos;
+	RecordHeader	theHeader;
+
+	if( rank < 0 )
+/***/	return 0;
+
+	while( position )
+	{
+		loadRecordHeader( position, dataFileHandle, &theHeader );
+
+		const gak::int64	lowerCount = getLowerCount( dataFileHandle, theHeader );
+		if( rank < lowerCount )
+		{
+			position = theHeader.lowerRecordPtr;
+/*^*/		continue;
+		}
+
+		rank -= lowerCount;
+		if( !IsDeleted( theHeader ) )
+		{
+			if( !rank )
+/***/			return position;
+			rank--;
+		}
+		position = theHeader.higherRecordPtr;
+	}
+
+	return 0;
+}
+
+/*
+	returns the rank of the record at position. We climb through the top
+	pointers and add the lower subtree of every ancestor, we reach from
+	its higher subtree.
+*/
+gak::int64 Record::getRank( DbFile *dataFileHandle, gak::int64 position )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::getRank" );
+
+	RecordHeader	theHeader, topHeader;
+
+	loadRecordHeader( position, dataFileHandle, &theHeader );
+	gak::int64	rank = getLowerCount( dataFileHandle, theHeader );
+
+	while( theHeader.topPtr )
+	{
+		loadRecordHeader( theHeader.topPtr, dataFileHandle, &topHeader );
+		if( topHeader.higherRecordPtr == theHeader.address )
+		{
+			rank += hasFreeSpaceMap( dataFileHandle )
+				? topHeader.numRecords - theHeader.numRecords - 1
+				: getLowerCount( dataFileHandle, topHeader );
+			if( !IsDeleted( topHeader ) )
+				rank++;
+		}
+		theHeader = topHeader;
+	}
+
+	return rank;
+}
+
+/*
+	counts the live records, whose buffer is less than searchFor. With
+	orEqual records starting with searchFor are counted, too.
+*/
+gak::int64 Record::countLess(
+	DbFile *dataFileHandle, gak::int64 rootPos,
+	const STRING &searchFor, bool orEqual
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::countLess" );
+
+	gak::int64		position = rootPos;
+	gak::int64		count = 0;
+	RecordHeader	theHeader;
+
+	while( position )
+	{
+		loadRecordHeader( position, dataFileHandle, &theHeader );
+
+		int compareVal = compareRecordBuffer( dataFileHandle, theHeader, false, searchFor, true );
+		if( compareVal < 0 || (!compareVal && orEqual) )
+		{
+			count += getLowerCount( dataFileHandle, theHeader );
+			if( !IsDeleted( theHeader ) )
+				count++;
+			position = theHeader.higherRecordPtr;
+		}
+		else
+			position = theHeader.lowerRecordPtr;
+	}
+
+	return count;
+}
+
+/*
+	rotates the subtree at position: its lower (lowerUp) or its higher
+	child becomes the top of the subtree. The key order does not change,
+	so the thread links remain valid.
+	returns the new top of the subtree
+*/
+gak::int64 Record::rotateRecord( DbFile *dataFileHandle, gak::int64 position, bool lowerUp )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::rotateRecord" );
+
+	RecordHeader	topHeader, childHeader, tmpHeader;
+	gak::int64		childPos, innerPos, innerSize = 0;
+
+	dataFileHandle->count( scRebalances );
+
+	loadRecordHeader( position, dataFileHandle, &topHeader );
+	assert( topHeader.topPtr || hasRootLink( dataFileHandle ) );
+
+	childPos = lowerUp ? topHeader.lowerRecordPtr : topHeader.higherRecordPtr;
+	assert( childPos );
+	loadRecordHeader( childPos, dataFileHandle, &childHeader );
+
+	// the inner subtree of the child moves to the other side
+	if( lowerUp )
+	{
+		innerPos = childHeader.higherRecordPtr;
+		topHeader.lowerRecordPtr = innerPos;
+		childHeader.higherRecordPtr = position;
+	}
+	else
+	{
+		innerPos = childHeader.lowerRecordPtr;
+		topHeader.higherRecordPtr = innerPos;
+		childHeader.lowerRecordPtr = position;
+	}
+	if( innerPos )
+	{
+		loadRecordHeader( innerPos, dataFileHandle, &tmpHeader );
+		innerSize = tmpHeader.numRecords;
+		tmpHeader.topPtr = position;
+		updateRecordHeader( dataFileHandle, tmpHeader );
+	}
+
+	const gak::int64	parentPos = topHeader.topPtr;
+	const gak::int64	subtreeSize = topHeader.numRecords;
+
+	topHeader.numRecords = subtreeSize - childHeader.numRecords + innerSize;
+	topHeader.topPtr = childPos;
+	childHeader.numRecords = subtreeSize;
+	childHeader.topPtr = parentPos;
+	updateRecordHeader( dataFileHandle, topHeader );
+	updateRecordHeader( dataFileHandle, childHeader );
+
+	if( parentPos )
+	{
+		loadRecordHeader( parentPos, dataFileHandle, &tmpHeader );
+		if( tmpHeader.lowerRecordPtr == position )
+			tmpHeader.lowerRecordPtr = childPos;
+		else
+			tmpHeader.higherRecordPtr = childPos;
+		updateRecordHeader( dataFileHandle, tmpHeader );
+	}
+	else
+		setRootPosition( dataFileHandle, childPos );
+
+	return childPos;
+}
+
+/*
+	BB[alpha]: the weight of a subtree is its number of records plus one.
+	If one subtree of the record at position has less than alpha of the
+	weight, the heavier child moves up. If the inner grandchild has more
+	than 1/(2-alpha) of the weight of that child, a double rotation moves
+	the grandchild up instead. The root of older files cannot move.
+	returns the top of the subtree
+*/
+gak::int64 Record::rebalanceRecord(
+	DbFile *dataFileHandle, gak::int64 position, double balanceAlpha
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::rebalanceRecord" );
+
+	RecordHeader	theHeader, childHeader;
+
+	loadRecordHeader( position, dataFileHandle, &theHeader );
+	if( !theHeader.topPtr && !hasRootLink( dataFileHandle ) )
+/***/	return position;
+
+	const gak::int64	lowerWeight = getSubtreeSize( dataFileHandle, theHeader.lowerRecordPtr ) + 1;
+	const gak::int64	higherWeight = getSubtreeSize( dataFileHandle, theHeader.higherRecordPtr ) + 1;
+	const double		minWeight = balanceAlpha * double(lowerWeight + higherWeight);
+	bool				lowerUp;
+
+	if( double(higherWeight) < minWeight )
+		lowerUp = true;
+	else if( double(lowerWeight) < minWeight )
+		lowerUp = false;
+	else
+/***/	return position;
+
+	const gak::int64	childPos = lowerUp ? theHeader.lowerRecordPtr : theHeader.higherRecordPtr;
+	loadRecordHeader( childPos, dataFileHandle, &childHeader );
+
+	const gak::int64	innerWeight = getSubtreeSize(
+		dataFileHandle, lowerUp ? childHeader.higherRecordPtr : childHeader.lowerRecordPtr
+	) + 1;
+	if( double(innerWeight) * (2.0 - balanceAlpha) > double(childHeader.numRecords + 1) )
+		rotateRecord( dataFileHandle, childPos, !lowerUp );
+
+	return rotateRecord( dataFileHandle, position, lowerUp );
+}
+
+/*
+	rebalances the subtrees from position up to the root, after a record
+	below position was inserted or removed
+*/
+void Record::rebalancePath(
+	DbFile *dataFileHandle, gak::int64 position, double balanceAlpha
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::rebalancePath" );
+
+	RecordHeader	theHeader;
+
+	while( position )
+	{
+		position = rebalanceRecord( dataFileHandle, position, balanceAlpha );
+		loadRecordHeader( position, dataFileHandle, &theHeader );
+		position = theHeader.topPtr;
+	}
+}
+
+/*
+	removes a record from the tree. A record with two children is replaced
+	by its successor. The root of older files must remain in the tree.
+	returns the lowest record, whose subtree got smaller, or 0
+*/
+gak::int64 Record::unlinkRecord( DbFile *dataFileHandle, gak::int64 position )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::unlinkRecord" );
+
+	RecordHeader	delHeader, succHeader, tmpHeader;
+	gak::int64		succPos, replacePos, tmpPos, changedPos;
+
+	loadRecordHeader( position, dataFileHandle, &delHeader );
+	assert( delHeader.topPtr || hasRootLink( dataFileHandle ) );
+
+	if( delHeader.lowerRecordPtr && delHeader.higherRecordPtr )
+	{
+		succPos = delHeader.higherRecordPtr;
+		loadRecordHeader( succPos, dataFileHandle, &succHeader );
+		while( succHeader.lowerRecordPtr )
+		{
+			succPos = succHeader.lowerRecordPtr;
+			loadRecordHeader( succPos, dataFileHandle, &succHeader );
+		}
+	}
+	else
+		succPos = 0;
+
+	// all subtrees above the record to remove get smaller
+	tmpPos = succPos ? succHeader.topPtr : delHeader.topPtr;
+	while( tmpPos )
+	{
+		loadRecordHeader( tmpPos, dataFileHandle, &tmpHeader );
+		tmpHeader.numRecords--;
+		updateRecordHeader( dataFileHandle, tmpHeader );
+		tmpPos = tmpHeader.topPtr;
+	}
+	loadRecordHeader( position, dataFileHandle, &delHeader );
+
+	if( succPos )
+	{
+		loadRecordHeader( succPos, dataFileHandle, &succHeader );
+		changedPos = succPos;
+		if( succHeader.topPtr != position )
+		{
+			// take the successor out of its old place
+			changedPos = succHeader.topPtr;
+			loadRecordHeader( succHeader.topPtr, dataFileHandle, &tmpHeader );
+			tmpHeader.lowerRecordPtr = succHeader.higherRecordPtr;
+			updateRecordHeader( dataFileHandle, tmpHeader );
+			if( succHeader.higherRecordPtr )
+			{
+				loadRecordHeader( succHeader.higherRecordPtr, dataFileHandle, &tmpHeader );
+				tmpHeader.topPtr = succHeader.topPtr;
+				updateRecordHeader( dataFileHandle, tmpHeader );
+			}
+
+			succHeader.higherRecordPtr = delHeader.higherRecordPtr;
+			loadRecordHeader( delHeader.higherRecordPtr, dataFileHandle, &tmpHeader );
+			tmpHeader.topPtr = succPos;
+			updateRecordHeader( dataFileHandle, tmpHeader );
+		}
+
+		succHeader.lowerRecordPtr = delHeader.lowerRecordPtr;
+		loadRecordHeader( delHeader.lowerRecordPtr, dataFileHandle, &tmpHeader );
+		tmpHeader.topPtr = succPos;
+		updateRecordHeader( dataFileHandle, tmpHeader );
+
+		succHeader.topPtr = delHeader.topPtr;
+		succHeader.numRecords = delHeader.numRecords;
+		updateRecordHeader( dataFileHandle, succHeader );
+
+		replacePos = succPos;
+	}
+	else
+	{
+		replacePos = delHeader.lowerRecordPtr ? delHeader.lowerRecordPtr : delHeader.higherRecordPtr;
+		if( replacePos )
+		{
+			loadRecordHeader( replacePos, dataFileHandle, &tmpHeader );
+			tmpHeader.topPtr = delHeader.topPtr;
+			updateRecordHeader( dataFileHandle, tmpHeader );
+		}
+		changedPos = delHeader.topPtr;
+	}
+
+	if( delHeader.topPtr )
+	{
+		loadRecordHeader( delHeader.topPtr, dataFileHandle, &tmpHeader );
+		if( tmpHeader.lowerRecordPtr == position )
+			tmpHeader.lowerRecordPtr = replacePos;
+		else
+			tmpHeader.higherRecordPtr = replacePos;
+		updateRecordHeader( dataFileHandle, tmpHeader );
+	}
+	else
+		setRootPosition( dataFileHandle, replacePos );
+
+	// the neighbours in key order are linked directly now
+	if( delHeader.prevPtr )
+	{
+		loadRecordHeader( delHeader.prevPtr, dataFileHandle, &tmpHeader );
+		tmpHeader.nextPtr = delHeader.nextPtr;
+		updateRecordHeader( dataFileHandle, tmpHeader );
+	}
+	if( delHeader.nextPtr )
+	{
+		loadRecordHeader( delHeader.nextPtr, dataFileHandle, &tmpHeader );
+		tmpHeader.prevPtr = delHeader.prevPtr;
+		updateRecordHeader( dataFileHandle, tmpHeader );
+	}
+
+	return changedPos;
+}
+
+/*
+	puts an unlinked record into the free list of its size class
+*/
+void Record::freeRecord( DbFile *dataFileHandle, gak::int64 position )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::freeRecord" );
+
+	RecordHeader	theHeader;
+
+	loadRecordHeader( position, dataFileHandle, &theHeader );
+
+	size_t	sizeClass = getSizeClass( getRecordSize( dataFileHandle, theHeader ) );
+
+	theHeader.status = REC_DELETED|REC_FREE;
+	theHeader.topPtr = theHeader.higherRecordPtr = 0;
+	theHeader.prevPtr = theHeader.nextPtr = 0;
+	theHeader.numRecords = 0;
+	theHeader.lowerRecordPtr = getFreeListHead( dataFileHandle, sizeClass );
+	updateRecordHeader( dataFileHandle, theHeader );
+
+	setFreeListHead( dataFileHandle, sizeClass, position );
+}
+
+/*
+	finds space for a new record of size bytes. We try a few records of
+	the matching size class first, any record of a higher class is large
+	enough. Large remainders are returned to the free lists.
+	returns the position and the capacity of the space
+*/
+gak::int64 Record::allocateRecord(
+	DbFile *dataFileHandle, gak::uint64 size, gak::uint64 *capacity
+)
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::allocateRecord" );
+
+	*capacity = size;
+	if( !hasFreeSpaceMap( dataFileHandle ) )
+/***/	return dataFileHandle->getSize();
+
+	RecordHeader	theHeader;
+	gak::int64		position = 0, prevPos = 0;
+	size_t			sizeClass = getSizeClass( size );
+
+	position = getFreeListHead( dataFileHandle, sizeClass );
+	for( int i=0; position && i<MAX_FREE_PROBES; ++i )
+	{
+		loadRecordHeader( position, dataFileHandle, &theHeader );
+		if( getRecordSize( dataFileHandle, theHeader ) >= size )
+/*v*/		break;
+
+		prevPos = position;
+		position = theHeader.lowerRecordPtr;
+	}
+	if( position && getRecordSize( dataFileHandle, theHeader ) < size )
+		position = 0;
+
+	while( !position && ++sizeClass < FREE_SIZE_CLASSES )
+	{
+		prevPos = 0;
+		position = getFreeListHead( dataFileHandle, sizeClass );
+		if( position )
+			loadRecordHeader( position, dataFileHandle, &theHeader );
+	}
+
+	if( !position )
+/***/	return dataFileHandle->getSize();
+
+	// remove from the free list
+	if( prevPos )
+	{
+		RecordHeader	prevHeader;
+
+		loadRecordHeader( prevPos, dataFileHandle, &prevHeader );
+		prevHeader.lowerRecordPtr = theHeader.lowerRecordPtr;
+		updateRecordHeader( dataFileHandle, prevHeader );
+	}
+	else
+		setFreeListHead( dataFileHandle, sizeClass, theHeader.lowerRecordPtr );
 
-	return recBuffer.prepareMove();
+	*capacity = getRecordSize( dataFileHandle, theHeader );
+	if( *capacity - size >= MIN_SPLIT_SIZE )
+	{
+		RecordHeader	restHeader;
+
+		restHeader.address = position + size;
+		restHeader.stringLengths = *capacity - size - getHeaderLength( dataFileHandle );
+		updateRecordHeader( dataFileHandle, restHeader );
+		freeRecord( dataFileHandle, restHeader.address );
+
+		*capacity = size;
+	}
+
+	return position;
 }
 
 int Record::locateValue(
@@ -226,27 +1435,21 @@ int Record::locateValue(
 	gak::int64	newPosition = *posFound;
 	bool		found = false;
 	int			compareVal = 0;
+	gak::uint64	depth = 0;
 
 	while( !found )
 	{
-		*posFound = dataFileHandle->seek( newPosition );
-		if( newPosition != *posFound )
+		if( newPosition >= dataFileHandle->getSize() )
 		{
 			*posFound = 0;	// empty/bad file ?
 /*v*/		break;
 		}
 
-		readRecordHeader( dataFileHandle, headerFound );
-		headerFound->address = newPosition;
+		*posFound = newPosition;
+		loadRecordHeader( newPosition, dataFileHandle, headerFound );
+		depth++;
 
-		{
-			gak::Buffer<char> tmpRecord = readRecordBuffer(
-				dataFileHandle,
-				primary ? headerFound->primaryLen : headerFound->bufferLen,
-				primary
-			);
-			compareVal = strcmp( tmpRecord, searchFor );
-		}
+		compareVal = compareRecordBuffer( dataFileHandle, *headerFound, primary, searchFor );
 
 		if( primary && !compareVal && IsDeleted( *headerFound ) )
 		{
@@ -275,6 +1478,8 @@ int Record::locateValue(
 			found = true;
 	}
 
+	dataFileHandle->countDescent( depth );
+
 	return compareVal;
 }
 
@@ -359,19 +1564,16 @@ void Record::setInsertMode( void )
 	}
 }
 
-void Record::readRecord( DbFile *dataFileHandle )
+/*
+	splits the values of a record buffer into the fields. cpData is
+	modified.
+*/
+void Record::loadValues( char *cpData, const char *cpLength )
 {
-	doEnterFunctionEx( gakLogging::llDetail, "Record::readRecord" );
-	char 	*cpLength, *cpData;
+	doEnterFunctionEx( gakLogging::llDetail, "Record::loadValues" );
 
 	size_t	lenData;
 
-	gak::Buffer<char>recBuffer( readRecordBuffer( dataFileHandle, m_theHeader.bufferLen, true ) );
-	gak::Buffer<char>lengthBuffer( readRecordBuffer( dataFileHandle, m_theHeader.stringLengths, true ) );
-
-	cpLength = lengthBuffer;
-	cpData = recBuffer;
-
 	for( size_t i=0; i<m_theHeader.numFields; i++ )
 	{
 		const char *end;
@@ -382,204 +1584,210 @@ void Record::readRecord( DbFile *dataFileHandle )
 		m_values[i].setStringValue( cpData );
 		m_values[i].backupValue();
 		cpData += lenData+1;
-		cpLength = const_cast<char*>(end)+1;
+		cpLength = end+1;
 	}
-
-	m_theRecMode = rmBrowse;
 }
 
-gak::int64 Record::rebalance( DbFile *dataFileHandle, gak::int64 curPos, RecordHeader &curHeader, gak::int64 prevPos, RecordHeader &prevHeader, bool cur2Small, bool prev2Small )
+bool Record::hasNumberFields() const
 {
-	RecordHeader	otherHeader;
-	// rebalance
-	bool higherIsPrev = (curHeader.higherRecordPtr == prevPos);
-	gak::int64	otherPos = higherIsPrev ? curHeader.lowerRecordPtr : curHeader.higherRecordPtr;
-	if( otherPos ) loadRecordHeader( otherPos, dataFileHandle, &otherHeader );
-
-	RecordHeader	tmpHeader;
-	gak::int64		tmpPos;
-
-	RecordHeader	rootHeader;
-	gak::int64		rootPos = curHeader.topPtr;
-	loadRecordHeader( rootPos, dataFileHandle, &rootHeader );
-
-	if( !higherIsPrev && cur2Small )
+	for( size_t i=0; i<m_theHeader.numFields; i++ )
 	{
-		//                cur(5)
-		//      PREV(3) <-      -> other(7)
-		// (2)<-     ->tmp(4)   (6)<-      ->(8)
-
-		//             PREV(3)
-		//        (2)<-        -> cur(5)
-		//                tmp(4)<-      -> other(7)
-		tmpPos = prevHeader.higherRecordPtr;
-		if(tmpPos) loadRecordHeader( tmpPos, dataFileHandle, &tmpHeader );
-
-		prevHeader.topPtr = curHeader.topPtr;
-		prevHeader.higherRecordPtr = curPos;
+		if( m_values[i].getType() == ftNumber )
+/***/		return true;
+	}
 
-		curHeader.topPtr = prevPos;
-		curHeader.lowerRecordPtr = tmpPos;
+	return false;
+}
 
-		prevHeader.numRecords -= tmpHeader.numRecords;
-		curHeader.numRecords = tmpHeader.numRecords + otherHeader.numRecords +1;
-		prevHeader.numRecords += curHeader.numRecords;
+/*
+	replaces the decimal numbers of an older file by ordered numbers
+*/
+void Record::convertDecimalNumbers()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::convertDecimalNumbers" );
 
-		tmpHeader.topPtr = curPos;
+	for( size_t i=0; i<m_theHeader.numFields; i++ )
+	{
+		FieldValue	&value = m_values[i];
 
-		if( rootHeader.lowerRecordPtr == curPos )
-			rootHeader.lowerRecordPtr = prevPos;
-		else
-			rootHeader.higherRecordPtr = prevPos;
+		if( value.getType() == ftNumber && !value.isNull() )
+		{
+			value.setDoubleValue( value.getStringValue().getValueN<double>() );
+			value.backupValue();
+		}
 	}
-	else if( !higherIsPrev && prev2Small )
-	{
-		//                 cur(5)
-		//      prev(3)<-          ->OTHER(7)
-		// (2)<-       ->(4)  tmp(6)<-      ->(8)
+}
 
+/*
+	copies the key of the current record, loadValues destroys the buffer
+*/
+void Record::rememberKey( const DbFile *dataFileHandle, const char *recBuffer )
+{
+	const std::size_t	keyLen = std::size_t(m_theHeader.bufferLen) - EOB_LEN;
 
-		//                        OTHER(7)
-		//                cur(5)<-        ->(8)
-		//      prev(3) <-      ->tmp(6)
-		// (2)<-       ->(4)
-		assert( otherPos );
-		tmpPos = otherHeader.lowerRecordPtr;
-		if(tmpPos) loadRecordHeader( tmpPos, dataFileHandle, &tmpHeader );
+	if( m_key.size() <= keyLen )
+		m_key.setSize( keyLen+1 );
 
-		otherHeader.topPtr = curHeader.topPtr;
-		otherHeader.lowerRecordPtr = curPos;
+	char	*key = m_key.getDataBuffer();
+	memcpy( key, recBuffer, keyLen );
+	key[keyLen] = 0;
+	m_keyGeneration = dataFileHandle->getChangeCount();
+}
 
-		curHeader.topPtr = otherPos;
-		curHeader.higherRecordPtr = tmpPos;
+/*
+	checks whether the current record is still the record we have read.
+	If another cursor has unlinked it or reused its space, we search the
+	neighbour of our key and return true. Otherwise we continue with the
+	current header of the record.
+*/
+bool Record::seekChangedRecord( DbFile *dataFileHandle, bool forward )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::seekChangedRecord" );
 
-		otherHeader.numRecords -= tmpHeader.numRecords;
-		curHeader.numRecords = prevHeader.numRecords + tmpHeader.numRecords + 1;
-		otherHeader.numRecords += curHeader.numRecords;
+	if( m_theRecMode != rmBrowse
+	|| m_keyGeneration == dataFileHandle->getChangeCount() )
+/***/	return false;
 
-		tmpHeader.topPtr = curPos;
+	const STRING	key = m_key.getDataBuffer();
+	RecordHeader	theHeader;
 
-		if( rootHeader.lowerRecordPtr == curPos )
-			rootHeader.lowerRecordPtr = otherPos;
-		else
-			rootHeader.higherRecordPtr = otherPos;
-	}
-	else if( higherIsPrev && prev2Small )
+	loadRecordHeader( m_theHeader.address, dataFileHandle, &theHeader );
+	if( !(theHeader.status & REC_FREE)
+	&& !compareRecordBuffer( dataFileHandle, theHeader, false, key, true ) )
 	{
-		//                  cur(5)
-		//      OTHER(3) <-       -> prev(7)
-		// (2)<-        ->tmp(4)  (6)<-     ->(8)
-
-		//      OTHER(3)
-		// (2)<-        ->cur(5)
-		//        tmp(4)<-      ->prev(7)
-		//                   (6)<-       ->(8)
-		assert( otherPos );
-		tmpPos = otherHeader.higherRecordPtr;
-		if(tmpPos) loadRecordHeader( tmpPos, dataFileHandle, &tmpHeader );
-
-		otherHeader.topPtr = curHeader.topPtr;
-		otherHeader.higherRecordPtr = curPos;
-
-		curHeader.topPtr = otherPos;
-		curHeader.lowerRecordPtr = tmpPos;
-
-		otherHeader.numRecords -= tmpHeader.numRecords;
-		curHeader.numRecords = tmpHeader.numRecords + prevHeader.numRecords +1;
-		otherHeader.numRecords += curHeader.numRecords;
-
-		tmpHeader.topPtr = curPos;
-
-		if( rootHeader.lowerRecordPtr == curPos )
-			rootHeader.lowerRecordPtr = otherPos;
-		else
-			rootHeader.higherRecordPtr = otherPos;
+		m_theHeader = theHeader;
+		m_keyGeneration = dataFileHandle->getChangeCount();
+/***/	return false;
 	}
-	else if( higherIsPrev && cur2Small )
-	{
-		//                cur(5)
-		//      other(3)<-      ->PREV(7)
-		// (2)<-        ->(4)  tmp(6)<-  ->(8)
-
-		//                        PREV(7)
-		//                cur(5)<-       ->(8)
-		//      other(3)<-      ->tmp(6)
-		// (2)<-        ->(4)
-
-		tmpPos = prevHeader.lowerRecordPtr;
-		if(tmpPos) loadRecordHeader( tmpPos, dataFileHandle, &tmpHeader );
 
-		prevHeader.topPtr = curHeader.topPtr;
-		prevHeader.lowerRecordPtr = curPos;
+	const KeyRange	range = m_range;
+	if( forward )
+		firstRecord( dataFileHandle, KeyRange( key, false, range.upper, range.upperInclusive ) );
+	else
+		lastRecord( dataFileHandle, KeyRange( range.lower, range.lowerInclusive, key, false ) );
+	m_range = range;
 
-		curHeader.topPtr = prevPos;
-		curHeader.higherRecordPtr = tmpPos;
+	return true;
+}
 
-		prevHeader.numRecords -= tmpHeader.numRecords;
-		curHeader.numRecords = otherHeader.numRecords + tmpHeader.numRecords +1;
-		prevHeader.numRecords += curHeader.numRecords;
+void Record::readRecord( DbFile *dataFileHandle )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::readRecord" );
 
-		tmpHeader.topPtr = curPos;
+	DbFile		*bufferFile = getBufferFile( dataFileHandle );
+	gak::int64	position = getBufferPosition( dataFileHandle, m_theHeader );
 
-		if( rootHeader.lowerRecordPtr == curPos )
-			rootHeader.lowerRecordPtr = prevPos;
-		else
-			rootHeader.higherRecordPtr = prevPos;
+	if( m_view )
+	{
+		m_view->load(
+			bufferFile, position,
+			std::size_t(m_theHeader.bufferLen), std::size_t(m_theHeader.stringLengths),
+			m_theHeader.numFields, !hasOrderedNumbers( dataFileHandle )
+		);
+		rememberKey( dataFileHandle, m_view->getData() );
+		m_theRecMode = rmBrowse;
+/***/	return;
 	}
 
-	updateRecordHeader( dataFileHandle, curHeader );
-	updateRecordHeader( dataFileHandle, prevHeader );
-
-	if(otherPos) updateRecordHeader( dataFileHandle, otherHeader );
-	if(tmpPos) updateRecordHeader( dataFileHandle, tmpHeader );
+	gak::Buffer<char>recBuffer( readRecordBuffer( bufferFile, position, m_theHeader.bufferLen, true ) );
+	gak::Buffer<char>lengthBuffer( readRecordBuffer( bufferFile, position + m_theHeader.bufferLen, m_theHeader.stringLengths, true ) );
 
-	rootHeader.numRecords++;
-	updateRecordHeader( dataFileHandle, rootHeader );
+	rememberKey( dataFileHandle, recBuffer );
+	loadValues( recBuffer, lengthBuffer );
+	if( !hasOrderedNumbers( dataFileHandle ) )
+		convertDecimalNumbers();
 
-	curHeader = rootHeader;
-	return rootPos;
+	m_theRecMode = rmBrowse;
 }
 
-void Record::postRecord( DbFile *dataFileHandle )
+void Record::postRecord( DbFile *dataFileHandle, double balanceAlpha )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Record::postRecord" );
+
 	STRING			theValues, theStringLengths;
 	int				compareVal = 0;
-	gak::int64		fileLength;
 
 	RecordHeader	curHeader;
 	gak::int64		curPos = 0;
 
 	// construct the record
 	getRecord( &theValues, false, &theStringLengths );
+	theStringLengths += ";EOB";
 
-	// find out position of best matching record
-	fileLength = dataFileHandle->toEnd() - TABLE_HEADER_SIZE;
+	// an empty tree gets the new record as its root
+	const gak::int64	rootPos = getRootPosition( dataFileHandle );
+
+	// find the space for the new record
+	const std::size_t	headerLength = getHeaderLength( dataFileHandle );
+	gak::uint64			capacity;
+
+	m_theHeader.bufferLen = strlen( theValues ) + NODE_ID_LEN + EOB_LEN;
+	m_theHeader.stringLengths = strlen( theStringLengths );
+	gak::int64 newPosition = allocateRecord(
+		dataFileHandle, getRecordSize( dataFileHandle, m_theHeader ), &capacity
+	);
 
 	// create the unique node id
-	theValues += gak::formatBinary(fileLength, 16, 16, '0');
+	theValues += gak::formatBinary(newPosition - TABLE_HEADER_SIZE, 16, NODE_ID_LEN, '0');
 
-	if( fileLength>0 )
+	// find out position of best matching record
+	if( rootPos )
 	{
-		curPos = TABLE_HEADER_SIZE;
+		curPos = rootPos;
 		compareVal = locateValue( dataFileHandle, &curPos, &curHeader, theValues, false );
 	}
+	else
+		setRootPosition( dataFileHandle, newPosition );
 
 	// now we can create the new record
-	gak::int64 newPosition = dataFileHandle->toEnd();
-
 	m_theHeader.address = newPosition;
 	m_theHeader.topPtr = curPos;
 	m_theHeader.lowerRecordPtr = m_theHeader.higherRecordPtr = 0; 
 	m_theHeader.numRecords = 1;
+	m_theHeader.status &= ~(REC_DELETED|REC_FREE);
+
+	/*
+		the new record becomes a leaf, so its neighbour in key order is
+		either its parent or the old neighbour of its parent
+	*/
+	m_theHeader.prevPtr = m_theHeader.nextPtr = 0;
+	gak::int64	neighbourPos = 0;
+	if( curPos && hasThreadLinks( dataFileHandle ) )
+	{
+		if( compareVal < 0 )
+		{
+			m_theHeader.prevPtr = curPos;
+			m_theHeader.nextPtr = neighbourPos = curHeader.nextPtr;
+			curHeader.nextPtr = newPosition;
+		}
+		else if( compareVal > 0 )
+		{
+			m_theHeader.nextPtr = curPos;
+			m_theHeader.prevPtr = neighbourPos = curHeader.prevPtr;
+			curHeader.prevPtr = newPosition;
+		}
+	}
 
-	theStringLengths += ";EOB";
 	theValues += ";EOB";
-	m_theHeader.stringLengths = strlen( theStringLengths );
-	m_theHeader.bufferLen = strlen( theValues );
-	writeRecordHeader( dataFileHandle, m_theHeader );
-	dataFileHandle->write( (void*)((const char *)theValues), m_theHeader.bufferLen );
-	dataFileHandle->write( (void*)((const char *)theStringLengths), m_theHeader.stringLengths );
+	assert( m_theHeader.bufferLen == strlen( theValues ) );
+	m_theHeader.setKeyPrefix( theValues );
+
+	// a reused record may be a little bit larger
+	if( !hasHeapFile( dataFileHandle ) )
+		m_theHeader.stringLengths = capacity - headerLength - m_theHeader.bufferLen;
+	writeRecord( dataFileHandle, &m_theHeader, theValues, theStringLengths );
+
+	if( neighbourPos )
+	{
+		RecordHeader	neighbourHeader;
+
+		loadRecordHeader( neighbourPos, dataFileHandle, &neighbourHeader );
+		if( compareVal < 0 )
+			neighbourHeader.prevPtr = newPosition;
+		else
+			neighbourHeader.nextPtr = newPosition;
+		updateRecordHeader( dataFileHandle, neighbourHeader );
+	}
 
 	// now we can insert the new record in our tree
 	if( curPos )
@@ -589,52 +1797,21 @@ void Record::postRecord( DbFile *dataFileHandle )
 		else if( compareVal > 0 )
 			curHeader.lowerRecordPtr = newPosition;
 		curHeader.numRecords++;
-
 		updateRecordHeader( dataFileHandle, curHeader );
-		gak::int64 prevSize = 1;
-		gak::int64 prevPos = curPos;
-		RecordHeader prevHeader = curHeader;
-		while( 1 )
-		{
-			curPos = curHeader.topPtr;
-			if( curPos > 0 )
-			{
-				loadRecordHeader( curPos, dataFileHandle, &curHeader );
-				gak::int64 curSize = ++curHeader.numRecords;
-
-				if( curHeader.topPtr > 0 )
-				{
-#if 1
-					// the current record is somewhere within the database
-					bool prev2Small = prevSize > 4 && prevSize*4 < curSize;
-					bool cur2Small = curSize > 4 && curSize/4 < prevSize;
 
-					if( prev2Small || cur2Small )
-					{
-						curPos = rebalance(dataFileHandle, curPos, curHeader, prevPos, prevHeader, cur2Small, prev2Small );
-						curSize = curHeader.numRecords;
-					}
-					else
-#endif
-					{
-						updateRecordHeader( dataFileHandle, curHeader );
-					}
-					prevSize = curSize;
-					prevPos = curPos;
-					prevHeader = curHeader;
-				}
-				else
-				{
-					// the current record is the root -> update the recordf then break;
-					updateRecordHeader( dataFileHandle, curHeader );
-					break;
-				}
-			}
-			else
-				break;
+		// all subtrees above the new record get larger
+		const gak::int64	parentPos = curPos;
+		for( curPos = curHeader.topPtr; curPos; curPos = curHeader.topPtr )
+		{
+			loadRecordHeader( curPos, dataFileHandle, &curHeader );
+			curHeader.numRecords++;
+			updateRecordHeader( dataFileHandle, curHeader );
 		}
+
+		rebalancePath( dataFileHandle, parentPos, balanceAlpha );
 	}
 
+	rememberKey( dataFileHandle, theValues );
 	m_theRecMode = rmBrowse;
 }
 
@@ -649,231 +1826,389 @@ void Record::backupValues( void )
 }
 
 
-void Record::deleteRecord( DbFile *dataFileHandle, bool noMove )
+void Record::deleteRecord( DbFile *dataFileHandle, double balanceAlpha, bool noMove )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Record::deleteRecord" );
 	SetDeleted( &m_theHeader );
 
 	updateRecordHeader( dataFileHandle, m_theHeader );
 
+	const gak::int64	deletedPos = m_theHeader.address;
+	const bool			unlink = hasFreeSpaceMap( dataFileHandle )
+		&& (m_theHeader.topPtr || hasRootLink( dataFileHandle ));
+
 	if( !noMove )
 	{
-		nextRecord( dataFileHandle );
+		stepNext( dataFileHandle );
 		if( m_theRecMode == rmEof )
-			prevRecord( dataFileHandle );
+			stepPrev( dataFileHandle );
 	}
 	else
 		ClrDeleted( &m_theHeader );
+
+	/*
+		the root record of older files remains in the tree, all others are
+		unlinked and can be reused
+	*/
+	if( unlink )
+	{
+		rebalancePath( dataFileHandle, unlinkRecord( dataFileHandle, deletedPos ), balanceAlpha );
+		freeRecord( dataFileHandle, deletedPos );
+
+		if( !noMove && m_theHeader.address && m_theHeader.address != deletedPos )
+			loadRecordHeader( m_theHeader.address, dataFileHandle, &m_theHeader );
+	}
 }
 
 void Record::root( DbFile *dataFileHandle )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Record::firstRecord" );
-	gak::int64 fileLength = dataFileHandle->toEnd()-TABLE_HEADER_SIZE;
-	if( fileLength<=0 )
+	const gak::int64 rootPos = getRootPosition( dataFileHandle );
+	invalidatePath();
+	if( !rootPos )
 		m_theRecMode = rmEof;
 	else
 	{
-		loadRecordHeader( TABLE_HEADER_SIZE, dataFileHandle, &m_theHeader );
+		loadRecordHeader( rootPos, dataFileHandle, &m_theHeader );
+		setPathValid( dataFileHandle );
 	}
 }
 
-void Record::firstRecord( DbFile *dataFileHandle, const STRING &searchBuffer )
+void Record::firstRecord( DbFile *dataFileHandle, const KeyRange &range )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Record::firstRecord" );
-	m_searchBuffer = searchBuffer;
-	gak::int64 fileLength = dataFileHandle->toEnd()-TABLE_HEADER_SIZE;
-	if( fileLength<=0 )
+	m_range = range;
+	const gak::int64 rootPos = getRootPosition( dataFileHandle );
+	invalidatePath();
+	if( !rootPos )
 		m_theRecMode = rmEof;
 	else
 	{
-		gak::int64 currentPosition = TABLE_HEADER_SIZE;
-		while( true )
+		gak::int64 currentPosition = locateBound(
+			dataFileHandle, rootPos, range.lower,
+			false, range.lowerInclusive, &m_path
+		);
+		if( !currentPosition )
 		{
-			loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+			m_theRecMode = rmEof;
+/***/		return;
+		}
 
-			if( m_theHeader.lowerRecordPtr )
-				currentPosition = m_theHeader.lowerRecordPtr;
-			else if( !IsDeleted( m_theHeader ) )
-			{
-				readRecord( dataFileHandle );
-				if( searchBuffer[0U] )
-				{
-					STRING theValues;
-					getRecord( &theValues, false, NULL );
-					if( strncmp( theValues, searchBuffer, strlen( searchBuffer ) ) )
-						nextRecord( dataFileHandle );
-				}
-				break;
-			}
-			else
-			{
-				nextRecord( dataFileHandle );
-				break;
-			}
+		loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+		setPathValid( dataFileHandle );
+		if( skipDeleted( dataFileHandle, m_theHeader ) )
+			stepNext( dataFileHandle );
+		else
+		{
+			readRecord( dataFileHandle );
+			if( !isBelowUpper() )
+				m_theRecMode = rmEof;
 		}
 	}
 }
 
+/*
+	compares the current record with the prefix key like strncmp
+*/
+int Record::compareValues( const STRING &key )
+{
+	if( m_view )
+/***/	return m_view->compareValues( key );
+
+	STRING theValues;
+	getRecord( &theValues, false, NULL );
+	return strncmp( theValues, key, strlen( key ) );
+}
+
+/*
+	checks the bounds of the cursor loop
+*/
+bool Record::isBelowUpper()
+{
+	if( !m_range.upper[0U] )
+/***/	return true;
+
+	int compareVal = compareValues( m_range.upper );
+	return m_range.upperInclusive ? compareVal <= 0 : compareVal < 0;
+}
+
+bool Record::isAboveLower()
+{
+	if( !m_range.lower[0U] )
+/***/	return true;
+
+	int compareVal = compareValues( m_range.lower );
+	return m_range.lowerInclusive ? compareVal >= 0 : compareVal > 0;
+}
+
 void Record::nextRecord( DbFile *dataFileHandle )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Record::nextRecord" );
+
+	if( !seekChangedRecord( dataFileHandle, true ) )
+		stepNext( dataFileHandle );
+}
+
+void Record::stepNext( DbFile *dataFileHandle )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::stepNext" );
 	gak::int64	oldPosition;
 	bool		found;
 	gak::int64	currentPosition = m_theHeader.address;
-	do
-	{
-		found = false;
 
-		if( m_theHeader.higherRecordPtr )
+	// threaded files need one header per record
+	if( hasThreadLinks( dataFileHandle ) )
+	{
+		invalidatePath();
+		do
+		{
+			currentPosition = m_theHeader.nextPtr;
+			if( currentPosition )
+				loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+		} while( currentPosition && skipDeleted( dataFileHandle, m_theHeader ) );
+	}
+	else if( hasValidPath( dataFileHandle ) )
+	{
+		do
 		{
-			/*
-				if there is a higher record, we walk to this record and
-				then go to the lowes possible record from here
-			*/
-			currentPosition = m_theHeader.higherRecordPtr;
-			loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
-			while( m_theHeader.lowerRecordPtr )
+			if( m_theHeader.higherRecordPtr )
 			{
-				currentPosition = m_theHeader.lowerRecordPtr;
+				// go to the lowest record of the higher subtree
+				m_path.addElement( m_theHeader );
+				currentPosition = m_theHeader.higherRecordPtr;
 				loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+				while( m_theHeader.lowerRecordPtr )
+				{
+					m_path.addElement( m_theHeader );
+					currentPosition = m_theHeader.lowerRecordPtr;
+					loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+				}
 			}
-			found = true;	// whe have found a possible record
-		}
-		else
-		{
-			/*
-				walk through top pointer until next higherPointer
-				does not point to myself
-			*/
-			while( !found )
+			else
 			{
+				// the first ancestor, we reach from its lower subtree
 				oldPosition = currentPosition;
-				currentPosition = m_theHeader.topPtr;
-				if( !currentPosition )
-/*v*/				break;					// the end no more data
+				currentPosition = 0;
+				while( m_path.size() )
+				{
+					m_theHeader = m_path[m_path.size()-1];
+					m_path.removeElementAt( m_path.size()-1 );
+					if( m_theHeader.higherRecordPtr != oldPosition )
+					{
+						currentPosition = m_theHeader.address;
+/*v*/					break;
+					}
+					oldPosition = m_theHeader.address;
+				}
+			}
+		} while( currentPosition && skipDeleted( dataFileHandle, m_theHeader ) );
+	}
+	else
+	{
+		invalidatePath();
+		do
+		{
+			found = false;
 
+			if( m_theHeader.higherRecordPtr )
+			{
+				/*
+					if there is a higher record, we walk to this record and
+					then go to the lowes possible record from here
+				*/
+				currentPosition = m_theHeader.higherRecordPtr;
 				loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+				while( m_theHeader.lowerRecordPtr )
+				{
+					currentPosition = m_theHeader.lowerRecordPtr;
+					loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+				}
+				found = true;	// whe have found a possible record
+			}
+			else
+			{
+				/*
+					walk through top pointer until next higherPointer
+					does not point to myself
+				*/
+				while( !found )
+				{
+					oldPosition = currentPosition;
+					currentPosition = m_theHeader.topPtr;
+					if( !currentPosition )
+/*v*/					break;					// the end no more data
 
-				if( m_theHeader.higherRecordPtr == oldPosition )
-/*^*/				continue;				// go to next top node
-				else
-					found = true;			// may be this is not deleted
+					loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+
+					if( m_theHeader.higherRecordPtr == oldPosition )
+/*^*/					continue;				// go to next top node
+					else
+						found = true;			// may be this is not deleted
+				}
 			}
-		}
-	} while( (!found || IsDeleted( m_theHeader )) && currentPosition );
+		} while( (!found || skipDeleted( dataFileHandle, m_theHeader )) && currentPosition );
+	}
 
 	if( !currentPosition )
 		m_theRecMode = rmEof;
 	else
 	{
 		readRecord( dataFileHandle );
-		if( m_searchBuffer[0U] )
-		{
-			STRING theValues;
-			getRecord( &theValues, false, NULL );
-			if( strncmp( theValues, m_searchBuffer, strlen( m_searchBuffer ) ) )
-				nextRecord( dataFileHandle );			/// TODO avoid recursive call
-		}
+
+		// the loop ends with the first record behind the range
+		if( !isBelowUpper() )
+			m_theRecMode = rmEof;
 	}
 }
 
 void Record::prevRecord( DbFile *dataFileHandle )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Record::prevRecord" );
+
+	if( !seekChangedRecord( dataFileHandle, false ) )
+		stepPrev( dataFileHandle );
+}
+
+void Record::stepPrev( DbFile *dataFileHandle )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Record::stepPrev" );
 	bool	found;
 	gak::int64	currentPosition = m_theHeader.address;
-	do
-	{
-		found = false;
 
-		if( m_theHeader.lowerRecordPtr )
+	// threaded files need one header per record
+	if( hasThreadLinks( dataFileHandle ) )
+	{
+		invalidatePath();
+		do
+		{
+			currentPosition = m_theHeader.prevPtr;
+			if( currentPosition )
+				loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+		} while( currentPosition && skipDeleted( dataFileHandle, m_theHeader ) );
+	}
+	else if( hasValidPath( dataFileHandle ) )
+	{
+		do
 		{
-			/*
-				if there is a lower record, we walk to this record and
-				then go to the highest possible record from here
-			*/
-			currentPosition = m_theHeader.lowerRecordPtr;
-			loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
-			while( m_theHeader.higherRecordPtr )
+			if( m_theHeader.lowerRecordPtr )
 			{
-				currentPosition = m_theHeader.higherRecordPtr;
+				// go to the highest record of the lower subtree
+				m_path.addElement( m_theHeader );
+				currentPosition = m_theHeader.lowerRecordPtr;
 				loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+				while( m_theHeader.higherRecordPtr )
+				{
+					m_path.addElement( m_theHeader );
+					currentPosition = m_theHeader.higherRecordPtr;
+					loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+				}
 			}
-			found = true;
-		}
-		else
-		{
-			/*
-				walk through top pointer until next higherPointer
-				does not point to myself
-			*/
-			while( !found )
+			else
 			{
+				// the first ancestor, we reach from its higher subtree
 				gak::int64	oldPosition = currentPosition;
-				currentPosition = m_theHeader.topPtr;
-
-				if( !currentPosition )
-/*v*/				break;					// the end no more data
+				currentPosition = 0;
+				while( m_path.size() )
+				{
+					m_theHeader = m_path[m_path.size()-1];
+					m_path.removeElementAt( m_path.size()-1 );
+					if( m_theHeader.lowerRecordPtr != oldPosition )
+					{
+						currentPosition = m_theHeader.address;
+/*v*/					break;
+					}
+					oldPosition = m_theHeader.address;
+				}
+			}
+		} while( currentPosition && skipDeleted( dataFileHandle, m_theHeader ) );
+	}
+	else
+	{
+		invalidatePath();
+		do
+		{
+			found = false;
 
+			if( m_theHeader.lowerRecordPtr )
+			{
+				/*
+					if there is a lower record, we walk to this record and
+					then go to the highest possible record from here
+				*/
+				currentPosition = m_theHeader.lowerRecordPtr;
 				loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+				while( m_theHeader.higherRecordPtr )
+				{
+					currentPosition = m_theHeader.higherRecordPtr;
+					loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+				}
+				found = true;
+			}
+			else
+			{
+				/*
+					walk through top pointer until next higherPointer
+					does not point to myself
+				*/
+				while( !found )
+				{
+					gak::int64	oldPosition = currentPosition;
+					currentPosition = m_theHeader.topPtr;
+
+					if( !currentPosition )
+/*v*/					break;					// the end no more data
 
-				if( m_theHeader.lowerRecordPtr == oldPosition )
-/*^*/				continue;				// go to next top node
-				else
-					found = true;			// may be this is not deleted
+					loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+
+					if( m_theHeader.lowerRecordPtr == oldPosition )
+/*^*/					continue;				// go to next top node
+					else
+						found = true;			// may be this is not deleted
+				}
 			}
-		}
-	} while( (!found || IsDeleted( m_theHeader )) && currentPosition );
+		} while( (!found || skipDeleted( dataFileHandle, m_theHeader )) && currentPosition );
+	}
 
 	if( !currentPosition )
 		m_theRecMode = rmBof;
 	else
 	{
 		readRecord( dataFileHandle );
-		if( m_searchBuffer[0U] )
-		{
-			STRING theValues;
-			getRecord( &theValues, false, NULL );
-			if( strncmp( theValues, m_searchBuffer, strlen( m_searchBuffer ) ) )
-				prevRecord( dataFileHandle );	/// TODO avoid recursion
-		}
+
+		if( !isAboveLower() )
+			m_theRecMode = rmBof;
 	}
 }
 
-void Record::lastRecord( DbFile *dataFileHandle, const STRING &searchBuffer )
+void Record::lastRecord( DbFile *dataFileHandle, const KeyRange &range )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Record::lastRecord" );
-	m_searchBuffer = searchBuffer;
-	gak::int64 fileLength = dataFileHandle->toEnd()-TABLE_HEADER_SIZE;	// table header
-	if( !fileLength )
+	m_range = range;
+	const gak::int64 rootPos = getRootPosition( dataFileHandle );
+	invalidatePath();
+	if( !rootPos )
 		m_theRecMode = rmBof;
 	else
 	{
-		gak::int64	currentPosition = TABLE_HEADER_SIZE;
-		while( true )
+		gak::int64	currentPosition = locateBound(
+			dataFileHandle, rootPos, range.upper,
+			true, range.upperInclusive, &m_path
+		);
+		if( !currentPosition )
 		{
-			loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+			m_theRecMode = rmBof;
+/***/		return;
+		}
 
-			if( m_theHeader.higherRecordPtr )
-				currentPosition = m_theHeader.higherRecordPtr;
-			else if( !IsDeleted( m_theHeader ) )
-			{
-				readRecord( dataFileHandle );
-				if( searchBuffer[0U] )
-				{
-					STRING theValues;
-					getRecord( &theValues, false, NULL );
-					if( strncmp( theValues, searchBuffer, strlen( searchBuffer ) ) )
-						prevRecord( dataFileHandle );
-				}
-				break;
-			}
-			else
-			{
-				prevRecord( dataFileHandle );
-				break;
-			}
+		loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
+		setPathValid( dataFileHandle );
+		if( skipDeleted( dataFileHandle, m_theHeader ) )
+			stepPrev( dataFileHandle );
+		else
+		{
+			readRecord( dataFileHandle );
+			if( !isAboveLower() )
+				m_theRecMode = rmBof;
 		}
 	}
 }
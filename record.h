@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			record.h
 		Description:	The definitions for one table record
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -43,9 +43,11 @@
 #include <stdlib.h>
 
 #include <gak/types.h>
+#include <gak/array.h>
 
 #include "fieldvalue.h"
 #include "db_file_io.h"
+#include "db_record_view.h"
 
 // --------------------------------------------------------------------- //
 // ----- imported datas ------------------------------------------------ //
@@ -66,6 +68,9 @@
 #	endif
 #endif
 
+// the unit test in dblib.cpp
+class MydbUnitTest;
+
 namespace dbLib
 {
 
@@ -75,6 +80,29 @@ namespace dbLib
 
 #define REC_DELETED		1
 #define REC_LOCKED		2
+#define REC_FREE		4		// unlinked from the tree, in a free list
+
+/*
+	every record buffer ends with a unique node id and ";EOB"
+*/
+static const int	NODE_ID_LEN = 16;
+static const int	EOB_LEN = 4;
+
+/*
+	since fvKeyPrefix the header contains the first bytes of the record
+	buffer, so that most comparisons do not need to read the buffer
+*/
+static const size_t	KEY_PREFIX_LEN = 16;
+
+/*
+	the trees are BB[alpha] balanced: each subtree of a record keeps at
+	least alpha of its weight. The rotations restore the balance for
+	alpha above 2/11 and up to 1-sqrt(2)/2 only, the definitions store
+	it in thousandths.
+*/
+static const double	MIN_BALANCE_ALPHA = 0.19;
+static const double	MAX_BALANCE_ALPHA = 0.29;
+static const double	DEFAULT_BALANCE_ALPHA = 0.25;
 
 // --------------------------------------------------------------------- //
 // ----- macros -------------------------------------------------------- //
@@ -99,9 +127,12 @@ struct RecordHeader
 	gak::int64		topPtr;								// parent record
 	gak::int64		lowerRecordPtr, higherRecordPtr;	// lower/higher records
 	gak::int64		numRecords;							// number of records in this subtree (incl current)
+	gak::int64		prevPtr, nextPtr;					// neighbours in key order (fvThreaded)
 	std::size_t		numFields;
 	gak::uint64		stringLengths, primaryLen, bufferLen;
 	gak::int32		status;
+	char			keyPrefix[KEY_PREFIX_LEN];			// start of the buffer (fvKeyPrefix)
+	gak::int64		heapPos;							// the buffer in the heap file (fvSplitHeap)
 
 	RecordHeader()
 	{
@@ -114,9 +145,42 @@ struct RecordHeader
 		memset( this, 0, sizeof( *this ) );
 		numFields = i;
 	}
+	void setKeyPrefix( const char *recBuffer )
+	{
+		const size_t	prefixLen = bufferLen < KEY_PREFIX_LEN ? size_t(bufferLen) : KEY_PREFIX_LEN;
+
+		memset( keyPrefix, 0, sizeof( keyPrefix ) );
+		memcpy( keyPrefix, recBuffer, prefixLen );
+	}
+};
+
+/*
+	the keys of a cursor loop. The bounds are compared as prefixes, so an
+	inclusive bound accepts all records starting with it. An empty bound
+	is unlimited.
+*/
+struct KeyRange
+{
+	gak::STRING		lower, upper;
+	bool			lowerInclusive, upperInclusive;
 
+	KeyRange(
+		const gak::STRING &lower="", bool lowerInclusive=true,
+		const gak::STRING &upper="", bool upperInclusive=true
+	)
+	{
+		this->lower = lower;
+		this->upper = upper;
+		this->lowerInclusive = lowerInclusive;
+		this->upperInclusive = upperInclusive;
+	}
 };
 
+/*
+	the headers of all ancestors of a record, the root first
+*/
+typedef gak::Array<RecordHeader>	RecordPath;
+
 // --------------------------------------------------------------------- //
 // ----- class definitions --------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -125,18 +189,48 @@ class Record
 {
 	friend class Index;
 	friend class Table;
+	friend class Compactor;
+	friend class BulkLoader;
+	friend class TreeAnalyzer;
+	friend class BTree;
 
 	private:
-	gak::STRING		m_searchBuffer;
+	KeyRange		m_range;
 	RecordHeader	m_theHeader;
 	long			m_nodeId;
 	FieldValue		*m_values;
 	RecordMode		m_theRecMode;
 
+	/*
+		the cursor remembers the ancestors of the current record, so that
+		stepping does not need to reload them. Any write to the file makes
+		the path invalid.
+	*/
+	RecordPath		m_path;
+	gak::uint64		m_pathGeneration;
+	bool			m_pathValid;
+
+	/*
+		the buffer of the current record without ";EOB". If another cursor
+		has unlinked the record or reused its space, we find our position
+		again with this key.
+	*/
+	gak::Array<char>	m_key;
+	gak::uint64		m_keyGeneration;
+
+	/*
+		with a view the cursor does not load the values into m_values
+	*/
+	RecordView		*m_view;
+
 	Record()
 	{
 		m_theRecMode = rmInsert;
 		m_values = NULL;
+		m_pathGeneration = 0;
+		m_pathValid = false;
+		m_keyGeneration = 0;
+		m_view = NULL;
 	}
 	~Record()
 	{
@@ -147,34 +241,125 @@ class Record
 	}
 
 	static void readRecordHeader(
-		DbFile *dataFileHandle, RecordHeader *theHeader
+		DbFile *dataFileHandle, gak::int64 position, RecordHeader *theHeader
 	);
 	static void writeRecordHeader(
-		DbFile *dataFileHandle, const RecordHeader &theHeader
+		DbFile *dataFileHandle, gak::int64 position, const RecordHeader &theHeader
 	);
 	static void loadRecordHeader(
-		gak::uint64 pos, DbFile *dataFileHandle, RecordHeader *theHeader
+		gak::int64 pos, DbFile *dataFileHandle, RecordHeader *theHeader
 	)
 	{
-		dataFileHandle->seek( pos );
-		readRecordHeader( dataFileHandle, theHeader );
+		readRecordHeader( dataFileHandle, pos, theHeader );
 		theHeader->address = pos;
 	}
 	static void updateRecordHeader(
 		DbFile *dataFileHandle, const RecordHeader &theHeader
 	)
 	{
-		dataFileHandle->seek( theHeader.address );
-		writeRecordHeader( dataFileHandle, theHeader );
+		writeRecordHeader( dataFileHandle, theHeader.address, theHeader );
 	}
-	static char *Record::readRecordBuffer(
-		DbFile *dataFileHandle, gak::int64 length, bool primary
+	/*
+		with fvSplitHeap the data file contains the record headers only,
+		the buffers are appended to the heap file
+	*/
+	static bool hasHeapFile( const DbFile *dataFileHandle );
+	static DbFile *getBufferFile( DbFile *dataFileHandle )
+	{
+		return hasHeapFile( dataFileHandle ) ? dataFileHandle->getHeapFile() : dataFileHandle;
+	}
+	static gak::int64 getBufferPosition(
+		const DbFile *dataFileHandle, const RecordHeader &theHeader
+	);
+	static gak::uint64 getRecordSize(
+		const DbFile *dataFileHandle, const RecordHeader &theHeader
+	);
+	static void writeRecord(
+		DbFile *dataFileHandle, RecordHeader *theHeader,
+		const char *theValues, const char *theStringLengths
+	);
+
+	static char *readRecordBuffer(
+		DbFile *dataFileHandle, gak::int64 position, gak::int64 length, bool primary
+	);
+	static char *readRecordBuffer(
+		DbFile *dataFileHandle, const RecordHeader &theHeader, gak::int64 length, bool primary
+	)
+	{
+		return readRecordBuffer(
+			getBufferFile( dataFileHandle ), getBufferPosition( dataFileHandle, theHeader ),
+			length, primary
+		);
+	}
+	static int compareRecordBuffer(
+		DbFile *dataFileHandle, const RecordHeader &theHeader, bool primary,
+		const gak::STRING &searchFor, bool prefixOnly=false
+	);
+	static gak::int64 locatePrefix(
+		DbFile *dataFileHandle, gak::int64 position, const gak::STRING &prefix
+	);
+
+	/*
+		order statistics based on the subtree sizes in numRecords.
+		Ranks are 0 based and count live records only. Files older than
+		fvFreeSpace keep their deleted records in the tree, there the
+		counts need a walk through the subtrees.
+	*/
+	static gak::int64 locateBound(
+		DbFile *dataFileHandle, gak::int64 position,
+		const gak::STRING &key, bool upper, bool inclusive, RecordPath *path
+	);
+	static gak::int64 getLowerCount(
+		DbFile *dataFileHandle, const RecordHeader &theHeader
+	);
+	static gak::int64 getSubtreeSize( DbFile *dataFileHandle, gak::int64 position );
+	static gak::int64 getLiveCount( DbFile *dataFileHandle, gak::int64 position );
+	static gak::int64 locateRank(
+		DbFile *dataFileHandle, gak::int64 rootPos, gak::int64 rank
+	);
+	static gak::int64 getRank( DbFile *dataFileHandle, gak::int64 position );
+	static gak::int64 countLess(
+		DbFile *dataFileHandle, gak::int64 rootPos,
+		const gak::STRING &searchFor, bool orEqual
+	);
+	/*
+		since fvRootLink the table header contains the position of the
+		root, so the root can be removed like any other record
+	*/
+	static bool hasRootLink( const DbFile *dataFileHandle );
+	static bool hasOrderedNumbers( const DbFile *dataFileHandle );
+	static gak::int64 getRootPosition( DbFile *dataFileHandle );
+	static void setRootPosition( DbFile *dataFileHandle, gak::int64 position );
+
+	static gak::int64 rotateRecord( DbFile *dataFileHandle, gak::int64 position, bool lowerUp );
+	static gak::int64 rebalanceRecord(
+		DbFile *dataFileHandle, gak::int64 position, double balanceAlpha
+	);
+	static void rebalancePath(
+		DbFile *dataFileHandle, gak::int64 position, double balanceAlpha
+	);
+	static gak::int64 unlinkRecord( DbFile *dataFileHandle, gak::int64 position );
+	static void freeRecord( DbFile *dataFileHandle, gak::int64 position );
+	static gak::int64 allocateRecord(
+		DbFile *dataFileHandle, gak::uint64 size, gak::uint64 *capacity
 	);
 	static int locateValue(
 		DbFile *dataFileHandle,
 		gak::int64 *posFound, RecordHeader *headerFound,
 		const gak::STRING &searchFor, bool primarySearch
 	);
+	static void convertFile( DbFile *source, DbFile *target, double balanceAlpha );
+	static void threadRecords( DbFile *dataFileHandle );
+
+	/*
+		balanced trees written in one pass: the root is the first record,
+		all others follow in key order
+	*/
+	static void layoutBalancedTree( gak::Array<gak::int64> *positions, gak::int64 rootPos );
+	static void getBalancedLinks(
+		const gak::Array<gak::int64> &positions, size_t recordIdx,
+		RecordHeader *theHeader
+	);
 
 	void getRecord( gak::STRING *theValues, bool primary, gak::STRING *theStringLengths );
 
@@ -185,26 +370,75 @@ class Record
 	{
 		return m_values+fieldIdx;
 	}
+	void loadValues( char *cpData, const char *cpLength );
+	bool hasNumberFields() const;
+	void convertDecimalNumbers();
 	void readRecord( DbFile *dataFileHandle );
+	void rememberKey( const DbFile *dataFileHandle, const char *recBuffer );
+	bool seekChangedRecord( DbFile *dataFileHandle, bool forward );
+	void stepNext( DbFile *dataFileHandle );
+	void stepPrev( DbFile *dataFileHandle );
 	void readRecord( DbFile *dataFileHandle, gak::int64 currentPosition )
 	{
+		invalidatePath();
 		loadRecordHeader( currentPosition, dataFileHandle, &m_theHeader );
 		readRecord( dataFileHandle );
 	}
 
-	gak::int64 rebalance( DbFile *dataFileHandle, gak::int64 curPos, RecordHeader &curHeader, gak::int64 prevPos, RecordHeader &prevHeader, bool cur2Small, bool prev2Small );
+	int compareValues( const gak::STRING &key );
+	bool isBelowUpper();
+	bool isAboveLower();
 
-	void postRecord( DbFile *dataFileHandle );
-	void deleteRecord( DbFile *dataFileHandle, bool noMove=false );
+	void invalidatePath()
+	{
+		m_pathValid = false;
+		m_path.clear();
+	}
+	void setPathValid( const DbFile *dataFileHandle )
+	{
+		m_pathValid = true;
+		m_pathGeneration = dataFileHandle->getChangeCount();
+	}
+	void setView( RecordView *view )
+	{
+		releaseView();
+		m_view = view;
+	}
+	void releaseView()
+	{
+		if( m_view )
+			m_view->release();
+	}
+	RecordView *getView() const
+	{
+		return m_view;
+	}
+
+	bool hasValidPath( const DbFile *dataFileHandle ) const
+	{
+		return m_pathValid && m_pathGeneration == dataFileHandle->getChangeCount();
+	}
+
+
+	void postRecord( DbFile *dataFileHandle, double balanceAlpha );
+	void deleteRecord( DbFile *dataFileHandle, double balanceAlpha, bool noMove=false );
 	void root( DbFile *dataFileHandle );
 
 	/*
 	 * cursor loop
 	 */
-	void firstRecord( DbFile *dataFileHandle, const gak::STRING &searchBuffer="" );
+	void firstRecord( DbFile *dataFileHandle, const gak::STRING &searchBuffer="" )
+	{
+		firstRecord( dataFileHandle, KeyRange( searchBuffer, true, searchBuffer, true ) );
+	}
+	void firstRecord( DbFile *dataFileHandle, const KeyRange &range );
 	void nextRecord( DbFile *dataFileHandle );
 	void prevRecord( DbFile *dataFileHandle );
-	void lastRecord( DbFile *dataFileHandle, const gak::STRING &searchBuffer="" );
+	void lastRecord( DbFile *dataFileHandle, const gak::STRING &searchBuffer="" )
+	{
+		lastRecord( dataFileHandle, KeyRange( searchBuffer, true, searchBuffer, true ) );
+	}
+	void lastRecord( DbFile *dataFileHandle, const KeyRange &range );
 	bool bof( void ) const
 	{
 		return m_theRecMode == rmBof;
@@ -222,7 +456,8 @@ class Record
 	}
 
 	public:
-	friend class MydbUnitTest;
+	friend class ::MydbUnitTest;
+	static size_t getHeaderLength( const DbFile *dataFileHandle );
 	const RecordHeader &getHeader() const
 	{
 		return m_theHeader;
@@ -268,6 +503,11 @@ inline void ClrDeleted( RecordHeader *header )
 	header->status &= ~REC_DELETED;
 }
 
+inline bool IsFree( const RecordHeader &header )
+{
+	return header.status & REC_FREE;
+}
+
 
 // --------------------------------------------------------------------- //
 // ----- class constructors/destructors -------------------------------- //
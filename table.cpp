@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			table.cpp
 		Description:	The definition for the entire table
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -118,6 +118,7 @@ using gak::xml::Element;
 
 Table::~Table()
 {
+	setRecordView( NULL );
 	for( size_t i=0; i<m_indices.size(); i++ )
 		delete m_indices[i];
 }
@@ -176,6 +177,17 @@ Index *Table::findIndexFromPath( const STRING &indexPath ) const
 	return NULL;
 }
 
+/*
+	nothing may be changed, before the table and all indices can store
+	ordered numbers
+*/
+void Table::checkNumberFormats() const
+{
+	checkNumberFormat();
+	for( size_t i=0; i<m_indices.size(); i++ )
+		m_indices[i]->checkNumberFormat();
+}
+
 void Table::checkKeyViolation(Index *theIndex)
 {
 	STRING		key;
@@ -292,6 +304,21 @@ void Table::addField(
 void Table::postRecord()
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Table::postRecord" );
+
+	// views are for read only scans
+	if( m_view )
+		throw DBviewReadOnly( getPathName() );
+
+	// the keys are checked, when the bulk load is complete
+	if( isBulkLoading() )
+	{
+		Index::postRecord();
+/***/	return;
+	}
+
+	checkNumberFormats();
+	Transaction	transaction( m_wal );
+
 	/*
 		check for primary keys
 	*/
@@ -331,13 +358,14 @@ void Table::postRecord()
 		deleteRecord( true );
 	}
 
-	m_currentRecord.postRecord( m_dataFileHandle );
+	m_currentRecord.postRecord( m_dataFileHandle, getBalanceAlpha() );
 
 	for( size_t i=0; i<numIndices; i++ )
 	{
 		Index		*theIndex = m_indices[i];
 		insertKeyRecord(theIndex);
 	}
+	transaction.commit();
 
 	// if we have survived the post, backup the values
 	m_currentRecord.backupValues();
@@ -348,6 +376,12 @@ void Table::deleteRecord( bool noMove )
 	doEnterFunctionEx( gakLogging::llDetail, "Table::deleteRecord" );
 	STRING		searchBuffer;
 
+	if( m_view )
+		throw DBviewReadOnly( getPathName() );
+
+	checkNumberFormats();
+	Transaction	transaction( m_wal );
+
 	for( size_t i=0; i<m_indices.size(); i++ )
 	{
 		Index		*theIndex = m_indices[i];
@@ -362,38 +396,198 @@ void Table::deleteRecord( bool noMove )
 			searchBuffer += ';';
 		}
 
-		searchBuffer += gak::formatNumber(m_currentRecord.getCurrentPosition());
+		// the record position is stored like an integer field
+		searchBuffer += FieldValue::convertFieldType<long>( long(m_currentRecord.getCurrentPosition()) );
+
+		if( theIndex->locateEntry( searchBuffer ) )
+			theIndex->deleteRecord( true );
+	}
+
+	m_currentRecord.deleteRecord( m_dataFileHandle, getBalanceAlpha(), noMove );
+	transaction.commit();
+}
+
+/*
+	converts the table and its indices to the current file format. The
+	indices are rebuilt, because the record positions may change.
+*/
+void Table::convertFormat()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::convertFormat" );
+
+	bool	tableConverted = !isCurrentFormat();
+	Index	*currentIndex = m_currentIndex;
+
+	checkpointLog();
+	Index::convertFormat();
+
+	m_currentIndex = NULL;
+	try
+	{
+		for( size_t i=0; i<m_indices.size(); i++ )
+		{
+			Index	*theIndex = m_indices[i];
+			if( tableConverted || !theIndex->isCurrentFormat() )
+				refreshIndex( theIndex );
+		}
+	}
+	catch( ... )
+	{
+		m_currentIndex = currentIndex;
+		throw;
+	}
+	m_currentIndex = currentIndex;
+}
+
+/*
+	compacts the data file and all indices. The indices contain the
+	positions of the table records, so they are compacted after the table
+	with the new positions. B+tree indices are rebuilt from the compacted
+	table. Only the final swap of the files must not be interrupted by
+	writers. Returns true, when the compaction is complete.
+*/
+bool Table::compactStep( size_t maxRecords )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::compactStep" );
+
+	bool	valid = isCompactionValid();
+	for( size_t i=0; valid && i<m_indices.size(); i++ )
+		valid = m_indices[i]->isCompactionValid();
+
+	// the table has been changed, start again
+	if( !valid )
+	{
+		for( size_t i=0; i<m_indices.size(); i++ )
+			m_indices[i]->cancelCompaction();
+		cancelCompaction();
+	}
+
+	if( !Index::compactStep( maxRecords ) )
+/***/	return false;
+
+	for( size_t i=0; i<m_indices.size(); i++ )
+	{
+		if( !m_indices[i]->isBTree() && !m_indices[i]->compactStep( maxRecords, m_compactor ) )
+/***/		return false;
+	}
+
+	checkpointLog();
+	Index::finishCompaction();
+	for( size_t i=0; i<m_indices.size(); i++ )
+		m_indices[i]->finishCompaction();
+
+	Index	*currentIndex = m_currentIndex;
+
+	m_currentIndex = NULL;
+	try
+	{
+		for( size_t i=0; i<m_indices.size(); i++ )
+		{
+			if( m_indices[i]->isBTree() )
+				refreshIndex( m_indices[i] );
+		}
+	}
+	catch( ... )
+	{
+		m_currentIndex = currentIndex;
+		throw;
+	}
+	m_currentIndex = currentIndex;
+
+	return true;
+}
+
+void Table::compact()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::compact" );
+
+	while( !compactStep( Compactor::DEFAULT_STEP_SIZE ) )
+		;
+}
+
+/*
+	writes the table and all indices as balanced trees. The indices are
+	built from the new table records in the same pass, because the record
+	positions change. The files are swapped, when all are complete.
+*/
+void Table::endBulkLoad()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::endBulkLoad" );
+
+	if( !isBulkLoading() )
+/***/	return;
+
+	try
+	{
+		m_bulkLoader->prepare( getPathName() );
+
+		for( size_t i=0; i<m_indices.size(); i++ )
+			m_indices[i]->beginBulkLoad( false );
+
+		while( m_bulkLoader->writeNext() )
+		{
+			m_bulkLoader->readRecord( &m_currentRecord );
+			for( size_t i=0; i<m_indices.size(); i++ )
+				insertKeyRecord( m_indices[i] );
+		}
+
+		for( size_t i=0; i<m_indices.size(); i++ )
+			m_indices[i]->writeBulkLoad();
+	}
+	catch( ... )
+	{
+		for( size_t i=0; i<m_indices.size(); i++ )
+			m_indices[i]->cancelBulkLoad();
+		cancelBulkLoad();
+		m_currentRecord.setInsertMode();
+		throw;
+	}
+
+	checkpointLog();
+	finishBulkLoad();
+	for( size_t i=0; i<m_indices.size(); i++ )
+		m_indices[i]->finishBulkLoad();
+}
+
+/*
+	maps the data file and all index files into memory. Mapped files are
+	written directly, this is not possible with a log.
+*/
+bool Table::setMemoryMapped( bool mapped )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::setMemoryMapped" );
+
+	if( mapped && m_wal )
+/***/	return false;
+
+	bool	success = Index::setMemoryMapped( mapped );
 
-		theIndex->firstRecord( searchBuffer );
-		if( !theIndex->eof() )
-			theIndex->deleteRecord();
+	for( size_t i=0; i<m_indices.size(); i++ )
+	{
+		if( !m_indices[i]->setMemoryMapped( mapped ) )
+			success = false;
 	}
 
-	m_currentRecord.deleteRecord( m_dataFileHandle, noMove );
+	return success;
 }
 
-void Table::firstRecord( const STRING &searchBuffer )
+void Table::firstRecord( const KeyRange &range )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Table::firstRecord" );
 
 	if( m_currentIndex )
 	{
-		m_currentIndex->firstRecord( searchBuffer );
+		m_currentIndex->firstRecord( range );
 		if( !m_currentIndex->eof() )
 		{
-			m_currentRecord.readRecord(
-				m_dataFileHandle,
-				m_currentIndex->getField(
-					m_currentIndex->getNumFields() -1
-				)->getIntegerValue()
-			);
+			m_currentRecord.readRecord( m_dataFileHandle, getIndexedPosition() );
 		}
 		else
 			m_currentRecord.m_theRecMode = rmEof;
 
 	}
 	else
-		Index::firstRecord( searchBuffer );
+		Index::firstRecord( range );
 }
 
 void Table::nextRecord()
@@ -405,12 +599,7 @@ void Table::nextRecord()
 		m_currentIndex->nextRecord();
 		if( !m_currentIndex->eof() )
 		{
-			m_currentRecord.readRecord(
-				m_dataFileHandle,
-				m_currentIndex->getField(
-					m_currentIndex->getNumFields() -1
-				)->getIntegerValue()
-			);
+			m_currentRecord.readRecord( m_dataFileHandle, getIndexedPosition() );
 		}
 		else
 			m_currentRecord.m_theRecMode = rmEof;
@@ -428,12 +617,7 @@ void Table::previousRecord()
 		m_currentIndex->previousRecord();
 		if( !m_currentIndex->bof() )
 		{
-			m_currentRecord.readRecord(
-				m_dataFileHandle,
-				m_currentIndex->getField(
-					m_currentIndex->getNumFields() -1
-				)->getIntegerValue()
-			);
+			m_currentRecord.readRecord( m_dataFileHandle, getIndexedPosition() );
 		}
 		else
 			m_currentRecord.m_theRecMode = rmBof;
@@ -443,31 +627,43 @@ void Table::previousRecord()
 		Index::previousRecord();
 }
 
-void Table::lastRecord( const STRING &searchBuffer )
+void Table::lastRecord( const KeyRange &range )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Table::lastRecord" );
 
 	if( m_currentIndex )
 	{
-		m_currentIndex->lastRecord( searchBuffer );
+		m_currentIndex->lastRecord( range );
 		if( !m_currentIndex->bof() )
 		{
-			m_currentRecord.readRecord(
-				m_dataFileHandle,
-				m_currentIndex->getField(
-					m_currentIndex->getNumFields() -1
-				)->getIntegerValue()
-			);
+			m_currentRecord.readRecord( m_dataFileHandle, getIndexedPosition() );
 		}
 		else
 			m_currentRecord.m_theRecMode = rmBof;
 
 	}
 	else
-		Index::lastRecord( searchBuffer );
+		Index::lastRecord( range );
 }
 
-void Table::createIndex( const STRING &indexName )
+bool Table::seekToRank( gak::int64 rank )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::seekToRank" );
+
+	if( !m_currentIndex )
+/***/	return Index::seekToRank( rank );
+
+	if( !m_currentIndex->seekToRank( rank ) )
+	{
+		m_currentRecord.m_theRecMode = m_currentIndex->bof() ? rmBof : rmEof;
+/***/	return false;
+	}
+
+	m_currentRecord.readRecord( m_dataFileHandle, getIndexedPosition() );
+	return true;
+}
+
+void Table::createIndex( const STRING &indexName, int formatVersion )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Table::createIndex" );
 	STRING	indexPath = getIndexPathName(indexName);
@@ -476,12 +672,30 @@ void Table::createIndex( const STRING &indexName )
 		throw DBindexExist( indexName );
 
 	Index	*newIndex = new Index( indexPath );
-	newIndex->create();
+	newIndex->create( formatVersion );
 	m_indices.addElement( newIndex );
 
 	writeDefinition();
 }
 
+void Table::setBalanceAlpha( double alpha, const STRING &indexName )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::setBalanceAlpha" );
+
+	if( indexName.isEmpty() )
+		Index::setBalanceAlpha( alpha );
+	else
+	{
+		Index	*theIndex = findIndexFromPath( getIndexPathName( indexName ) );
+		if( !theIndex )
+			throw DBindexNotFound( indexName );
+
+		theIndex->setBalanceAlpha( alpha );
+	}
+
+	writeDefinition();
+}
+
 void Table::addFieldToIndex( const STRING &indexName, const STRING &fieldName, bool primary, bool lastField )
 {
 	doEnterFunctionEx( gakLogging::llDetail, "Table::addFieldToIndex" );
@@ -526,13 +740,23 @@ void Table::refreshIndex( Index *theIndex )
 	doEnterFunctionEx( gakLogging::llDetail, "Table::refreshIndex" );
 	assert( theIndex != m_currentIndex );
 
+	checkpointLog();
 	theIndex->truncateFile();
 
+	// B+trees are written in one pass, the bulk load checks the keys
+	const bool	bulkLoad = theIndex->isBTree();
+	if( bulkLoad )
+		theIndex->beginBulkLoad( false );
+
 	for( firstRecord(); !eof(); nextRecord() )
 	{
-		checkKeyViolation(theIndex);
+		if( !bulkLoad )
+			checkKeyViolation(theIndex);
 		insertKeyRecord(theIndex);
 	}
+
+	if( bulkLoad )
+		theIndex->endBulkLoad();
 }
 
 void Table::setIndex( const STRING &indexName )
@@ -547,6 +771,24 @@ void Table::setIndex( const STRING &indexName )
 	}
 	else
 		m_currentIndex = NULL;
+
+	if( m_view )
+		setRecordView( m_view );
+}
+
+void Table::setRecordView( RecordView *view )
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::setRecordView" );
+
+	m_view = view;
+	m_currentRecord.setView( view );
+	for( size_t i=0; i<m_indices.size(); i++ )
+	{
+		Index	*theIndex = m_indices[i];
+		theIndex->setRecordView(
+			view && theIndex == m_currentIndex ? &m_indexView : NULL
+		);
+	}
 }
 
 void Table::dropIndex( const gak::STRING &indexName )
@@ -561,12 +803,45 @@ void Table::dropIndex( const gak::STRING &indexName )
 	if(  theIndex == m_currentIndex )
 		m_currentIndex = nullptr;
 
+	checkpointLog();
 	theIndex->dropDataFile();
 	m_indices.removeElementVal( theIndex );
 	delete theIndex;
 	writeDefinition();
 }
 
+FileStats Table::getStats() const
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::getStats" );
+
+	FileStats	stats = Index::getStats();
+
+	for( size_t i=0; i<m_indices.size(); i++ )
+		stats += m_indices[i]->getStats();
+
+	return stats;
+}
+
+void Table::analyzeIndex( const STRING &indexName, TreeReport *report ) const
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::analyzeIndex" );
+
+	Index	*theIndex = findIndexFromPath( getIndexPathName( indexName ) );
+	if( !theIndex )
+		throw DBindexNotFound( indexName );
+
+	theIndex->analyzeTree( report );
+}
+
+void Table::resetStats()
+{
+	doEnterFunctionEx( gakLogging::llDetail, "Table::resetStats" );
+
+	Index::resetStats();
+	for( size_t i=0; i<m_indices.size(); i++ )
+		m_indices[i]->resetStats();
+}
+
 // --------------------------------------------------------------------- //
 // ----- entry points -------------------------------------------------- //
 // --------------------------------------------------------------------- //
@@ -2,11 +2,11 @@
 		Project:		dbLIB
 		Module:			table.h
 		Description:	The definition for the entire table
-		Author:			Martin Gckler
+		Author:			Martin Gäckler
 		Address:		Hofmannsthalweg 14, A-4030 Linz
 		Web:			https://www.gaeckler.at/
 
-		Copyright:		(c) 2007-2025 Martin Gckler
+		Copyright:		(c) 2007-2025 Martin Gäckler
 
 		This program is free software: you can redistribute it and/or modify  
 		it under the terms of the GNU General Public License as published by  
@@ -15,7 +15,7 @@
 		You should have received a copy of the GNU General Public License 
 		along with this program. If not, see <http://www.gnu.org/licenses/>.
 
-		THIS SOFTWARE IS PROVIDED BY Martin Gckler, Linz, Austria ``AS IS''
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
 		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
 		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
 		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
@@ -41,6 +41,7 @@
 // --------------------------------------------------------------------- //
 
 #include "index.h"
+#include "db_wal.h"
 
 // --------------------------------------------------------------------- //
 // ----- imported datas ------------------------------------------------ //
@@ -86,17 +87,43 @@ class Table : public Index
 	gak::Array<Index*>	m_indices;
 	Index				*m_currentIndex;
 
+	RecordView			*m_view;
+	RecordView			m_indexView;		// the entries of the current index
+
+	WriteAheadLog		*m_wal;				// owned by the database
+
 	void writeDefinition() const;
 
+	/*
+		files replaced or truncated without a transaction must not get
+		old log entries
+	*/
+	void checkpointLog()
+	{
+		if( m_wal )
+			m_wal->checkpoint();
+	}
+
 	Index *findIndexFromPath( const gak::STRING &indexPath ) const;
 
+	void checkNumberFormats() const;
 	void checkKeyViolation(Index *theIndex);
 	void insertKeyRecord(Index *theIndex);
+	gak::int64 getIndexedPosition() const
+	{
+		const size_t	recPosIdx = m_currentIndex->getNumFields() -1;
+
+		return m_view
+			? m_indexView.getIntegerValue( recPosIdx )
+			: m_currentIndex->getField( recPosIdx )->getIntegerValue();
+	}
 
 	public:
 	Table( const gak::STRING &pathName ) : Index( pathName )
 	{
 		m_currentIndex = NULL;
+		m_view = NULL;
+		m_wal = NULL;
 		m_definitionFile = pathName;
 		m_definitionFile += ".definition";
 	}
@@ -109,22 +136,83 @@ class Table : public Index
 		bool notNulls = false,
 		const gak::STRING &reference = ""
 	);
+	/*
+		with a log all writes of a post or a delete are one transaction
+	*/
+	void setWriteAheadLog( WriteAheadLog *wal )
+	{
+		m_wal = wal;
+	}
+	WriteAheadLog *getWriteAheadLog() const
+	{
+		return m_wal;
+	}
 	void postRecord();
 	void deleteRecord( bool noMove=false );
+	void convertFormat();
+	bool compactStep( size_t maxRecords );
+	void compact();
+	void endBulkLoad();
+	bool setMemoryMapped( bool mapped );
 
 	/*
-	 * cursor loop
+	 * cursor loop, a range limits the loop in both directions
 	 */
-	void firstRecord( const gak::STRING &searchBuffer="" );
+	void firstRecord( const gak::STRING &searchBuffer="" )
+	{
+		firstRecord( KeyRange( searchBuffer, true, searchBuffer, true ) );
+	}
+	void firstRecord( const KeyRange &range );
 	void nextRecord();
 	void previousRecord();
-	void lastRecord( const gak::STRING &searchBuffer="" );
+	void lastRecord( const gak::STRING &searchBuffer="" )
+	{
+		lastRecord( KeyRange( searchBuffer, true, searchBuffer, true ) );
+	}
+	void lastRecord( const KeyRange &range );
+
+	/*
+		order statistics in the current index
+	*/
+	bool seekToRank( gak::int64 rank );
+	gak::int64 getRank() const
+	{
+		return m_currentIndex ? m_currentIndex->getRank() : Index::getRank();
+	}
+	gak::int64 countRange( const gak::STRING &lo, const gak::STRING &hi ) const
+	{
+		return m_currentIndex
+			? m_currentIndex->countRange( lo, hi )
+			: Index::countRange( lo, hi );
+	}
 
-	void createIndex( const gak::STRING &indexName );
+	/*
+		with fvBTree the index is stored as a B+tree
+	*/
+	void createIndex( const gak::STRING &indexName, int formatVersion=fvCurrent );
+	/*
+		the balance of the table (empty name) or of an index. Existing
+		records keep their places, compact() rebuilds the tree.
+	*/
+	void setBalanceAlpha( double alpha, const gak::STRING &indexName="" );
 	void addFieldToIndex( const gak::STRING &indexName, const gak::STRING &fieldName, bool primary, bool lastField=false );
 	void refreshIndex( Index *theIndex );
 	void setIndex( const gak::STRING &indexName );
+
+	/*
+		binds a view for read only scans, NULL ends the scan. The fields of
+		the table are not loaded while a view is bound.
+	*/
+	void setRecordView( RecordView *view );
 	void dropIndex( const gak::STRING &indexName );
+
+	/*
+		the counters of the table and all its indices
+	*/
+	FileStats getStats() const;
+	void resetStats();
+
+	void analyzeIndex( const gak::STRING &indexName, TreeReport *report ) const;
 };
 
 
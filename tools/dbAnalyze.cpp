@@ -0,0 +1,129 @@
+/*
+		Project:		dbLIB
+		Module:			dbAnalyze.cpp
+		Description:	reports the shape and the fragmentation of data files
+		Author:			Martin Gäckler
+		Address:		Hofmannsthalweg 14, A-4030 Linz
+		Web:			https://www.gaeckler.at/
+
+		Copyright:		(c) 2007-2025 Martin Gäckler
+
+		This program is free software: you can redistribute it and/or modify
+		it under the terms of the GNU General Public License as published by
+		the Free Software Foundation, version 3.
+
+		You should have received a copy of the GNU General Public License
+		along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+		THIS SOFTWARE IS PROVIDED BY Martin Gäckler, Linz, Austria ``AS IS''
+		AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+		TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+		PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+		CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+		SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+		LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+		USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+		ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+		OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+		OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+		SUCH DAMAGE.
+*/
+
+/*
+	usage: dbAnalyze file.data ...
+
+	Works for table and index files. The files are only read.
+*/
+
+#include <iostream>
+#include <iomanip>
+
+#include "../db_exception.h"
+#include "../index.h"
+
+using gak::STRING;
+
+static void printReport( std::ostream &out, const STRING &fileName, const dbLib::TreeReport &report )
+{
+	const gak::uint64	wasted = report.getWastedBytes();
+	const gak::int64	dataSize = report.fileSize - report.headerSize;
+
+	out << fileName << '\n'
+		<< "  format version:  " << report.formatVersion << '\n'
+		<< "  file size:       " << report.fileSize << '\n'
+		<< "  tree nodes:      " << report.treeNodes
+			<< " (" << report.getLiveRecords() << " live, "
+			<< report.deletedNodes << " deleted)\n"
+		<< "  dead ratio:      " << std::fixed << std::setprecision( 3 )
+			<< report.getDeadRatio() << '\n'
+		<< "  free records:    " << report.freeRecords
+			<< " (" << report.freeBytes << " bytes)\n"
+		<< "  wasted bytes:    " << wasted
+			<< " (" << (dataSize > 0 ? 100.0 * double(wasted) / double(dataSize) : 0.0)
+			<< "% of the data)\n"
+		<< "  depth:           max " << report.maxDepth
+			<< ", avg " << report.getAvgDepth()
+			<< ", optimal " << report.getOptimalDepth()
+			<< ", bound " << report.getDepthBound() << '\n'
+		<< "  link distance:   avg " << report.getAvgDistance()
+			<< ", max " << report.maxDistance
+			<< ", " << report.farLinks << " of " << report.links
+			<< " links to another page\n"
+		<< "  level       nodes   deleted   avg ratio   max ratio  unbalanced\n";
+
+	for( size_t i=0; i<report.levels.size(); ++i )
+	{
+		const dbLib::TreeLevel	&level = report.levels[i];
+
+		out << "  " << std::setw( 5 ) << (i+1)
+			<< std::setw( 12 ) << level.nodes
+			<< std::setw( 10 ) << level.deletedNodes
+			<< std::setw( 12 ) << level.getAvgRatio()
+			<< std::setw( 12 ) << level.maxRatio
+			<< std::setw( 12 ) << level.overThreshold << '\n';
+	}
+	out << std::endl;
+}
+
+int main( int argc, const char *argv[] )
+{
+	doDisableLog();
+	doEnterFunctionEx( gakLogging::llInfo, "main" );
+
+	if( argc < 2 )
+	{
+		std::cerr << "usage: dbAnalyze file.data ..." << std::endl;
+/***/	return 1;
+	}
+
+	int	result = 0;
+	for( int i=1; i<argc; ++i )
+	{
+		STRING	fileName = argv[i];
+		size_t	nameLen = fileName.strlen();
+
+		if( nameLen <= 5 || fileName.rightString( 5 ) != ".data" || !dbLib::fileExists( fileName ) )
+		{
+			std::cerr << fileName << ": not a data file" << std::endl;
+			result = 2;
+/*^*/		continue;
+		}
+
+		try
+		{
+			// the index opens <path>.data
+			dbLib::Index		theFile( fileName.leftString( nameLen-5 ) );
+			dbLib::TreeReport	report;
+
+			theFile.analyzeTree( &report );
+			printReport( std::cout, fileName, report );
+		}
+		catch( std::exception &e )
+		{
+			std::cerr << fileName << ": " << e.what() << std::endl;
+			result = 2;
+		}
+	}
+
+	return result;
+}